@@ -0,0 +1,341 @@
+#include <cstdlib>
+#include <string>
+
+#include "CharScan.h"
+#include "SourceFile.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    #define CHARSCAN_X86 1
+    #include <immintrin.h>
+#else
+    #define CHARSCAN_X86 0
+#endif
+
+static_assert(SourceFile::PADDING >= 32, "scanners read up to 32 bytes past the sentinel");
+
+namespace
+{
+    inline bool IsBlank(uint8_t c)
+    {
+        return c == ' ' || static_cast<uint8_t>(c - '\t') <= '\r' - '\t';
+    }
+
+    inline bool IsDigit(uint8_t c)
+    {
+        return static_cast<uint8_t>(c - '0') <= 9;
+    }
+
+    inline bool IsIdent(uint8_t c)
+    {
+        return IsDigit(c) || static_cast<uint8_t>((c | 0x20) - 'a') <= 25 || c == '_';
+    }
+
+    // 标量实现
+
+    size_t ScanBlankScalar(const char *p)
+    {
+        const char *q = p;
+        while(IsBlank(static_cast<uint8_t>(*q)))
+            ++q;
+        return q - p;
+    }
+
+    size_t ScanIdentScalar(const char *p)
+    {
+        const char *q = p;
+        while(IsIdent(static_cast<uint8_t>(*q)))
+            ++q;
+        return q - p;
+    }
+
+    size_t ScanDigitsScalar(const char *p)
+    {
+        const char *q = p;
+        while(IsDigit(static_cast<uint8_t>(*q)))
+            ++q;
+        return q - p;
+    }
+
+    size_t FindNewlinesScalar(const char *p, size_t len, uint32_t base,
+                              std::vector<uint32_t> &lineStarts)
+    {
+        size_t count = 0;
+        for(size_t i = 0; i < len; ++i)
+        {
+            if(p[i] == '\n')
+            {
+                lineStarts.push_back(base + static_cast<uint32_t>(i) + 1);
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    size_t FindLastNameScalar(const Name *names, size_t count, const Name &key)
+    {
+        for(size_t i = count; i > 0; --i)
+        {
+            if(names[i - 1] == key)
+                return i - 1;
+        }
+        return count;
+    }
+
+#if CHARSCAN_X86
+
+    // 把掩码中为1的位对应的换行位置依次追加到lineStarts中
+    inline size_t EmitNewlines(uint32_t mask, uint32_t pos,
+                               std::vector<uint32_t> &lineStarts)
+    {
+        size_t count = 0;
+        while(mask)
+        {
+            lineStarts.push_back(pos + static_cast<uint32_t>(__builtin_ctz(mask)) + 1);
+            mask &= mask - 1;
+            ++count;
+        }
+        return count;
+    }
+
+    // SSE2实现，x86-64上总是可用
+
+    // 无符号比较 x - lo <= hi - lo
+    inline __m128i InRange128(__m128i x, char lo, char hi)
+    {
+        __m128i d = _mm_sub_epi8(x, _mm_set1_epi8(lo));
+        return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(hi - lo)), d);
+    }
+
+    inline __m128i Blank128(__m128i x)
+    {
+        return _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')),
+                            InRange128(x, '\t', '\r'));
+    }
+
+    inline __m128i Digit128(__m128i x)
+    {
+        return InRange128(x, '0', '9');
+    }
+
+    inline __m128i Ident128(__m128i x)
+    {
+        __m128i alpha = InRange128(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z');
+        __m128i under = _mm_cmpeq_epi8(x, _mm_set1_epi8('_'));
+        return _mm_or_si128(_mm_or_si128(alpha, under), Digit128(x));
+    }
+
+    template<__m128i (*Class)(__m128i)>
+    size_t Scan128(const char *p)
+    {
+        size_t n = 0;
+        for(;;)
+        {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + n));
+            uint32_t stop = ~static_cast<uint32_t>(_mm_movemask_epi8(Class(x))) & 0xffff;
+            if(stop)
+                return n + __builtin_ctz(stop);
+            n += 16;
+        }
+    }
+
+    size_t ScanBlankSSE2(const char *p)
+    {
+        return Scan128<Blank128>(p);
+    }
+
+    size_t ScanIdentSSE2(const char *p)
+    {
+        return Scan128<Ident128>(p);
+    }
+
+    size_t ScanDigitsSSE2(const char *p)
+    {
+        return Scan128<Digit128>(p);
+    }
+
+    size_t FindNewlinesSSE2(const char *p, size_t len, uint32_t base,
+                            std::vector<uint32_t> &lineStarts)
+    {
+        const __m128i nl = _mm_set1_epi8('\n');
+        size_t count = 0, i = 0;
+        for(; i + 16 <= len; i += 16)
+        {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, nl)));
+            count += EmitNewlines(mask, base + static_cast<uint32_t>(i), lineStarts);
+        }
+        return count + FindNewlinesScalar(p + i, len - i, base + static_cast<uint32_t>(i), lineStarts);
+    }
+
+    size_t FindLastNameSSE2(const Name *names, size_t count, const Name &key)
+    {
+        const __m128i k = _mm_load_si128(reinterpret_cast<const __m128i*>(key.Data()));
+        for(size_t i = count; i > 0; --i)
+        {
+            __m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(names[i - 1].Data()));
+            if(_mm_movemask_epi8(_mm_cmpeq_epi8(x, k)) == 0xffff)
+                return i - 1;
+        }
+        return count;
+    }
+
+    // AVX2实现，仅在运行时检测到支持时使用
+
+    #define AVX2_FUNC __attribute__((target("avx2")))
+
+    AVX2_FUNC inline __m256i InRange256(__m256i x, char lo, char hi)
+    {
+        __m256i d = _mm256_sub_epi8(x, _mm256_set1_epi8(lo));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(hi - lo)), d);
+    }
+
+    AVX2_FUNC inline __m256i Blank256(__m256i x)
+    {
+        return _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')),
+                               InRange256(x, '\t', '\r'));
+    }
+
+    AVX2_FUNC inline __m256i Digit256(__m256i x)
+    {
+        return InRange256(x, '0', '9');
+    }
+
+    AVX2_FUNC inline __m256i Ident256(__m256i x)
+    {
+        __m256i alpha = InRange256(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 'z');
+        __m256i under = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_'));
+        return _mm256_or_si256(_mm256_or_si256(alpha, under), Digit256(x));
+    }
+
+    #define DEFINE_SCAN256(NAME, CLASS)                                                     \
+        AVX2_FUNC size_t NAME(const char *p)                                                \
+        {                                                                                   \
+            size_t n = 0;                                                                   \
+            for(;;)                                                                         \
+            {                                                                               \
+                __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + n));   \
+                uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(CLASS(x)));     \
+                if(stop)                                                                    \
+                    return n + __builtin_ctz(stop);                                         \
+                n += 32;                                                                    \
+            }                                                                               \
+        }
+
+    DEFINE_SCAN256(ScanBlankAVX2,  Blank256)
+    DEFINE_SCAN256(ScanIdentAVX2,  Ident256)
+    DEFINE_SCAN256(ScanDigitsAVX2, Digit256)
+
+    #undef DEFINE_SCAN256
+
+    AVX2_FUNC size_t FindNewlinesAVX2(const char *p, size_t len, uint32_t base,
+                                      std::vector<uint32_t> &lineStarts)
+    {
+        const __m256i nl = _mm256_set1_epi8('\n');
+        size_t count = 0, i = 0;
+        for(; i + 32 <= len; i += 32)
+        {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, nl)));
+            count += EmitNewlines(mask, base + static_cast<uint32_t>(i), lineStarts);
+        }
+        return count + FindNewlinesSSE2(p + i, len - i, base + static_cast<uint32_t>(i), lineStarts);
+    }
+
+    // 每次比较4个名字：两次256位加载，每次加载的两个名字各占一个128位的半边，比较结果的掩码中对应的16位全为1即相同
+    AVX2_FUNC size_t FindLastNameAVX2(const Name *names, size_t count, const Name &key)
+    {
+        const __m256i k = _mm256_broadcastsi128_si256(
+            _mm_load_si128(reinterpret_cast<const __m128i*>(key.Data())));
+        size_t i = count;
+        for(; i >= 4; i -= 4)
+        {
+            const __m256i *p = reinterpret_cast<const __m256i*>(names + i - 4);
+            uint32_t lo = static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_loadu_si256(p), k)));
+            uint32_t hi = static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_loadu_si256(p + 1), k)));
+            if((hi >> 16) == 0xffff)
+                return i - 1;
+            if((hi & 0xffff) == 0xffff)
+                return i - 2;
+            if((lo >> 16) == 0xffff)
+                return i - 3;
+            if((lo & 0xffff) == 0xffff)
+                return i - 4;
+        }
+        const size_t rt = FindLastNameSSE2(names, i, key);
+        return rt == i ? count : rt;
+    }
+
+    #undef AVX2_FUNC
+
+#endif // CHARSCAN_X86
+
+    struct ScanImpl
+    {
+        const char *name;
+        size_t (*blank)(const char*);
+        size_t (*ident)(const char*);
+        size_t (*digits)(const char*);
+        size_t (*newlines)(const char*, size_t, uint32_t, std::vector<uint32_t>&);
+        size_t (*lastName)(const Name*, size_t, const Name&);
+    };
+
+    // 环境变量PARSER_SCAN可以强制使用较低的实现，便于对比测试
+    ScanImpl SelectImpl(void)
+    {
+        const char *force = std::getenv("PARSER_SCAN");
+        const std::string forced = force ? force : "";
+        if(forced == "scalar")
+        {
+            return { "scalar", ScanBlankScalar, ScanIdentScalar,
+                     ScanDigitsScalar, FindNewlinesScalar, FindLastNameScalar };
+        }
+
+#if CHARSCAN_X86
+        if(forced != "sse2" && __builtin_cpu_supports("avx2"))
+        {
+            return { "avx2", ScanBlankAVX2, ScanIdentAVX2,
+                     ScanDigitsAVX2, FindNewlinesAVX2, FindLastNameAVX2 };
+        }
+        return { "sse2", ScanBlankSSE2, ScanIdentSSE2,
+                 ScanDigitsSSE2, FindNewlinesSSE2, FindLastNameSSE2 };
+#else
+        return { "scalar", ScanBlankScalar, ScanIdentScalar,
+                 ScanDigitsScalar, FindNewlinesScalar, FindLastNameScalar };
+#endif
+    }
+
+    const ScanImpl IMPL = SelectImpl();
+}
+
+size_t ScanBlank(const char *p)
+{
+    return IMPL.blank(p);
+}
+
+size_t ScanIdent(const char *p)
+{
+    return IMPL.ident(p);
+}
+
+size_t ScanDigits(const char *p)
+{
+    return IMPL.digits(p);
+}
+
+size_t FindNewlines(const char *p, size_t len, uint32_t base,
+                    std::vector<uint32_t> &lineStarts)
+{
+    return IMPL.newlines(p, len, base, lineStarts);
+}
+
+size_t FindLastName(const Name *names, size_t count, const Name &key)
+{
+    return IMPL.lastName(names, count, key);
+}
+
+const char *ScanImplName(void)
+{
+    return IMPL.name;
+}
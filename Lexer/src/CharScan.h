@@ -0,0 +1,35 @@
+#ifndef CHARSCAN_H
+#define CHARSCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Name.h"
+
+// 词法分析中的字符串扫描，按运行时检测到的指令集选用AVX2/SSE2/标量实现
+// 每次从p起整块读取16或32字节，因此要求扫描终点之后至少还有32字节可读，
+// SourceFile的填充保证了这一点
+
+// 返回从p开始连续的空白字符（含换行）个数
+size_t ScanBlank(const char *p);
+
+// 返回从p开始连续的标识符字符（字母、数字、下划线）个数
+size_t ScanIdent(const char *p);
+
+// 返回从p开始连续的十进制数字个数
+size_t ScanDigits(const char *p);
+
+// 对p[0, len)中的每个换行符，将其下一个位置（加上base）追加到lineStarts中
+// 返回换行符个数
+size_t FindNewlines(const char *p, size_t len, uint32_t base,
+                    std::vector<uint32_t> &lineStarts);
+
+// 在names[0, count)中由后向前查找key，返回最后一个与之相同的名字的位置，未找到时返回count
+// 名字是定长的，每次比较一组名字，不需要哈希：SSE2每次一个，AVX2每次四个（两次256位加载，各含两个名字）
+size_t FindLastName(const Name *names, size_t count, const Name &key);
+
+// 当前使用的实现名称："avx2"、"sse2"或"scalar"
+const char *ScanImplName(void);
+
+#endif // CHARSCAN_H
@@ -0,0 +1,133 @@
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+#include "DydFile.h"
+
+namespace
+{
+    // 文本不超过16个字符的记录恰好占一整行的20字节
+    constexpr size_t DYD_FIELD_WIDTH = 16;
+    constexpr size_t DYD_RECORD_SIZE = DYD_FIELD_WIDTH + 4;
+
+    bool IsDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    // 定长记录中右对齐的文本的起始位置，p处至少有16字节可读
+    size_t SkipPadding(const char *p)
+    {
+#if defined(__SSE2__)
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const uint32_t spaces = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(x, _mm_set1_epi8(' '))));
+        return static_cast<size_t>(__builtin_ctz(~spaces));
+#else
+        size_t i = 0;
+        while(i < DYD_FIELD_WIDTH && p[i] == ' ')
+            ++i;
+        return i;
+#endif
+    }
+}
+
+void WriteDydToken(OutputFile &out, std::string_view str, TokenType type)
+{
+    out.PutPadded(str, 16);
+    out.Put(' ');
+    out.Put(TokenCode(type));
+    out.Put('\n');
+}
+
+void WriteDydTokens(OutputFile &out, const TokenBuffer &toks)
+{
+    const std::vector<uint32_t> &lineStarts = toks.LineStarts();
+    size_t line = 1;
+    for(size_t i = 0; i < toks.Size(); ++i)
+    {
+        for(; line < lineStarts.size() && lineStarts[line] <= toks.Offset(i); ++line)
+            WriteDydToken(out, "EOLN", TokenType::NewLine);
+        WriteDydToken(out, toks.Str(i), toks.Type(i));
+    }
+
+    for(; line < lineStarts.size(); ++line)
+        WriteDydToken(out, "EOLN", TokenType::NewLine);
+}
+
+bool ReadDydTokens(const char *src, size_t size, TokenBuffer &toks,
+                   std::vector<TokenizerError> &errs)
+{
+    const size_t errCount = errs.size();
+    toks.Reset(src);
+    toks.Reserve(size / DYD_RECORD_SIZE + 1);
+    std::vector<uint32_t> &lineStarts = toks.LineStarts();
+
+    int line = 1;
+    bool ended = false;
+    for(size_t pos = 0; pos < size && !ended; )
+    {
+        // 记录为[pos, end)，end处是换行符或文件末尾
+        size_t end = pos + DYD_RECORD_SIZE - 1;
+        size_t first;
+        if(end < size && src[end] == '\n')
+            first = pos + SkipPadding(src + pos);
+        else
+        {
+            const void *nl = std::memchr(src + pos, '\n', size - pos);
+            end = nl ? static_cast<const char*>(nl) - src : size;
+            first = pos;
+            while(first < end && src[first] == ' ')
+                ++first;
+        }
+
+        const uint32_t offset = static_cast<uint32_t>(first);
+        const int code = end - first >= 3 && src[end - 3] == ' ' &&
+                         IsDigit(src[end - 2]) && IsDigit(src[end - 1]) ?
+                         (src[end - 2] - '0') * 10 + (src[end - 1] - '0') : 0;
+        const size_t length = end - first > 3 ? end - first - 3 : 0;
+        const TokenType type = static_cast<TokenType>(code);
+
+        if(code < 1 || code >= TOKEN_CODE_COUNT || !length)
+            errs.push_back(TokenizerError{ TokenizerErrorCode::UnknownToken, line, offset,
+                                           static_cast<uint32_t>(end - first) });
+        else if(type == TokenType::NewLine)
+        {
+            lineStarts.push_back(static_cast<uint32_t>(end + 1));
+            ++line;
+        }
+        else if(type == TokenType::Identifier && length > MAX_IDENTIFIER_LENGTH)
+            errs.push_back(TokenizerError{ TokenizerErrorCode::NameTooLong, line, offset,
+                                           static_cast<uint32_t>(length) });
+        else
+        {
+            // 与词法分析相同，整形字面量按2^32取模
+            unsigned int value = 0;
+            bool valid = true;
+            if(type == TokenType::IntLiteral)
+            {
+                for(size_t i = first; i < first + length; ++i)
+                {
+                    valid = valid && IsDigit(src[i]);
+                    value = value * 10 + static_cast<unsigned int>(src[i] - '0');
+                }
+            }
+            if(valid)
+            {
+                toks.Push(type, offset, static_cast<uint32_t>(length), static_cast<int>(value));
+                ended = type == TokenType::EndMark;
+            }
+            else
+                errs.push_back(TokenizerError{ TokenizerErrorCode::InvalidIntLiteral, line, offset,
+                                               static_cast<uint32_t>(length) });
+        }
+        pos = end + 1;
+    }
+
+    if(!ended)
+        toks.Push(TokenType::EndMark, static_cast<uint32_t>(size), 0, 0);
+    return errs.size() == errCount;
+}
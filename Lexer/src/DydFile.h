@@ -0,0 +1,25 @@
+#ifndef DYDFILE_H
+#define DYDFILE_H
+
+#include <string_view>
+#include <vector>
+
+#include "OutputFile.h"
+#include "Tokenizer.h"
+
+// 输出一行dyd记录：右对齐至16列的词法单元文本、空格、两位种别码
+void WriteDydToken(OutputFile &out, std::string_view str, TokenType type);
+
+// 按源代码中的顺序输出词法单元，并在对应位置还原换行符
+// toks可以是流式分析中的一个窗口，窗口最后一个词法单元之后的换行也一并输出
+void WriteDydTokens(OutputFile &out, const TokenBuffer &toks);
+
+// 把dyd文件的内容解码为词法单元序列，代替对源代码的词法分析
+// src须满足与Tokenizer相同的要求（见SourceFile），toks中的词法单元文本直接引用src中的记录，
+// EOLN记录还原为行首偏移表，因此行号与分析源代码时相同
+// 记录的种别码被直接采用，不再检查与文本是否相符；格式不对的记录作为词法错误追加到errs中
+// 没有EOF记录时在末尾补上结束标志；返回是否没有错误
+bool ReadDydTokens(const char *src, size_t size, TokenBuffer &toks,
+                   std::vector<TokenizerError> &errs);
+
+#endif // DYDFILE_H
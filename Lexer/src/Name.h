@@ -0,0 +1,128 @@
+#ifndef NAME_H
+#define NAME_H
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string_view>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+// 定长的名字，直接存放在16字节中，不足部分以'\0'填充
+// 语言限定标识符不超过16个字符，因此任何合法的名字都能放下，
+// 复制不需要分配内存，比较只需一次128位的比较
+class alignas(16) Name
+{
+public:
+
+    static constexpr size_t CAPACITY = 16;
+
+    Name(void)
+        : data_{ }
+    {
+
+    }
+
+    // 超出CAPACITY的部分被截断
+    explicit Name(std::string_view str)
+        : data_{ }
+    {
+        std::memcpy(data_, str.data(), str.length() < CAPACITY ? str.length() : CAPACITY);
+    }
+
+    // 从p处读取长度为length的名字，要求p之后至少有16字节可读（见SourceFile的填充）
+    // 整块读入后把多余的字节清零，不需要逐字节复制
+    static Name FromPadded(const char *p, size_t length)
+    {
+        Name rt;
+#if defined(__SSE2__)
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+            LENGTH_MASKS + CAPACITY - (length < CAPACITY ? length : CAPACITY)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(rt.data_), _mm_and_si128(x, mask));
+#else
+        std::memcpy(rt.data_, p, length < CAPACITY ? length : CAPACITY);
+#endif
+        return rt;
+    }
+
+    size_t Length(void) const
+    {
+#if defined(__SSE2__)
+        const uint32_t zeros = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(Load(), _mm_setzero_si128())));
+        return static_cast<size_t>(__builtin_ctz(zeros | 0x10000));
+#else
+        const void *end = std::memchr(data_, '\0', CAPACITY);
+        return end ? static_cast<const char*>(end) - data_ : CAPACITY;
+#endif
+    }
+
+    bool Empty(void) const
+    {
+        return data_[0] == '\0';
+    }
+
+    std::string_view View(void) const
+    {
+        return std::string_view(data_, Length());
+    }
+
+    const char *Data(void) const
+    {
+        return data_;
+    }
+
+    // 由两个64位的半边混合而成，供哈希表使用
+    uint32_t Hash(void) const
+    {
+        uint64_t lo, hi;
+        std::memcpy(&lo, data_, 8);
+        std::memcpy(&hi, data_ + 8, 8);
+        const uint64_t h = (lo ^ (hi * 0x9e3779b97f4a7c15ull)) * 0xff51afd7ed558ccdull;
+        return static_cast<uint32_t>(h >> 32);
+    }
+
+    friend bool operator==(const Name &a, const Name &b)
+    {
+#if defined(__SSE2__)
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(a.Load(), b.Load())) == 0xffff;
+#else
+        return std::memcmp(a.data_, b.data_, CAPACITY) == 0;
+#endif
+    }
+
+    friend bool operator!=(const Name &a, const Name &b)
+    {
+        return !(a == b);
+    }
+
+private:
+
+#if defined(__SSE2__)
+    __m128i Load(void) const
+    {
+        return _mm_load_si128(reinterpret_cast<const __m128i*>(data_));
+    }
+#endif
+
+    // 从第CAPACITY - length个字节起读16字节，恰好得到前length个字节为0xff的掩码
+    static constexpr unsigned char LENGTH_MASKS[CAPACITY * 2] =
+    {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    };
+
+    char data_[CAPACITY];
+};
+
+static_assert(sizeof(Name) == Name::CAPACITY, "Name must stay 16 bytes");
+
+inline std::ostream &operator<<(std::ostream &out, const Name &name)
+{
+    return out << name.View();
+}
+
+#endif // NAME_H
@@ -0,0 +1,86 @@
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "OutputFile.h"
+
+OutputFile::OutputFile(void)
+    : fd_(-1), target_(nullptr), failed_(false), buf_(BUFFER_SIZE), pos_(0)
+{
+
+}
+
+OutputFile::~OutputFile(void)
+{
+    Close();
+}
+
+bool OutputFile::Open(const std::string &filename)
+{
+    Close();
+    fd_ = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    failed_ = fd_ < 0;
+    pos_ = 0;
+    return !failed_;
+}
+
+void OutputFile::OpenString(std::string &target)
+{
+    Close();
+    target_ = &target;
+    failed_ = false;
+    pos_ = 0;
+}
+
+bool OutputFile::Close(void)
+{
+    if(target_)
+    {
+        Flush();
+        target_ = nullptr;
+        return true;
+    }
+    if(fd_ < 0)
+        return !failed_;
+    Flush();
+    if(close(fd_) != 0)
+        failed_ = true;
+    fd_ = -1;
+    return !failed_;
+}
+
+void OutputFile::Flush(void)
+{
+    WriteAll(buf_.data(), pos_);
+    pos_ = 0;
+}
+
+void OutputFile::WriteAll(const char *data, size_t size)
+{
+    if(target_)
+    {
+        target_->append(data, size);
+        return;
+    }
+
+    // 没有打开的文件时丢弃内容，只记录失败
+    if(fd_ < 0)
+    {
+        failed_ = true;
+        return;
+    }
+    while(size)
+    {
+        const ssize_t n = write(fd_, data, size);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+        {
+            failed_ = true;
+            return;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef OUTPUTFILE_H
+#define OUTPUTFILE_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 带缓冲的输出文件，与SourceFile相对
+// 内容先格式化到一块大缓冲区中，写满或关闭时才整块交给write，不存在逐行的刷新；
+// 缓冲区在Close之后保留，同一个对象依次写多个文件时不再重新分配
+// 也可以输出到内存中的字符串，用于不落盘的场合（如编译服务的回复）
+class OutputFile
+{
+public:
+
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    OutputFile(void);
+
+    ~OutputFile(void);
+
+    OutputFile(const OutputFile &) = delete;
+    OutputFile &operator=(const OutputFile &) = delete;
+
+    // 创建或截断filename，之前打开的文件会先被关闭
+    bool Open(const std::string &filename);
+
+    // 改为追加到target的末尾，target需存活至Close
+    void OpenString(std::string &target);
+
+    // 写出缓冲区中剩余的内容并关闭文件，返回自Open以来的全部写入是否成功
+    bool Close(void);
+
+    void Put(char c)
+    {
+        if(pos_ == buf_.size())
+            Flush();
+        buf_[pos_++] = c;
+    }
+
+    void Put(std::string_view str)
+    {
+        if(buf_.size() - pos_ < str.size())
+        {
+            Flush();
+            if(str.size() > buf_.size())
+            {
+                WriteAll(str.data(), str.size());
+                return;
+            }
+        }
+        std::memcpy(buf_.data() + pos_, str.data(), str.size());
+        pos_ += str.size();
+    }
+
+    // 右对齐至width列，与setw相同，超出时不截断
+    void PutPadded(std::string_view str, size_t width)
+    {
+        const size_t pad = str.size() < width ? width - str.size() : 0;
+        if(buf_.size() - pos_ < pad + str.size())
+            Flush();
+        if(buf_.size() < pad + str.size())
+        {
+            for(size_t i = 0; i < pad; ++i)
+                Put(' ');
+            Put(str);
+            return;
+        }
+        std::memset(buf_.data() + pos_, ' ', pad);
+        std::memcpy(buf_.data() + pos_ + pad, str.data(), str.size());
+        pos_ += pad + str.size();
+    }
+
+    template<typename T>
+    void PutInt(T value)
+    {
+        // 64位整数的十进制表示连同符号不超过20个字符
+        if(buf_.size() - pos_ < 24)
+            Flush();
+        pos_ = std::to_chars(buf_.data() + pos_, buf_.data() + buf_.size(), value).ptr
+               - buf_.data();
+    }
+
+private:
+
+    void Flush(void);
+
+    void WriteAll(const char *data, size_t size);
+
+    int fd_;
+    std::string *target_;
+    bool failed_;
+
+    std::vector<char> buf_;
+    size_t pos_;
+};
+
+#endif // OUTPUTFILE_H
@@ -0,0 +1,101 @@
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "SourceFile.h"
+
+SourceFile::SourceFile(void)
+    : map_(nullptr), mapSize_(0), tooLarge_(false)
+{
+    Assign("", 0);
+}
+
+SourceFile::~SourceFile(void)
+{
+    Close();
+}
+
+void SourceFile::Close(void)
+{
+    if(map_)
+    {
+        munmap(map_, mapSize_);
+        map_ = nullptr;
+        mapSize_ = 0;
+    }
+}
+
+bool SourceFile::Open(const std::string &filename)
+{
+    tooLarge_ = false;
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        close(fd);
+        return false;
+    }
+    if(static_cast<uintmax_t>(st.st_size) > MAX_SIZE)
+    {
+        close(fd);
+        tooLarge_ = true;
+        return false;
+    }
+
+    Close();
+    const size_t size = static_cast<size_t>(st.st_size);
+
+    // mmap保证文件末页中超出文件长度的部分被填充为0
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t tail = size % pageSize;
+    if(tail && pageSize - tail >= PADDING)
+    {
+        void *m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(m != MAP_FAILED)
+        {
+            madvise(m, size, MADV_SEQUENTIAL);
+            close(fd);
+
+            map_ = m;
+            mapSize_ = size;
+            data_ = static_cast<const char*>(m);
+            size_ = size;
+            buf_ = std::vector<char>();
+            return true;
+        }
+    }
+
+    buf_.assign(size + PADDING, '\0');
+    size_t done = 0;
+    while(done < size)
+    {
+        ssize_t n = read(fd, buf_.data() + done, size - done);
+        if(n <= 0)
+            break;
+        done += static_cast<size_t>(n);
+    }
+    close(fd);
+
+    data_ = buf_.data();
+    size_ = done;
+    return done == size;
+}
+
+bool SourceFile::Assign(const char *data, size_t size)
+{
+    Close();
+    tooLarge_ = size > MAX_SIZE;
+    if(tooLarge_)
+        size = 0;
+    buf_.assign(size + PADDING, '\0');
+    std::memcpy(buf_.data(), data, size);
+    data_ = buf_.data();
+    size_ = size;
+    return !tooLarge_;
+}
@@ -0,0 +1,68 @@
+#ifndef SOURCEFILE_H
+#define SOURCEFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 只读的源文件内容
+// 文件内容之后保证至少有PADDING个'\0'字节，词法分析器可以把'\0'当作结束哨兵，
+// 并且可以放心地越过文件末尾读取一小段数据
+class SourceFile
+{
+public:
+
+    static constexpr size_t PADDING = 64;
+
+    // 词法单元以32位偏移寻址源代码，更长的源代码无法分析
+    static constexpr size_t MAX_SIZE = UINT32_MAX;
+
+    SourceFile(void);
+
+    ~SourceFile(void);
+
+    SourceFile(const SourceFile &) = delete;
+    SourceFile &operator=(const SourceFile &) = delete;
+
+    // 若文件末页剩余的空间足以容纳哨兵，则直接把文件映射到内存；
+    // 否则一次性把整个文件读入带有填充的缓冲区
+    // 文件长度超过MAX_SIZE时失败，此时TooLarge()返回true
+    bool Open(const std::string &filename);
+
+    // 从内存中的字符串构造，内容会被复制到带有填充的缓冲区
+    // 长度超过MAX_SIZE时失败，内容变为空串
+    bool Assign(const char *data, size_t size);
+
+    // 上一次Open或Assign是否因为长度超过MAX_SIZE而失败
+    bool TooLarge(void) const
+    {
+        return tooLarge_;
+    }
+
+    const char *Data(void) const
+    {
+        return data_;
+    }
+
+    size_t Size(void) const
+    {
+        return size_;
+    }
+
+private:
+
+    void Close(void);
+
+    const char *data_;
+    size_t size_;
+
+    void *map_;
+    size_t mapSize_;
+
+    std::vector<char> buf_;
+
+    bool tooLarge_;
+};
+
+#endif // SOURCEFILE_H
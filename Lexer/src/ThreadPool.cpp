@@ -0,0 +1,122 @@
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+namespace
+{
+    // 当前线程所属的线程池及其中的编号
+    thread_local const ThreadPool *currentPool = nullptr;
+    thread_local size_t currentIndex = ThreadPool::NO_WORKER;
+}
+
+ThreadPool::ThreadPool(size_t threadCount)
+    : queued_(0), unfinished_(0), next_(0), stop_(false)
+{
+    if(!threadCount)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, MAX_THREADS);
+    for(size_t i = 0; i < threadCount; ++i)
+        queues_.emplace_back(new Queue);
+    for(size_t i = 0; i < threadCount; ++i)
+        workers_.emplace_back(&ThreadPool::WorkerMain, this, i);
+}
+
+ThreadPool::~ThreadPool(void)
+{
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stop_ = true;
+    }
+    taskCond_.notify_all();
+    for(auto &w : workers_)
+        w.join();
+}
+
+size_t ThreadPool::Size(void) const
+{
+    return workers_.size();
+}
+
+size_t ThreadPool::CurrentWorker(void) const
+{
+    return currentPool == this ? currentIndex : NO_WORKER;
+}
+
+void ThreadPool::Submit(Task task)
+{
+    size_t index = CurrentWorker();
+    if(index == NO_WORKER)
+        index = next_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+
+    // 计数先于入队增加，取走任务时的减少总在其后；之后在mutex_下通知，正要睡眠的工作线程不会错过这个任务
+    ++unfinished_;
+    ++queued_;
+    {
+        std::lock_guard<std::mutex> lk(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+    }
+    taskCond_.notify_one();
+}
+
+void ThreadPool::Wait(void)
+{
+    std::unique_lock<std::mutex> lk(mutex_);
+    idleCond_.wait(lk, [&] { return !unfinished_; });
+}
+
+bool ThreadPool::TryPop(size_t index, Task &task)
+{
+    const size_t n = queues_.size();
+    for(size_t k = 0; k < n; ++k)
+    {
+        Queue &q = *queues_[(index + k) % n];
+        std::lock_guard<std::mutex> lk(q.mutex);
+        if(q.tasks.empty())
+            continue;
+        if(k == 0)
+        {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+        }
+        --queued_;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::WorkerMain(size_t index)
+{
+    currentPool = this;
+    currentIndex = index;
+
+    for(;;)
+    {
+        Task task;
+        if(!TryPop(index, task))
+        {
+            // 计数不为0而没有取到，说明任务刚被其他线程拿走或还没放进队列，重试即可
+            std::unique_lock<std::mutex> lk(mutex_);
+            taskCond_.wait(lk, [&] { return stop_ || queued_; });
+            if(stop_ && !queued_)
+                return;
+            continue;
+        }
+
+        task();
+        task = nullptr;
+
+        if(--unfinished_ == 0)
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            idleCond_.notify_all();
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 固定数量工作线程的线程池
+// 每个工作线程有自己的任务队列：工作线程提交的任务进入自己的队列，其他线程提交的任务轮流分给各队列；
+// 工作线程从自己队列的尾部取任务（后进先出），自己的队列空了再从其他队列的头部窃取（先进先出）
+class ThreadPool
+{
+public:
+
+    using Task = std::function<void()>;
+
+    // 当前线程不是本线程池的工作线程
+    static constexpr size_t NO_WORKER = SIZE_MAX;
+
+    // 线程数的上限，更多的线程只会增加切换的开销
+    static constexpr size_t MAX_THREADS = 256;
+
+    // threadCount为0时使用硬件线程数，超过MAX_THREADS时按MAX_THREADS
+    explicit ThreadPool(size_t threadCount = 0);
+
+    ~ThreadPool(void);
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t Size(void) const;
+
+    void Submit(Task task);
+
+    // 阻塞直到所有已提交的任务执行完毕
+    void Wait(void);
+
+    // 当前线程在本线程池中的编号，属于[0, Size())，供任务按线程复用各自的状态
+    size_t CurrentWorker(void) const;
+
+private:
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void WorkerMain(size_t index);
+
+    // 先取自己队列的尾部，再依次窃取其他队列的头部
+    bool TryPop(size_t index, Task &task);
+
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<Queue>> queues_;
+
+    // 只用于空闲工作线程的睡眠和Wait，取放任务不经过它
+    std::mutex mutex_;
+    std::condition_variable taskCond_;
+    std::condition_variable idleCond_;
+
+    // 还在队列中的任务数，以及已提交而没有执行完的任务数
+    std::atomic<size_t> queued_;
+    std::atomic<size_t> unfinished_;
+
+    // 非工作线程提交任务时轮流选择的队列
+    std::atomic<size_t> next_;
+
+    bool stop_;
+};
+
+#endif // THREADPOOL_H
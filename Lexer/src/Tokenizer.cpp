@@ -0,0 +1,481 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "CharScan.h"
+#include "Tokenizer.h"
+
+namespace
+{
+    // 字符类别。DFA的状态转移表以字符类别而非原始字节为列，
+    // 这样256个字节值被压缩为少数几列，转移表可以整个放进一两条缓存行
+    enum CharClass : uint8_t
+    {
+        C_OTHER,
+        C_SPACE,   // 除换行外的空白字符
+        C_NEWLINE,
+        C_NUL,
+        C_ZERO,
+        C_DIGIT,   // 1-9
+        C_ALPHA,   // 字母和下划线
+        C_LESS,
+        C_GREATER,
+        C_COLON,
+        C_EQUAL,
+        C_SEMI,
+        C_LBRAC,
+        C_RBRAC,
+        C_MINUS,
+        C_TIMES,
+
+        CHAR_CLASS_COUNT
+    };
+
+    // DFA状态。S_DONE表示无法继续转移，此时停留的状态即为识别结果
+    enum State : uint8_t
+    {
+        S_START,
+        S_IDENT,
+        S_NUMBER,
+        S_ZERO,
+        S_LESS,
+        S_LESS_EQ,
+        S_NOT_EQ,
+        S_GREATER,
+        S_GREATER_EQ,
+        S_COLON,
+        S_ASSIGN,
+        S_EQUAL,
+        S_SEMI,
+        S_LBRAC,
+        S_RBRAC,
+        S_MINUS,
+        S_TIMES,
+
+        S_DONE,
+        STATE_COUNT = S_DONE
+    };
+
+    constexpr std::array<uint8_t, 256> MakeCharClassTable(void)
+    {
+        std::array<uint8_t, 256> t = { };
+        for(int c = 0; c < 256; ++c)
+            t[c] = C_OTHER;
+
+        // 与C locale下的std::isspace一致
+        t[' '] = t['\t'] = t['\v'] = t['\f'] = t['\r'] = C_SPACE;
+        t['\n'] = C_NEWLINE;
+        t['\0'] = C_NUL;
+
+        t['0'] = C_ZERO;
+        for(int c = '1'; c <= '9'; ++c)
+            t[c] = C_DIGIT;
+        for(int c = 'a'; c <= 'z'; ++c)
+            t[c] = C_ALPHA;
+        for(int c = 'A'; c <= 'Z'; ++c)
+            t[c] = C_ALPHA;
+        t['_'] = C_ALPHA;
+
+        t['<'] = C_LESS;
+        t['>'] = C_GREATER;
+        t[':'] = C_COLON;
+        t['='] = C_EQUAL;
+        t[';'] = C_SEMI;
+        t['('] = C_LBRAC;
+        t[')'] = C_RBRAC;
+        t['-'] = C_MINUS;
+        t['*'] = C_TIMES;
+
+        return t;
+    }
+
+    using TransitionTable = std::array<std::array<uint8_t, CHAR_CLASS_COUNT>, STATE_COUNT>;
+
+    constexpr TransitionTable MakeTransitionTable(void)
+    {
+        TransitionTable t = { };
+        for(int s = 0; s < STATE_COUNT; ++s)
+        {
+            for(int c = 0; c < CHAR_CLASS_COUNT; ++c)
+                t[s][c] = S_DONE;
+        }
+
+        t[S_START][C_ZERO]    = S_ZERO;
+        t[S_START][C_DIGIT]   = S_NUMBER;
+        t[S_START][C_ALPHA]   = S_IDENT;
+        t[S_START][C_LESS]    = S_LESS;
+        t[S_START][C_GREATER] = S_GREATER;
+        t[S_START][C_COLON]   = S_COLON;
+        t[S_START][C_EQUAL]   = S_EQUAL;
+        t[S_START][C_SEMI]    = S_SEMI;
+        t[S_START][C_LBRAC]   = S_LBRAC;
+        t[S_START][C_RBRAC]   = S_RBRAC;
+        t[S_START][C_MINUS]   = S_MINUS;
+        t[S_START][C_TIMES]   = S_TIMES;
+
+        t[S_IDENT][C_ZERO]  = S_IDENT;
+        t[S_IDENT][C_DIGIT] = S_IDENT;
+        t[S_IDENT][C_ALPHA] = S_IDENT;
+
+        t[S_NUMBER][C_ZERO]  = S_NUMBER;
+        t[S_NUMBER][C_DIGIT] = S_NUMBER;
+
+        t[S_LESS][C_EQUAL]    = S_LESS_EQ;
+        t[S_LESS][C_GREATER]  = S_NOT_EQ;
+        t[S_GREATER][C_EQUAL] = S_GREATER_EQ;
+        t[S_COLON][C_EQUAL]   = S_ASSIGN;
+
+        return t;
+    }
+
+    constexpr std::array<uint8_t, 256> CHAR_CLASS = MakeCharClassTable();
+    constexpr TransitionTable TRANSITION = MakeTransitionTable();
+
+    // 符号类终态对应的词法单元类型，非符号状态不使用该表
+    constexpr TokenType SYMBOL_TYPE[STATE_COUNT] =
+    {
+        TokenType::EndMark,      // S_START
+        TokenType::Identifier,   // S_IDENT
+        TokenType::IntLiteral,   // S_NUMBER
+        TokenType::IntLiteral,   // S_ZERO
+        TokenType::Less,         // S_LESS
+        TokenType::LessEqual,    // S_LESS_EQ
+        TokenType::NotEqual,     // S_NOT_EQ
+        TokenType::Greater,      // S_GREATER
+        TokenType::GreaterEqual, // S_GREATER_EQ
+        TokenType::EndMark,      // S_COLON
+        TokenType::Assign,       // S_ASSIGN
+        TokenType::Equal,        // S_EQUAL
+        TokenType::Semicolon,    // S_SEMI
+        TokenType::LeftBrac,     // S_LBRAC
+        TokenType::RightBrac,    // S_RBRAC
+        TokenType::Minus,        // S_MINUS
+        TokenType::Times,        // S_TIMES
+    };
+
+    inline bool IsIdentChar(char c)
+    {
+        uint8_t cls = CHAR_CLASS[static_cast<uint8_t>(c)];
+        return cls == C_ALPHA || cls == C_ZERO || cls == C_DIGIT;
+    }
+
+    // 关键字的完美哈希：(首字符 + 尾字符) mod 16 在全部9个关键字上恰好互不冲突，
+    // 查找时只需一次取表和一次定长比较
+    struct Keyword
+    {
+        const char *str;
+        int len;
+        TokenType type;
+    };
+
+    constexpr Keyword KEYWORDS[] =
+    {
+        { "integer",  7, TokenType::Integer  },
+        { "begin",    5, TokenType::Begin    },
+        { "end",      3, TokenType::End      },
+        { "if",       2, TokenType::If       },
+        { "then",     4, TokenType::Then     },
+        { "else",     4, TokenType::Else     },
+        { "function", 8, TokenType::Function },
+        { "read",     4, TokenType::Read     },
+        { "write",    5, TokenType::Write    }
+    };
+
+    constexpr int KEYWORD_HASH_SIZE = 16;
+
+    constexpr int KeywordHash(char first, char last)
+    {
+        return (static_cast<uint8_t>(first) + static_cast<uint8_t>(last))
+             & (KEYWORD_HASH_SIZE - 1);
+    }
+
+    // 槽位中存放关键字下标+1，0表示空槽
+    constexpr std::array<uint8_t, KEYWORD_HASH_SIZE> MakeKeywordHashTable(void)
+    {
+        std::array<uint8_t, KEYWORD_HASH_SIZE> t = { };
+        for(size_t i = 0; i < sizeof(KEYWORDS) / sizeof(KEYWORDS[0]); ++i)
+        {
+            const Keyword &kw = KEYWORDS[i];
+            int h = KeywordHash(kw.str[0], kw.str[kw.len - 1]);
+            t[h] = t[h] ? 0xff : static_cast<uint8_t>(i + 1);
+        }
+        return t;
+    }
+
+    constexpr std::array<uint8_t, KEYWORD_HASH_SIZE> KEYWORD_HASH = MakeKeywordHashTable();
+
+    constexpr bool IsPerfectHash(void)
+    {
+        for(uint8_t slot : KEYWORD_HASH)
+        {
+            if(slot == 0xff)
+                return false;
+        }
+        return true;
+    }
+
+    static_assert(IsPerfectHash(), "keyword hash collision");
+
+    inline TokenType LookupKeyword(const char *s, size_t len)
+    {
+        if(len < 2 || len > 8)
+            return TokenType::Identifier;
+        uint8_t slot = KEYWORD_HASH[KeywordHash(s[0], s[len - 1])];
+        if(!slot)
+            return TokenType::Identifier;
+        const Keyword &kw = KEYWORDS[slot - 1];
+        if(static_cast<size_t>(kw.len) == len && std::memcmp(kw.str, s, len) == 0)
+            return kw.type;
+        return TokenType::Identifier;
+    }
+}
+
+Tokenizer::Tokenizer(const char *src, size_t size, const std::string &filename)
+    : src_(src), size_(size), idx_(0), limit_(size), filename_(filename), line_(1),
+      lexOnly_(false)
+{
+    
+}
+
+void Tokenizer::Reset(const char *src, size_t size, const std::string &filename)
+{
+    src_ = src;
+    size_ = size;
+    idx_ = 0;
+    limit_ = size;
+    filename_ = filename;
+    line_ = 1;
+    lexOnly_ = false;
+}
+
+void Tokenizer::SetRange(size_t begin, size_t end, int firstLine)
+{
+    idx_ = begin;
+    limit_ = end;
+    line_ = firstLine;
+}
+
+// 跳过从src[idx]起的空白字符，其中的换行符记录到buf的行首偏移表中
+void Tokenizer::SkipWhitespaces(TokenStream &buf)
+{
+    size_t len = std::min(ScanBlank(src_ + idx_), limit_ - idx_);
+    if(len)
+    {
+        line_ += static_cast<int>(FindNewlines(
+            src_ + idx_, len, static_cast<uint32_t>(idx_), buf.LineStarts()));
+        idx_ += len;
+    }
+}
+
+// 从src[idx]开始，返回下一个词法单元，调用前需跳过空白字符
+Token Tokenizer::NextToken(void)
+{
+    using namespace std;
+
+    // 结束标志，即源代码之后的哨兵
+    if(src_[idx_] == '\0')
+        return Token{ TokenType::EndMark, TokenizerErrorCode::None, "EOF", 0 };
+
+    // 按最长匹配原则运行DFA，直到无法转移为止
+    const size_t start = idx_;
+    uint8_t state = S_START;
+    for(;;)
+    {
+        uint8_t next = TRANSITION[state][CHAR_CLASS[static_cast<uint8_t>(src_[idx_])]];
+        if(next == S_DONE)
+            break;
+        state = next;
+        ++idx_;
+
+        // 标识符和数字的剩余部分直接整块扫描，扫描结束后DFA必然无法再转移
+        if(state == S_IDENT)
+        {
+            idx_ += ScanIdent(src_ + idx_);
+            break;
+        }
+        if(state == S_NUMBER)
+        {
+            idx_ += ScanDigits(src_ + idx_);
+            break;
+        }
+    }
+
+    const string_view str(src_ + start, idx_ - start);
+
+    switch(state)
+    {
+    case S_START:
+        // 无法识别的字符，跳过它继续分析
+        ++idx_;
+        return Token{ TokenType::EndMark, TokenizerErrorCode::UnknownToken,
+                      string_view(src_ + start, 1), 0 };
+
+    case S_COLON:
+        // 单独的':'不是合法符号，它已被DFA吞掉，因此无需再跳过
+        return Token{ TokenType::EndMark, TokenizerErrorCode::UnknownToken, str, 0 };
+
+    case S_ZERO:
+        // 0打头的只能有一个数字，后面不能跟数字字母下划线
+        if(IsIdentChar(src_[idx_]))
+            return Token{ TokenType::IntLiteral, TokenizerErrorCode::InvalidIntLiteral, str, 0 };
+        return Token{ TokenType::IntLiteral, TokenizerErrorCode::None, str, 0 };
+
+    case S_NUMBER:
+    {
+        // 整形字面量，按2^32取模解出数值
+        unsigned int value = 0;
+        if(!lexOnly_)
+        {
+            for(char c : str)
+                value = value * 10 + static_cast<unsigned int>(c - '0');
+        }
+        return Token{ TokenType::IntLiteral, TokenizerErrorCode::None,
+                      str, static_cast<int>(value) };
+    }
+
+    case S_IDENT:
+        // 标识符 & 关键字
+        if(str.length() > MAX_IDENTIFIER_LENGTH)
+            return Token{ TokenType::Identifier, TokenizerErrorCode::NameTooLong, str, 0 };
+        return Token{ LookupKeyword(str.data(), str.length()),
+                      TokenizerErrorCode::None, str, 0 };
+
+    default:
+        // 符号
+        return Token{ SYMBOL_TYPE[state], TokenizerErrorCode::None, str, 0 };
+    }
+}
+
+Tokenizer::TokenStream Tokenizer::Tokenize(std::vector<TokenizerError> &errs)
+{
+    TokenStream rt(src_);
+    rt.Reserve(size_ / 4);
+    Fill(rt, SIZE_MAX, errs);
+    return rt;
+}
+
+bool Tokenizer::Fill(TokenStream &buf, size_t maxCount,
+                     std::vector<TokenizerError> &errs)
+{
+    for(size_t count = 0; count < maxCount;)
+    {
+        SkipWhitespaces(buf);
+        if(idx_ >= limit_ && limit_ < size_)
+            return false;
+
+        const Token tok = NextToken();
+        const uint32_t offset = static_cast<uint32_t>(tok.tokenStr.data() - src_);
+        const uint32_t length = static_cast<uint32_t>(tok.tokenStr.length());
+
+        if(tok.error != TokenizerErrorCode::None)
+        {
+            errs.push_back(TokenizerError{ tok.error, line_, offset, length });
+            continue;
+        }
+
+        if(tok.type == TokenType::EndMark)
+        {
+            buf.Push(TokenType::EndMark, static_cast<uint32_t>(idx_), 0, 0);
+            return true;
+        }
+
+        buf.Push(tok.type, offset, length, tok.value);
+        ++count;
+    }
+
+    return false;
+}
+
+Tokenizer::TokenStream Tokenizer::TokenizeParallel(ThreadPool &pool,
+                                                   std::vector<TokenizerError> &errs)
+{
+    // 每个线程分得若干段，以便负载不均时能够相互弥补
+    // 太小的段不值得并行
+    constexpr size_t MIN_CHUNK_SIZE = 1 << 16;
+    const size_t chunkSize = std::max(MIN_CHUNK_SIZE, size_ / (pool.Size() * 4) + 1);
+
+    std::vector<size_t> bounds = { 0 };
+    while(bounds.back() < size_)
+    {
+        size_t end = bounds.back() + chunkSize;
+        if(end >= size_)
+        {
+            bounds.push_back(size_);
+            break;
+        }
+        const void *nl = std::memchr(src_ + end, '\n', size_ - end);
+        bounds.push_back(nl ? static_cast<const char*>(nl) - src_ + 1 : size_);
+    }
+    if(bounds.size() == 1)
+        bounds.push_back(0);
+
+    struct Chunk
+    {
+        TokenStream toks;
+        std::vector<TokenizerError> errs;
+        bool reachedEnd;
+    };
+    const size_t chunkCount = bounds.size() - 1;
+    std::vector<Chunk> chunks(chunkCount, Chunk{ TokenStream(src_), { }, false });
+
+    for(size_t i = 0; i < chunkCount; ++i)
+    {
+        pool.Submit([this, i, &bounds, &chunks]
+        {
+            // 各段的行号先从1开始计，拼接时再修正
+            Tokenizer sub(src_, size_, filename_);
+            sub.SetRange(bounds[i], bounds[i + 1], 1);
+            sub.SetLexOnly(lexOnly_);
+            chunks[i].toks.Reserve((bounds[i + 1] - bounds[i]) / 4);
+            chunks[i].reachedEnd = sub.Fill(chunks[i].toks, SIZE_MAX, chunks[i].errs);
+        });
+    }
+    pool.Wait();
+
+    TokenStream rt(src_);
+    size_t tokenCount = 0, lineCount = 0;
+    for(auto &c : chunks)
+    {
+        tokenCount += c.toks.Size();
+        lineCount += c.toks.LineStarts().size() - 1;
+    }
+    rt.Reserve(tokenCount, lineCount);
+
+    // 源代码中间的'\0'同样是结束标志，其后的段全部丢弃
+    int firstLine = 1;
+    for(auto &c : chunks)
+    {
+        for(auto &e : c.errs)
+        {
+            e.line += firstLine - 1;
+            errs.push_back(e);
+        }
+        rt.Append(c.toks);
+        firstLine += static_cast<int>(c.toks.LineStarts().size()) - 1;
+        if(c.reachedEnd)
+            break;
+    }
+
+    idx_ = size_;
+    line_ = firstLine;
+    return rt;
+}
+
+std::string TokenizerError::Message(const char *src) const
+{
+    const std::string str(src + offset, length);
+    switch(code)
+    {
+    case TokenizerErrorCode::UnknownToken:
+        return "unknown token " + str;
+    case TokenizerErrorCode::InvalidIntLiteral:
+        return "invalid integer literal";
+    case TokenizerErrorCode::NameTooLong:
+        return "name length limit exceeded: " + str;
+    default:
+        return str;
+    }
+}
@@ -0,0 +1,329 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Name.h"
+#include "ThreadPool.h"
+
+enum class TokenType
+{
+    // 关键字
+    Integer      = 3,
+    Begin        = 1,
+    End          = 2,
+    If           = 4,
+    Then         = 5,
+    Else         = 6,
+    Function     = 7,
+    Read         = 8,
+    Write        = 9,
+
+    // 符号
+    Semicolon    = 23,
+    LeftBrac     = 21,
+    RightBrac    = 22,
+    LessEqual    = 14,
+    Minus        = 18,
+    Times        = 19,
+    Assign       = 20,
+    Equal        = 12,
+    NotEqual     = 13,
+    Less         = 15,
+    GreaterEqual = 16,
+    Greater      = 17,
+
+    // 换行
+    NewLine      = 24,
+
+    // 标识符和整数字面量
+    Identifier   = 10,
+    IntLiteral   = 11,
+
+    // 结束标志
+    EndMark = 25
+};
+
+// 枚举值即为词法单元在dyd文件中的种别码，输出时查下表得到补零后的两位文本，
+// 表在编译期生成，输出循环中无需任何查找或格式化
+constexpr int TOKEN_CODE_COUNT = static_cast<int>(TokenType::EndMark) + 1;
+
+using TokenCodeTable = std::array<std::array<char, 2>, TOKEN_CODE_COUNT>;
+
+constexpr TokenCodeTable MakeTokenCodeTable(void)
+{
+    TokenCodeTable t = { };
+    for(int i = 0; i < TOKEN_CODE_COUNT; ++i)
+    {
+        t[i][0] = static_cast<char>('0' + i / 10);
+        t[i][1] = static_cast<char>('0' + i % 10);
+    }
+    return t;
+}
+
+constexpr TokenCodeTable TOKEN_CODES = MakeTokenCodeTable();
+
+constexpr std::string_view TokenCode(TokenType type)
+{
+    return std::string_view(TOKEN_CODES[static_cast<int>(type)].data(), 2);
+}
+
+static_assert(TokenCode(TokenType::Begin) == "01" &&
+              TokenCode(TokenType::EndMark) == "25", "token code table");
+
+constexpr int MAX_IDENTIFIER_LENGTH = 16;
+
+static_assert(Name::CAPACITY == MAX_IDENTIFIER_LENGTH, "names must fit in a Name");
+
+enum class TokenizerErrorCode : uint8_t
+{
+    None,
+    UnknownToken,
+    InvalidIntLiteral,
+    NameTooLong
+};
+
+struct Token
+{
+    TokenType type;
+
+    // 若不为None，则该词法单元是一个词法错误，tokenStr为出错的源代码片段
+    TokenizerErrorCode error;
+
+    // 指向Tokenizer持有的源代码（或静态字符串），不单独分配内存
+    std::string_view tokenStr;
+
+    // 整形字面量的值，在词法分析时一次性解出
+    int value;
+};
+
+// 连续存放的词法单元序列，按字段拆成若干个紧凑数组（结构数组）
+// 换行不作为词法单元保存，而是记录在单独的行首偏移表中，
+// 词法单元所在的行号通过在该表中二分查找得到
+class TokenBuffer
+{
+public:
+
+    explicit TokenBuffer(const char *src = nullptr)
+        : src_(src), firstLine_(1), lineStarts_(1, 0)
+    {
+
+    }
+
+    // 把另一段源代码的分析结果接在后面，other中的偏移必须都位于本序列之后
+    // other的行首偏移表第0项仅表示它的起始行，不会被复制
+    void Append(const TokenBuffer &other)
+    {
+        types_.insert(types_.end(), other.types_.begin(), other.types_.end());
+        offsets_.insert(offsets_.end(), other.offsets_.begin(), other.offsets_.end());
+        lengths_.insert(lengths_.end(), other.lengths_.begin(), other.lengths_.end());
+        values_.insert(values_.end(), other.values_.begin(), other.values_.end());
+        lineStarts_.insert(lineStarts_.end(), other.lineStarts_.begin() + 1, other.lineStarts_.end());
+    }
+
+    // 清空词法单元但保留容量，用于流式分析时复用同一个窗口
+    // 行首偏移表只保留当前所在行，使后续窗口的行号保持连续
+    void Recycle(void)
+    {
+        types_.clear();
+        offsets_.clear();
+        lengths_.clear();
+        values_.clear();
+
+        firstLine_ += static_cast<int>(lineStarts_.size()) - 1;
+        lineStarts_.erase(lineStarts_.begin(), lineStarts_.end() - 1);
+    }
+
+    // 清空全部内容但保留容量，改为引用另一段源代码，用于依次分析多个文件时复用同一个序列
+    void Reset(const char *src)
+    {
+        src_ = src;
+        firstLine_ = 1;
+        types_.clear();
+        offsets_.clear();
+        lengths_.clear();
+        values_.clear();
+        lineStarts_.assign(1, 0);
+    }
+
+    void Reserve(size_t tokenCount, size_t lineCount = 0)
+    {
+        lineStarts_.reserve(lineCount + 1);
+        types_.reserve(tokenCount);
+        offsets_.reserve(tokenCount);
+        lengths_.reserve(tokenCount);
+        values_.reserve(tokenCount);
+    }
+
+    void Push(TokenType type, uint32_t offset, uint32_t length, int value)
+    {
+        types_.push_back(static_cast<uint8_t>(type));
+        offsets_.push_back(offset);
+        lengths_.push_back(length);
+        values_.push_back(value);
+    }
+
+    // 供Tokenizer追加新行的起始偏移，即换行符的下一个位置
+    std::vector<uint32_t> &LineStarts(void)
+    {
+        return lineStarts_;
+    }
+
+    size_t Size(void) const
+    {
+        return types_.size();
+    }
+
+    TokenType Type(size_t i) const
+    {
+        return static_cast<TokenType>(types_[i]);
+    }
+
+    uint32_t Offset(size_t i) const
+    {
+        return offsets_[i];
+    }
+
+    uint32_t Length(size_t i) const
+    {
+        return lengths_[i];
+    }
+
+    std::string_view Str(size_t i) const
+    {
+        if(Type(i) == TokenType::EndMark)
+            return "EOF";
+        return std::string_view(src_ + offsets_[i], lengths_[i]);
+    }
+
+    // 标识符的名字，直接从源代码中整块读出
+    Name NameAt(size_t i) const
+    {
+        return Name::FromPadded(src_ + offsets_[i], lengths_[i]);
+    }
+
+    int Value(size_t i) const
+    {
+        return values_[i];
+    }
+
+    int Line(size_t i) const
+    {
+        return LineAt(offsets_[i]);
+    }
+
+    // 源代码中offset处所在的行
+    int LineAt(uint32_t offset) const
+    {
+        return firstLine_ - 1 + static_cast<int>(std::upper_bound(
+            lineStarts_.begin(), lineStarts_.end(), offset) - lineStarts_.begin());
+    }
+
+    // 行首偏移表，第0项为第FirstLine()行的起始偏移
+    const std::vector<uint32_t> &LineStarts(void) const
+    {
+        return lineStarts_;
+    }
+
+    int FirstLine(void) const
+    {
+        return firstLine_;
+    }
+
+private:
+
+    const char *src_;
+    int firstLine_;
+
+    std::vector<uint8_t>  types_;
+    std::vector<uint32_t> offsets_;
+    std::vector<uint32_t> lengths_;
+    std::vector<int>      values_;
+
+    std::vector<uint32_t> lineStarts_;
+};
+
+// 用来表示词法分析错误
+// 词法错误直接以返回值的形式报告而不抛出异常，出错的源代码片段以偏移记录，
+// 错误信息文本仅在需要输出时才生成
+struct TokenizerError
+{
+    TokenizerErrorCode code;
+    int line;
+    uint32_t offset, length;
+
+    // src为产生该错误的Tokenizer所分析的源代码
+    std::string Message(const char *src) const;
+};
+
+class Tokenizer
+{
+public:
+    using TokenStream = TokenBuffer;
+
+    // src之后必须至少有一个'\0'作为结束哨兵（见SourceFile），
+    // 源代码以32位偏移寻址，长度不能超过4GB
+    // 词法分析直接在src上原地进行，src需存活至词法单元不再被使用
+    Tokenizer(const char *src, size_t size, const std::string &filename);
+
+    Tokenizer(const Tokenizer &) = delete;
+    Tokenizer &operator=(const Tokenizer &) = delete;
+
+    // 改为从头分析另一段源代码，要求与构造函数相同
+    void Reset(const char *src, size_t size, const std::string &filename);
+
+    TokenStream Tokenize(std::vector<TokenizerError> &errs);
+
+    // 把源代码在换行处切分成若干段，在线程池中并行分析后再拼接起来
+    // 语言中不存在跨行的词法单元，因此结果（包括错误的顺序）与Tokenize完全相同
+    TokenStream TokenizeParallel(ThreadPool &pool,
+                                 std::vector<TokenizerError> &errs);
+
+    // 继续分析，向buf追加至多maxCount个词法单元，遇到结束标志时停止
+    // 返回是否已经到达结束标志
+    bool Fill(TokenStream &buf, size_t maxCount,
+              std::vector<TokenizerError> &errs);
+
+    // 从begin开始分析，行号从firstLine开始计，到达end时停止
+    // end必须是某一行的开头（即紧跟在换行符之后）或源代码的末尾
+    void SetRange(size_t begin, size_t end, int firstLine);
+
+    // 仅做词法分析（只输出dyd）时不需要整形字面量的值，跳过数值的计算
+    void SetLexOnly(bool lexOnly)
+    {
+        lexOnly_ = lexOnly;
+    }
+
+    const char *Source(void) const
+    {
+        return src_;
+    }
+
+private:
+
+    void SkipWhitespaces(TokenStream &buf);
+
+    Token NextToken(void);
+
+private:
+
+    const char *src_;
+    size_t size_;
+    size_t idx_;
+
+    // 分析的终点，未经SetRange限制时为size_，即停在哨兵处
+    size_t limit_;
+
+    std::string filename_;
+    int line_;
+
+    bool lexOnly_;
+};
+
+#endif // TOKENIZER_H
@@ -0,0 +1,135 @@
+// 性能测试中需要在进程内计时的部分（由bench/bench.sh调用），每项报告多次运行中最快的一次
+// bench lex 源文件         词法分析，扫描器的实现可由环境变量PARSER_SCAN选择（见CharScan.cpp）
+// bench tokens 源文件      词法分析，与对其结果的语法分析，按每秒处理的词法单元数报告
+// bench ast 源文件         只做检查的语法分析，与同时构造语法树的语法分析
+// bench parse 源文件 [-ll]  对已经完成词法分析的词法单元进行语法分析，-ll为表驱动的LL(1)分析
+// bench dyd 源文件 .dyd文件 词法分析后语法分析，与解码.dyd后语法分析
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "CharScan.h"
+#include "DydFile.h"
+#include "Parser.h"
+#include "SourceFile.h"
+#include "Tokenizer.h"
+
+namespace
+{
+
+// 运行runs次fn，返回最短的耗时（毫秒）
+double Best(int runs, const std::function<void(void)> &fn)
+{
+    double best = 1e300;
+    for(int i = 0; i < runs; ++i)
+    {
+        const auto begin = std::chrono::steady_clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - begin).count());
+    }
+    return best;
+}
+
+Tokenizer::TokenStream Lex(const SourceFile &src)
+{
+    std::vector<TokenizerError> errs;
+    return Tokenizer(src.Data(), src.Size(), "bench").Tokenize(errs);
+}
+
+int Usage(void)
+{
+    std::printf("Usage: bench lex|tokens|ast filename\n"
+                "       bench parse filename [-ll]\n"
+                "       bench dyd filename dydfile\n");
+    return -1;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 3)
+        return Usage();
+    const std::string mode = argv[1];
+
+    SourceFile src;
+    if(!src.Open(argv[2]))
+    {
+        std::printf("Cannot open file: %s\n", argv[2]);
+        return -1;
+    }
+
+    if(mode == "lex")
+    {
+        size_t count = 0;
+        const double ms = Best(10, [&] { count = Lex(src).Size(); });
+        std::printf("lex (%s): %.1f ms, %zu tokens, %.0f MB/s\n",
+                    ScanImplName(), ms, count, src.Size() / ms / 1e3);
+    }
+    else if(mode == "tokens")
+    {
+        const Tokenizer::TokenStream toks = Lex(src);
+        const double lex = Best(10, [&] { Lex(src); });
+        const double parse = Best(10, [&] { Parser(toks, "bench").Parse(); });
+        std::printf("%zu tokens: lex %.1f ms (%.1f M tokens/s), parse %.1f ms (%.1f M tokens/s)\n",
+                    toks.Size(), lex, toks.Size() / lex / 1e3, parse, toks.Size() / parse / 1e3);
+    }
+    else if(mode == "ast")
+    {
+        const Tokenizer::TokenStream toks = Lex(src);
+        size_t nodes = 0;
+        const double check = Best(5, [&] { Parser(toks, "bench").Parse(); });
+        const double build = Best(5, [&]
+        {
+            Parser parser(toks, "bench");
+            parser.Parse(true);
+            nodes = parser.GetAst().Size();
+        });
+        std::printf("parse: %.1f ms without AST, %.1f ms with AST (+%.0f%%), %zu nodes\n",
+                    check, build, (build / check - 1) * 100, nodes);
+    }
+    else if(mode == "parse")
+    {
+        const bool tableDriven = argc > 3 && std::string(argv[3]) == "-ll";
+        const Tokenizer::TokenStream toks = Lex(src);
+        const double ms = Best(5, [&]
+        {
+            Parser parser(toks, "bench");
+            if(tableDriven)
+                parser.ParseLL();
+            else
+                parser.Parse();
+        });
+        std::printf("parse (%s): %.1f ms, %zu tokens\n",
+                    tableDriven ? "LL" : "recursive", ms, toks.Size());
+    }
+    else if(mode == "dyd" && argc > 3)
+    {
+        SourceFile dyd;
+        if(!dyd.Open(argv[3]))
+        {
+            std::printf("Cannot open file: %s\n", argv[3]);
+            return -1;
+        }
+        Tokenizer::TokenStream lexed(src.Data()), decoded(dyd.Data());
+        const double lex = Best(10, [&] { lexed = Lex(src); });
+        const double parseLexed = Best(10, [&] { Parser(lexed, "bench").Parse(); });
+        const double decode = Best(10, [&]
+        {
+            std::vector<TokenizerError> errs;
+            ReadDydTokens(dyd.Data(), dyd.Size(), decoded, errs);
+        });
+        const double parseDecoded = Best(10, [&] { Parser(decoded, "bench").Parse(); });
+        std::printf("lex source  %.1f ms, then parse %.1f ms\n"
+                    "decode .dyd %.1f ms, then parse %.1f ms\n",
+                    lex, parseLexed, decode, parseDecoded);
+    }
+    else
+        return Usage();
+    return 0;
+}
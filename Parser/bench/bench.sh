@@ -0,0 +1,115 @@
+#!/bin/bash
+# 性能测试：用bench/gen.py生成的程序重现各项优化报告的测量结果
+# 用法：bench/bench.sh 构建目录 词法分析器路径
+# 构建目录中应有parser、bench（见bench/Bench.cpp）和inctest（见tests/IncrementalTest.cpp）
+# 环境变量BASELINE、BASELINE_TOKENIZER给出另一个（例如由较早的提交编译的）分析器、词法分析器时，
+# 端到端的各项同时报告它们的耗时
+# 测量值取决于机器，各项之间的相对关系才有意义
+
+BUILD=$(realpath "$1")
+PARSER=$BUILD/parser
+BENCH=$BUILD/bench
+INCTEST=$BUILD/inctest
+TOKENIZER=$(realpath "$2")
+BASELINE=${BASELINE:+$(realpath "$BASELINE")}
+BASELINE_TOKENIZER=${BASELINE_TOKENIZER:+$(realpath "$BASELINE_TOKENIZER")}
+DIR=$(dirname "$(realpath "$0")")
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK"
+
+python3 "$DIR/gen.py" . || exit 1
+
+# 运行3次，输出最短的墙钟时间
+best()
+{
+    local min= t
+    for i in 1 2 3; do
+        t=$( { TIMEFORMAT=%R; time "$@" > /dev/null 2>&1; } 2>&1 )
+        min=$(awk -v t="$t" -v min="$min" 'BEGIN { print (min == "" || t < min) ? t : min }')
+    done
+    echo "$min s"
+}
+
+# 端到端的一项：$1为说明，$2、$3为测量的程序和与之对比的程序（可以为空），其余为参数
+measure()
+{
+    local label=$1 current=$2 baseline=$3
+    shift 3
+    if [ -n "$baseline" ]; then
+        printf "  %-28s %10s   baseline %10s\n" "$label" "$(best "$current" "$@")" "$(best "$baseline" "$@")"
+    else
+        printf "  %-28s %10s\n" "$label" "$(best "$current" "$@")"
+    fi
+}
+
+end_to_end()
+{
+    local label=$1
+    shift
+    measure "$label" "$PARSER" "$BASELINE" "$@"
+}
+
+# 进程内的一项，计时程序异常退出（例如递归下降分析在嵌套过深时栈溢出）时报告crashed
+in_process()
+{
+    local out
+    if out=$("$BENCH" "$@" 2> /dev/null); then
+        echo "$out" | sed 's/^/  /'
+    else
+        echo "  $*: crashed"
+    fi
+}
+
+echo "== Lexer: table-driven DFA, big.pas =="
+in_process lex big.pas
+measure "tokenizer big.pas" "$TOKENIZER" "$BASELINE_TOKENIZER" big.pas
+
+echo "== Struct-of-arrays token buffer, huge.pas =="
+in_process tokens huge.pas
+end_to_end "parser huge.pas" huge.pas
+
+echo "== SIMD scanners: scalar, SSE2 and the best available tier =="
+for f in big wide; do
+    echo " $f.pas"
+    for scan in scalar sse2 auto; do
+        PARSER_SCAN=$scan in_process lex $f.pas
+    done
+done
+measure "tokenizer wide.pas" "$TOKENIZER" "$BASELINE_TOKENIZER" wide.pas
+
+echo "== Lexical errors reported inline: junk.pas (5000 lines of junk) against clean big.pas =="
+in_process lex junk.pas
+in_process lex big.pas
+end_to_end "parser junk.pas" junk.pas
+
+echo "== Incremental edits =="
+"$INCTEST" -bench | sed 's/^/  /'
+
+echo "== Scoped symbol table, scale.pas (10^5 definitions and references) =="
+end_to_end "parser scale.pas" scale.pas
+
+echo "== Arena AST, huge.pas =="
+in_process ast huge.pas
+end_to_end "parser huge.pas" huge.pas
+end_to_end "parser -ast huge.pas" -ast huge.pas
+
+echo "== Recursive descent and LL(1), parse only =="
+for f in huge scale broken deepcall40k deepcall1m; do
+    echo " $f.pas"
+    in_process parse $f.pas
+    in_process parse $f.pas -ll
+done
+echo " deepdef1m.pas"
+in_process parse deepdef1m.pas -ll
+
+echo "== Buffered output files =="
+end_to_end "parser big.pas" big.pas
+measure "tokenizer big.pas" "$TOKENIZER" "$BASELINE_TOKENIZER" big.pas
+end_to_end "parser -j 1 (634 files)" -j 1 batch
+
+echo "== Parsing from .dyd, big.pas =="
+"$TOKENIZER" big.pas > /dev/null
+in_process dyd big.pas big.dyd
+end_to_end "parser big.dyd" big.dyd
+end_to_end "parser big.pas" big.pas
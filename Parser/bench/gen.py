@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+# 生成性能测试用的源程序（由bench/bench.sh调用），内容固定，多次生成的结果相同
+# 用法：bench/gen.py 输出目录
+#   big.pas        1.3 MB：3000个变量、2000个函数和20000条赋值语句
+#   huge.pas       14 MB：big.pas的赋值语句重复15遍
+#   wide.pas       20 MB：深缩进的行和16个字符的标识符，空白和标识符都是长串
+#   junk.pas       5000行，几乎全是词法错误
+#   scale.pas      10^5个变量定义和10^5处引用
+#   broken.pas     30万行，其中一半有语法错误
+#   deepcall40k.pas、deepcall1m.pas  F(F(F(...)))分别嵌套4万层和10^6层
+#   deepdef1m.pas  10^6层嵌套的函数定义
+#   batch/         634个小程序，用于批量模式
+
+import os
+import random
+import sys
+
+
+def write(path, lines):
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+
+
+def big():
+    r = random.Random(2)
+    out = ["begin", "  integer k;", "  integer m;"]
+    for i in range(3000):
+        out.append("  integer v%d;" % i)
+    for i in range(2000):
+        out += ["  integer function f%d(n%d);" % (i, i),
+                "    begin",
+                "      integer n%d;" % i,
+                "      integer t%d;" % i,
+                "      if n%d <= 0 then f%d := %d" % (i, i, r.randint(0, 99999)),
+                "      else f%d := n%d * f%d(n%d - 1) - v%d" % (i, i, i, i, i),
+                "    end;"]
+    out.append("  read(m);")
+    for i in range(20000):
+        out.append("  v%d := f%d(m - %d) * v%d - %d;" % (i % 3000, i % 2000, i, (i * 7) % 3000, i))
+    out.append("  write(k)")
+    out.append("end")
+    return out
+
+
+def huge():
+    lines = big()
+    stmts = [l for l in lines if ":=" in l and l.startswith("  v")]
+    return lines[:-2] + stmts * 15 + lines[-2:]
+
+
+def wide():
+    out = ["begin"]
+    out += ["integer abcdefghijklm%03d;" % i for i in range(1000)]
+    for i in range(200000):
+        out.append(" " * 48 + "abcdefghijklm%03d := abcdefghijklm%03d * 1234567890;" % (i % 1000, i * 7 % 1000))
+    out += ["abcdefghijklm000:=1", "end"]
+    return out
+
+
+def junk():
+    r = random.Random(7)
+    pieces = ["$", "#", "@", "!", "%", "00", "0123", "?", "&",
+              "abcdefghijklmnopqrstuvwxyz", "k", "1", ":", "="]
+    out = ["begin", "  integer k;"]
+    for _ in range(5000):
+        out.append("  k := " + " ".join(r.choice(pieces) for _ in range(160)) + ";")
+    out += ["  k:=1", "end"]
+    return out
+
+
+def scale():
+    n = 100000
+    out = ["begin"]
+    out += ["  integer v%d;" % i for i in range(n)]
+    out += ["  v%d:=v%d;" % (i, n - 1 - i) for i in range(n)]
+    out += ["  v0:=1", "end"]
+    return out
+
+
+def broken():
+    cycle = ["  k := ;", "  read(zz);", "  if k then k:=1 else k:=2;", "  k := k * 2;"]
+    out = ["begin", "  integer k;"]
+    out += [cycle[i % 4] for i in range(300000)]
+    out += ["  k:=1", "end"]
+    return out
+
+
+def deepcall(n):
+    return ["begin", "integer k;", "integer function F(n);", "begin", "integer n;", "F:=n", "end;",
+            "k:=" + "F(" * n + "1" + ")" * n, "end", ""]
+
+
+def deepdef(n):
+    out = ["begin"]
+    out += ["integer function F(n);\nbegin\ninteger n;"] * n
+    out += ["F:=n\nend;"] * n
+    out += ["integer k;", "k:=1", "end", ""]
+    return out
+
+
+# 批量模式用的小程序：若干个互相调用的函数和一段主程序
+def small(r):
+    nf = r.randint(1, 30)
+    out = ["begin", "  integer k;", "  integer m;"]
+    for i in range(nf):
+        callee = "F%d" % r.randrange(i) if i else "F0"
+        out += ["  integer function F%d(n);" % i,
+                "  begin",
+                "    integer n;",
+                "    integer t;",
+                "    t := n * %d - k;" % r.randint(1, 9),
+                "    if n <= 0 then F%d := t else F%d := n * %s(n - 1)" % (i, i, callee),
+                "  end;"]
+    out.append("  read(m);")
+    for _ in range(r.randint(1, 40)):
+        out.append("  k := F%d(m - %d) - k;" % (r.randrange(nf), r.randint(0, 9)))
+    out += ["  write(k)", "end", ""]
+    return out
+
+
+# 生成的文件和生成它的函数
+FILES = [
+    ("big.pas", big),
+    ("huge.pas", huge),
+    ("wide.pas", wide),
+    ("junk.pas", junk),
+    ("scale.pas", scale),
+    ("broken.pas", broken),
+    ("deepcall40k.pas", lambda: deepcall(40000)),
+    ("deepcall1m.pas", lambda: deepcall(1000000)),
+    ("deepdef1m.pas", lambda: deepdef(1000000)),
+]
+
+
+def main():
+    if len(sys.argv) != 2:
+        print("Usage: gen.py directory")
+        return 1
+    dst = sys.argv[1]
+    for name, gen in FILES:
+        write(os.path.join(dst, name), gen())
+
+    os.makedirs(os.path.join(dst, "batch"), exist_ok=True)
+    r = random.Random(1)
+    for i in range(634):
+        write(os.path.join(dst, "batch", "p%03d.pas" % i), small(r))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,479 @@
+#include "Asm.h"
+
+namespace
+{
+    // 运行时：程序入口、读写整数的缓冲区和例程
+    // rt_read和rt_write只保留%rbx、%rbp、%r12至%r15，生成的代码在调用前后不依赖其他寄存器
+    const char *const RUNTIME = R"(
+        .set    RT_BUFSIZE, 65536
+        .set    RT_STACK_SIZE, 1 << 30
+        .set    RT_DEFAULT_STACK_SIZE, 7 << 20
+        .set    RT_STACK_RESERVE, 1 << 16
+
+        .text
+        .globl  _start
+_start:
+        # 在预先映射的大块内存上运行，深递归不受默认栈大小的限制，映射失败时沿用原来的栈
+        movl    $9, %eax                # mmap
+        xorl    %edi, %edi
+        movq    $RT_STACK_SIZE, %rsi
+        movl    $3, %edx                # PROT_READ | PROT_WRITE
+        movl    $0x4022, %r10d          # MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE
+        movq    $-1, %r8
+        xorl    %r9d, %r9d
+        syscall
+        cmpq    $-4096, %rax
+        ja      1f
+        leaq    RT_STACK_SIZE(%rax), %rsp
+        addq    $RT_STACK_RESERVE, %rax
+        jmp     2f
+1:      leaq    -RT_DEFAULT_STACK_SIZE(%rsp), %rax
+2:      movq    %rax, rt_stack_limit(%rip)
+        andq    $-16, %rsp
+        call    pl_main
+        call    rt_flush
+        movl    $231, %eax              # exit_group
+        xorl    %edi, %edi
+        syscall
+
+# 把输出缓冲区中的内容全部写出
+rt_flush:
+        movq    rt_outlen(%rip), %rdx
+        leaq    rt_outbuf(%rip), %rsi
+1:      testq   %rdx, %rdx
+        jz      2f
+        movl    $1, %eax                # write
+        movl    $1, %edi
+        syscall
+        testq   %rax, %rax
+        jle     2f
+        addq    %rax, %rsi
+        subq    %rax, %rdx
+        jmp     1b
+2:      movq    $0, rt_outlen(%rip)
+        ret
+
+# 以十进制输出%edi，后跟换行
+rt_write:
+        leaq    rt_tmp+32(%rip), %r8
+        leaq    -1(%r8), %rsi
+        movb    $10, (%rsi)
+        movl    %edi, %eax
+        testl   %eax, %eax
+        jns     1f
+        negl    %eax                    # 按无符号数除，-2147483648也能正确输出
+1:      movl    $10, %ecx
+2:      xorl    %edx, %edx
+        divl    %ecx
+        addb    $'0', %dl
+        decq    %rsi
+        movb    %dl, (%rsi)
+        testl   %eax, %eax
+        jnz     2b
+        testl   %edi, %edi
+        jns     3f
+        decq    %rsi
+        movb    $'-', (%rsi)
+3:      movq    %r8, %rcx
+        subq    %rsi, %rcx
+        movq    rt_outlen(%rip), %rdx
+        leaq    (%rdx,%rcx), %rax
+        cmpq    $RT_BUFSIZE, %rax
+        jbe     4f
+        pushq   %rsi
+        pushq   %rcx
+        call    rt_flush
+        popq    %rcx
+        popq    %rsi
+        xorl    %edx, %edx
+4:      leaq    rt_outbuf(%rip), %rdi
+        addq    %rdx, %rdi
+        addq    %rcx, %rdx
+        movq    %rdx, rt_outlen(%rip)
+        rep movsb
+        ret
+
+# 读入一个字节放在%eax，到达输入末尾时为-1
+rt_getc:
+        movq    rt_inpos(%rip), %rcx
+        cmpq    rt_inlen(%rip), %rcx
+        jb      1f
+        xorl    %eax, %eax              # read
+        xorl    %edi, %edi
+        leaq    rt_inbuf(%rip), %rsi
+        movl    $RT_BUFSIZE, %edx
+        syscall
+        testq   %rax, %rax
+        jle     2f
+        movq    %rax, rt_inlen(%rip)
+        xorl    %ecx, %ecx
+1:      leaq    rt_inbuf(%rip), %rdx
+        movzbl  (%rdx,%rcx), %eax
+        incq    %rcx
+        movq    %rcx, rt_inpos(%rip)
+        ret
+2:      movl    $-1, %eax
+        ret
+
+# 跳过空白读入一个可带符号的十进制整数，放在%eax
+rt_read:
+        pushq   %rbx                    # 是否为负数
+        pushq   %r12                    # 已读入的值
+        pushq   %r13                    # 已读入的数字个数
+1:      call    rt_getc
+        cmpl    $' ', %eax
+        je      1b
+        leal    -9(%rax), %ecx          # '\t'至'\r'
+        cmpl    $4, %ecx
+        jbe     1b
+        xorl    %ebx, %ebx
+        cmpl    $'-', %eax
+        jne     2f
+        movl    $1, %ebx
+        call    rt_getc
+        jmp     3f
+2:      cmpl    $'+', %eax
+        jne     3f
+        call    rt_getc
+3:      xorl    %r12d, %r12d
+        xorl    %r13d, %r13d
+4:      leal    -'0'(%rax), %ecx
+        cmpl    $9, %ecx
+        ja      5f
+        # 与-run相同，超出int范围的输入是错误：绝对值正数最大为2147483647，负数为2147483648
+        cmpl    $214748364, %r12d
+        ja      rt_input_error
+        jb      8f
+        leal    7(%rbx), %edx
+        cmpl    %edx, %ecx
+        ja      rt_input_error
+8:      imull   $10, %r12d, %r12d
+        addl    %ecx, %r12d
+        incl    %r13d
+        call    rt_getc
+        jmp     4b
+5:      cmpl    $-1, %eax
+        je      6f
+        decq    rt_inpos(%rip)          # 退回数字之后的那个字节
+6:      testl   %r13d, %r13d
+        jz      rt_input_error
+        movl    %r12d, %eax
+        testl   %ebx, %ebx
+        jz      7f
+        negl    %eax
+7:      popq    %r13
+        popq    %r12
+        popq    %rbx
+        ret
+
+rt_input_error:
+        leaq    rt_input_error_msg(%rip), %r12
+        movl    $rt_input_error_len, %r13d
+        jmp     rt_fail
+
+# 栈的剩余空间不足以容纳新的栈帧，在过程入口检查
+rt_stack_overflow:
+        movq    rt_stack_limit(%rip), %rsp
+        addq    $RT_STACK_RESERVE / 2, %rsp
+        leaq    rt_stack_overflow_msg(%rip), %r12
+        movl    $rt_stack_overflow_len, %r13d
+
+# 输出已缓冲的内容和%r12处长度为%r13的错误信息后退出
+rt_fail:
+        call    rt_flush
+        movl    $1, %eax                # write
+        movl    $1, %edi
+        movq    %r12, %rsi
+        movl    %r13d, %edx
+        syscall
+        movl    $231, %eax              # exit_group
+        movl    $255, %edi
+        syscall
+
+        .section .rodata
+rt_input_error_msg:
+        .ascii  "***RUNTIME: integer expected on input\n"
+        .set    rt_input_error_len, . - rt_input_error_msg
+rt_stack_overflow_msg:
+        .ascii  "***RUNTIME: stack overflow\n"
+        .set    rt_stack_overflow_len, . - rt_stack_overflow_msg
+
+        .bss
+        .align  16
+rt_outbuf:
+        .skip   RT_BUFSIZE
+rt_inbuf:
+        .skip   RT_BUFSIZE
+rt_tmp:
+        .skip   32
+rt_outlen:
+        .skip   8
+rt_inpos:
+        .skip   8
+rt_inlen:
+        .skip   8
+rt_stack_limit:
+        .skip   8
+
+        .section .note.GNU-stack, "", @progbits
+)";
+
+    // 栈帧中清零的位置超过这个数时改用rep stosq
+    constexpr int32_t MAX_UNROLLED_CLEAR = 8;
+}
+
+AsmCompiler::AsmCompiler(const Ast &ast, const VarTable &vars, const ProcTable &procs)
+    : ast_(ast), vars_(vars), procs_(procs), layout_(vars, procs),
+      out_(nullptr), level_(1), labelCount_(0)
+{
+
+}
+
+void AsmCompiler::Compile(std::ostream &out)
+{
+    out_ = &out;
+    labelCount_ = 0;
+
+    const AstNode &root = ast_[ast_.Root()];
+
+    out << "        .text\n";
+    CompileProc(layout_.MainFrame(), root.child[1]);
+    CompileProcs(root.child[0]);
+    out << RUNTIME;
+}
+
+void AsmCompiler::CompileProc(size_t proc, NodeIndex execs)
+{
+    std::ostream &out = *out_;
+
+    level_ = layout_.Level(proc);
+    const int32_t slots = layout_.FrameSize(proc);
+    const int32_t frameSize = (8 + 8 * slots + 15) / 16 * 16;
+
+    if(proc == layout_.MainFrame())
+        out << "\n# 主程序\n";
+    else
+        out << "\n# " << procs_[proc].name << "\n";
+    out << ProcLabel(proc) << ":\n"
+        << "        pushq   %rbp\n"
+        << "        movq    %rsp, %rbp\n"
+        << "        subq    $" << frameSize << ", %rsp\n"
+        << "        cmpq    rt_stack_limit(%rip), %rsp\n"
+        << "        jb      rt_stack_overflow\n"
+        << "        movq    %rcx, -8(%rbp)\n";
+
+    // 返回值和变量都从0开始
+    if(slots <= MAX_UNROLLED_CLEAR)
+    {
+        for(int32_t i = 0; i < slots; ++i)
+            out << "        movq    $0, " << SlotOffset(i) << "(%rbp)\n";
+    }
+    else
+    {
+        out << "        movl    %eax, %edx\n"
+            << "        leaq    " << SlotOffset(slots - 1) << "(%rbp), %rdi\n"
+            << "        movl    $" << slots << ", %ecx\n"
+            << "        xorl    %eax, %eax\n"
+            << "        rep stosq\n"
+            << "        movl    %edx, %eax\n";
+    }
+
+    const int32_t param = layout_.ParamSlot(proc);
+    if(param >= 0)
+        out << "        movl    %eax, " << SlotOffset(param) << "(%rbp)\n";
+
+    CompileExecs(execs);
+
+    out << "        movl    " << SlotOffset(0) << "(%rbp), %eax\n"
+        << "        leave\n"
+        << "        ret\n";
+}
+
+void AsmCompiler::CompileProcs(NodeIndex first)
+{
+    for(NodeIndex i = first; i != NO_NODE; i = ast_[i].next)
+    {
+        const AstNode &node = ast_[i];
+        CompileProc(node.value, node.child[1]);
+        CompileProcs(node.child[0]);
+    }
+}
+
+void AsmCompiler::CompileExecs(NodeIndex first)
+{
+    for(NodeIndex i = first; i != NO_NODE; i = ast_[i].next)
+        CompileExec(i);
+}
+
+void AsmCompiler::CompileExec(NodeIndex i)
+{
+    std::ostream &out = *out_;
+    const AstNode &node = ast_[i];
+    switch(node.kind)
+    {
+    case AstKind::Read:
+    {
+        out << "        call    rt_read\n";
+        const std::string operand = VarOperand(node.value);
+        out << "        movl    %eax, " << operand << "\n";
+        break;
+    }
+
+    case AstKind::Write:
+    {
+        const std::string operand = VarOperand(node.value);
+        out << "        movl    " << operand << ", %edi\n"
+            << "        call    rt_write\n";
+        break;
+    }
+
+    case AstKind::If:
+    {
+        // 条件不成立时跳到else分支，因此使用相反的比较
+        const AstNode &cond = ast_[node.child[0]];
+        CompileBinary("cmpl", cond.child[0], cond.child[1]);
+
+        const char *jump;
+        switch(static_cast<TokenType>(cond.op))
+        {
+        case TokenType::Less:         jump = "jge"; break;
+        case TokenType::LessEqual:    jump = "jg";  break;
+        case TokenType::Equal:        jump = "jne"; break;
+        case TokenType::GreaterEqual: jump = "jl";  break;
+        case TokenType::Greater:      jump = "jle"; break;
+        default:                      jump = "je";  break;
+        }
+
+        const std::string elseLabel = NewLabel(), endLabel = NewLabel();
+        out << "        " << jump << "      " << elseLabel << "\n";
+        CompileExec(node.child[1]);
+        out << "        jmp     " << endLabel << "\n"
+            << elseLabel << ":\n";
+        CompileExec(node.child[2]);
+        out << endLabel << ":\n";
+        break;
+    }
+
+    case AstKind::Assign:
+        CompileExpr(node.child[0]);
+        if(node.flags & ASSIGN_RESULT)
+            out << "        movl    %eax, " << SlotOffset(0) << "(%rbp)\n";
+        else
+        {
+            const std::string operand = VarOperand(node.value);
+            out << "        movl    %eax, " << operand << "\n";
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void AsmCompiler::CompileExpr(NodeIndex i)
+{
+    std::ostream &out = *out_;
+    const AstNode &node = ast_[i];
+    switch(node.kind)
+    {
+    case AstKind::IntLiteral:
+    case AstKind::VarRef:
+    {
+        const std::string operand = Operand(i);
+        out << "        movl    " << operand << ", %eax\n";
+        break;
+    }
+
+    case AstKind::Minus:
+        CompileBinary("subl", node.child[0], node.child[1]);
+        break;
+
+    case AstKind::Times:
+        CompileBinary("imull", node.child[0], node.child[1]);
+        break;
+
+    case AstKind::Call:
+    {
+        // 被调用的过程定义在第level - 1层的函数体中，其静态链即该层最近一次活动的栈帧
+        const size_t proc = ast_[node.value].value;
+        CompileExpr(node.child[0]);
+        const std::string frame = FrameOf(layout_.Level(proc) - 1);
+        if(frame != "%rcx")
+            out << "        movq    " << frame << ", %rcx\n";
+        out << "        call    " << ProcLabel(proc) << "\n";
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+void AsmCompiler::CompileBinary(const char *op, NodeIndex lhs, NodeIndex rhs)
+{
+    std::ostream &out = *out_;
+
+    // 总是先计算左侧，调用可能修改外层的变量
+    CompileExpr(lhs);
+    if(IsSimple(rhs))
+    {
+        const std::string operand = Operand(rhs);
+        out << "        " << op << "    " << operand << ", %eax\n";
+        return;
+    }
+
+    out << "        pushq   %rax\n";
+    CompileExpr(rhs);
+    out << "        movl    %eax, %ecx\n"
+        << "        popq    %rax\n"
+        << "        " << op << "    %ecx, %eax\n";
+}
+
+bool AsmCompiler::IsSimple(NodeIndex node) const
+{
+    const AstKind kind = ast_[node].kind;
+    return kind == AstKind::IntLiteral || kind == AstKind::VarRef;
+}
+
+std::string AsmCompiler::Operand(NodeIndex i)
+{
+    const AstNode &node = ast_[i];
+    if(node.kind == AstKind::IntLiteral)
+        return "$" + std::to_string(node.value);
+    return VarOperand(node.value);
+}
+
+std::string AsmCompiler::VarOperand(int var)
+{
+    const std::string frame = FrameOf(vars_[var].level);
+    return std::to_string(SlotOffset(layout_.Slot(var))) + "(" + frame + ")";
+}
+
+std::string AsmCompiler::FrameOf(int32_t level)
+{
+    if(level == level_)
+        return "%rbp";
+
+    std::ostream &out = *out_;
+    out << "        movq    -8(%rbp), %rcx\n";
+    for(int32_t l = level_ - 1; l > level; --l)
+        out << "        movq    -8(%rcx), %rcx\n";
+    return "%rcx";
+}
+
+std::string AsmCompiler::ProcLabel(size_t proc) const
+{
+    if(proc == layout_.MainFrame())
+        return "pl_main";
+    return "pl_" + std::to_string(proc) + "_" + std::string(procs_[proc].name.View());
+}
+
+std::string AsmCompiler::NewLabel(void)
+{
+    return ".L" + std::to_string(labelCount_++);
+}
+
+int32_t AsmCompiler::SlotOffset(int32_t slot)
+{
+    return -16 - 8 * slot;
+}
@@ -0,0 +1,80 @@
+#ifndef ASM_H
+#define ASM_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "Ast.h"
+#include "FrameLayout.h"
+#include "Parser.h"
+
+// 把语法树编译成x86-64的GNU汇编（AT&T语法），要求分析没有任何错误
+// 生成的程序不依赖C库，直接通过系统调用读写，可以这样得到可执行文件：
+//     as prog.s -o prog.o && ld prog.o -o prog
+//
+// 每个过程一个栈帧，以%rbp为基址：
+//     -8(%rbp)    静态链，即定义该过程的函数体最近一次活动的栈帧
+//     -16(%rbp)   返回值（FrameLayout中的第0个位置）
+//     -24(%rbp)…  函数体中定义的变量，依次排列
+// 调用时实参放在%eax，静态链放在%rcx，返回值放在%eax
+// 访问外层的变量时沿静态链上溯，上溯的次数为当前层次与变量所在层次之差
+// 过程入口检查栈的剩余空间，不足时与-run一样报告stack overflow
+class AsmCompiler
+{
+public:
+
+    AsmCompiler(const Ast &ast, const VarTable &vars, const ProcTable &procs);
+
+    void Compile(std::ostream &out);
+
+private:
+
+    void CompileProc(size_t proc, NodeIndex execs);
+
+    // 编译过程定义序列中的每个过程，连同其中嵌套的过程
+    void CompileProcs(NodeIndex first);
+
+    void CompileExecs(NodeIndex first);
+
+    void CompileExec(NodeIndex node);
+
+    // 计算表达式，结果放在%eax
+    void CompileExpr(NodeIndex node);
+
+    // 对%eax和node的值做运算，如"subl"，node为常量或变量时直接作为操作数
+    void CompileBinary(const char *op, NodeIndex lhs, NodeIndex rhs);
+
+    // node能否直接作为指令的操作数
+    bool IsSimple(NodeIndex node) const;
+
+    // node为常量或变量时的操作数，外层的变量先把其所在的栈帧找到%rcx中
+    std::string Operand(NodeIndex node);
+
+    std::string VarOperand(int var);
+
+    // 把level层最近一次活动的栈帧找到%rcx中，返回其基址寄存器
+    std::string FrameOf(int32_t level);
+
+    std::string ProcLabel(size_t proc) const;
+
+    std::string NewLabel(void);
+
+    static int32_t SlotOffset(int32_t slot);
+
+private:
+
+    const Ast &ast_;
+    const VarTable &vars_;
+    const ProcTable &procs_;
+    const FrameLayout layout_;
+
+    std::ostream *out_;
+
+    // 正在编译的函数体的层次
+    int32_t level_;
+
+    int labelCount_;
+};
+
+#endif // ASM_H
@@ -0,0 +1,120 @@
+#ifndef AST_H
+#define AST_H
+
+#include <cstdint>
+#include <vector>
+
+// 语法树节点在Ast中的位置
+using NodeIndex = uint32_t;
+
+constexpr NodeIndex NO_NODE = UINT32_MAX;
+
+enum class AstKind : uint8_t
+{
+    Program,    // child[0]: 过程定义序列  child[1]: 语句序列
+    ProcDef,    // child[0]: 过程定义序列  child[1]: 语句序列  value: 在ProcTable中的位置
+
+    Read,       // value: 变量在VarTable中的位置
+    Write,      // value: 同上
+    If,         // child[0]: 条件  child[1]: then分支  child[2]: else分支
+    Assign,     // child[0]: 右侧表达式  value: 变量在VarTable中的位置，或函数返回值对应的ProcDef节点
+
+    Compare,    // child[0], child[1]: 两侧表达式  op: 比较运算符的TokenType
+    Minus,      // child[0], child[1]: 左右操作数
+    Times,      // 同上
+    IntLiteral, // value: 字面量的值
+    VarRef,     // value: 变量在VarTable中的位置
+    Call        // child[0]: 实参  value: 被调用过程的ProcDef节点
+};
+
+// Assign节点的flags，表示给所在函数的返回值赋值
+constexpr uint16_t ASSIGN_RESULT = 1;
+
+// 紧凑的定长节点，子节点以下标引用，节点本身不持有任何资源
+struct AstNode
+{
+    AstKind kind;
+    uint8_t op;
+    uint16_t flags;
+    int line;
+
+    NodeIndex child[3];
+
+    // 同一序列（语句序列、过程定义序列）中的下一个节点
+    NodeIndex next;
+
+    int value;
+};
+
+static_assert(sizeof(AstNode) == 28, "AstNode should stay compact");
+
+// 所有节点连续存放在同一块内存中，整体分配和释放
+class Ast
+{
+public:
+
+    Ast(void)
+        : root_(NO_NODE)
+    {
+
+    }
+
+    NodeIndex Add(AstKind kind, int line)
+    {
+        nodes_.push_back(AstNode{ kind, 0, 0, line,
+                                  { NO_NODE, NO_NODE, NO_NODE }, NO_NODE, 0 });
+        return static_cast<NodeIndex>(nodes_.size() - 1);
+    }
+
+    AstNode &operator[](NodeIndex i)
+    {
+        return nodes_[i];
+    }
+
+    const AstNode &operator[](NodeIndex i) const
+    {
+        return nodes_[i];
+    }
+
+    NodeIndex Root(void) const
+    {
+        return root_;
+    }
+
+    void SetRoot(NodeIndex root)
+    {
+        root_ = root;
+    }
+
+    size_t Size(void) const
+    {
+        return nodes_.size();
+    }
+
+    // 节点占用的全部内存（含预留而未使用的部分）
+    size_t MemoryUsage(void) const
+    {
+        return nodes_.capacity() * sizeof(AstNode);
+    }
+
+    // 删去全部节点但保留内存，供分析下一个文件时复用
+    void Clear(void)
+    {
+        nodes_.clear();
+        root_ = NO_NODE;
+    }
+
+    // 一次性释放全部节点
+    void Release(void)
+    {
+        std::vector<AstNode>().swap(nodes_);
+        root_ = NO_NODE;
+    }
+
+private:
+
+    std::vector<AstNode> nodes_;
+    NodeIndex root_;
+};
+
+#endif // AST_H
@@ -0,0 +1,204 @@
+#include <algorithm>
+
+#include "Bytecode.h"
+
+BytecodeCompiler::BytecodeCompiler(const Ast &ast, const VarTable &vars, const ProcTable &procs)
+    : ast_(ast), vars_(vars), procs_(procs), layout_(vars, procs),
+      level_(1), depth_(0), maxDepth_(0)
+{
+
+}
+
+Bytecode BytecodeCompiler::Compile(void)
+{
+    out_ = Bytecode();
+    out_.procs.resize(procs_.size());
+    for(size_t i = 0; i < procs_.size(); ++i)
+    {
+        BytecodeProc &bp = out_.procs[i];
+        bp.entry = 0;
+        bp.frameSize = layout_.FrameSize(i);
+        bp.level = layout_.Level(i);
+        bp.paramSlot = layout_.ParamSlot(i);
+        bp.maxStack = 0;
+    }
+    out_.mainFrameSize = layout_.FrameSize(layout_.MainFrame());
+    out_.maxLevel = layout_.MaxLevel();
+
+    const AstNode &root = ast_[ast_.Root()];
+
+    level_ = 1;
+    depth_ = maxDepth_ = 0;
+    CompileExecs(root.child[1]);
+    Emit(Op::Halt);
+    out_.mainMaxStack = maxDepth_;
+
+    CompileProcs(root.child[0]);
+
+    return std::move(out_);
+}
+
+void BytecodeCompiler::CompileProcs(NodeIndex first)
+{
+    for(NodeIndex i = first; i != NO_NODE; i = ast_[i].next)
+    {
+        const AstNode &node = ast_[i];
+        BytecodeProc &bp = out_.procs[node.value];
+
+        bp.entry = static_cast<int32_t>(out_.code.size());
+        level_ = bp.level;
+        depth_ = maxDepth_ = 0;
+        CompileExecs(node.child[1]);
+        Emit(Op::Ret);
+        // 返回值在返回时压入
+        bp.maxStack = std::max(maxDepth_, 1);
+
+        CompileProcs(node.child[0]);
+    }
+}
+
+void BytecodeCompiler::CompileExecs(NodeIndex first)
+{
+    for(NodeIndex i = first; i != NO_NODE; i = ast_[i].next)
+        CompileExec(i);
+}
+
+void BytecodeCompiler::CompileExec(NodeIndex i)
+{
+    const AstNode &node = ast_[i];
+    switch(node.kind)
+    {
+    case AstKind::Read:
+        Emit(Op::Read);
+        Adjust(1);
+        EmitStore(node.value);
+        break;
+
+    case AstKind::Write:
+        EmitLoad(node.value);
+        Emit(Op::Write);
+        Adjust(-1);
+        break;
+
+    case AstKind::If:
+    {
+        // 条件不成立时跳到else分支，因此使用相反的比较
+        const AstNode &cond = ast_[node.child[0]];
+        CompileExpr(cond.child[0]);
+        CompileExpr(cond.child[1]);
+
+        Op jump = Op::Jump;
+        switch(static_cast<TokenType>(cond.op))
+        {
+        case TokenType::Less:         jump = Op::JumpGreaterEqual; break;
+        case TokenType::LessEqual:    jump = Op::JumpGreater;      break;
+        case TokenType::Equal:        jump = Op::JumpNotEqual;     break;
+        case TokenType::GreaterEqual: jump = Op::JumpLess;         break;
+        case TokenType::Greater:      jump = Op::JumpLessEqual;    break;
+        default:                      jump = Op::JumpEqual;        break;
+        }
+        Emit(jump, 0);
+        Adjust(-2);
+        const size_t toElse = out_.code.size() - 1;
+
+        CompileExec(node.child[1]);
+        Emit(Op::Jump, 0);
+        const size_t toEnd = out_.code.size() - 1;
+
+        out_.code[toElse] = static_cast<int32_t>(out_.code.size());
+        CompileExec(node.child[2]);
+        out_.code[toEnd] = static_cast<int32_t>(out_.code.size());
+        break;
+    }
+
+    case AstKind::Assign:
+        CompileExpr(node.child[0]);
+        if(node.flags & ASSIGN_RESULT)
+        {
+            Emit(Op::StoreLocal, 0);
+            Adjust(-1);
+        }
+        else
+            EmitStore(node.value);
+        break;
+
+    default:
+        break;
+    }
+}
+
+void BytecodeCompiler::CompileExpr(NodeIndex i)
+{
+    const AstNode &node = ast_[i];
+    switch(node.kind)
+    {
+    case AstKind::IntLiteral:
+        Emit(Op::Push, node.value);
+        Adjust(1);
+        break;
+
+    case AstKind::VarRef:
+        EmitLoad(node.value);
+        break;
+
+    case AstKind::Minus:
+    case AstKind::Times:
+        CompileExpr(node.child[0]);
+        CompileExpr(node.child[1]);
+        Emit(node.kind == AstKind::Minus ? Op::Sub : Op::Mul);
+        Adjust(-1);
+        break;
+
+    case AstKind::Call:
+        // 实参被弹出后压入返回值，深度不变
+        CompileExpr(node.child[0]);
+        Emit(Op::Call, ast_[node.value].value);
+        break;
+
+    default:
+        break;
+    }
+}
+
+void BytecodeCompiler::Emit(Op op)
+{
+    out_.code.push_back(static_cast<int32_t>(op));
+}
+
+void BytecodeCompiler::Emit(Op op, int32_t a)
+{
+    Emit(op);
+    out_.code.push_back(a);
+}
+
+void BytecodeCompiler::Emit(Op op, int32_t a, int32_t b)
+{
+    Emit(op, a);
+    out_.code.push_back(b);
+}
+
+void BytecodeCompiler::EmitLoad(int var)
+{
+    const int32_t level = vars_[var].level;
+    if(level == level_)
+        Emit(Op::LoadLocal, layout_.Slot(var));
+    else
+        Emit(Op::Load, level, layout_.Slot(var));
+    Adjust(1);
+}
+
+void BytecodeCompiler::EmitStore(int var)
+{
+    const int32_t level = vars_[var].level;
+    if(level == level_)
+        Emit(Op::StoreLocal, layout_.Slot(var));
+    else
+        Emit(Op::Store, level, layout_.Slot(var));
+    Adjust(-1);
+}
+
+void BytecodeCompiler::Adjust(int delta)
+{
+    depth_ += delta;
+    maxDepth_ = std::max(maxDepth_, depth_);
+}
@@ -0,0 +1,114 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Ast.h"
+#include "FrameLayout.h"
+#include "Parser.h"
+
+// 栈式虚拟机的指令，操作数紧跟在操作码之后，与之存放在同一个int32_t序列中
+enum class Op : int32_t
+{
+    Push,       // value        压入常量
+    LoadLocal,  // slot         压入当前活动记录中的变量
+    StoreLocal, // slot         弹出栈顶，存入当前活动记录中的变量
+    Load,       // level slot   压入第level层（函数体所在的层次）中最近的活动记录中的变量
+    Store,      // level slot
+    Sub,        //              弹出b和a，压入a - b
+    Mul,        //              弹出b和a，压入a * b
+    JumpLess,   // target       弹出b和a，a < b时跳转
+    JumpLessEqual,
+    JumpEqual,
+    JumpGreaterEqual,
+    JumpGreater,
+    JumpNotEqual,
+    Jump,       // target
+    Call,       // proc         弹出实参，调用第proc个过程
+    Ret,        //              以活动记录的第0个位置为返回值返回，压入返回值
+    Read,       //              读入一个整数并压入
+    Write,      //              弹出栈顶并输出
+    Halt,
+
+    OP_COUNT
+};
+
+// 过程的入口和活动记录的布局
+// 活动记录的第0个位置存放返回值，之后依次是函数体中定义的变量
+struct BytecodeProc
+{
+    int32_t entry;
+    int32_t frameSize;
+    int32_t level;     // 函数体所在的层次
+    int32_t paramSlot; // 参数在活动记录中的位置，函数体中没有定义参数时为-1
+    int32_t maxStack;  // 函数体中的语句最多占用的操作数栈深度
+};
+
+struct Bytecode
+{
+    std::vector<int32_t> code;
+
+    // 与ProcTable一一对应
+    std::vector<BytecodeProc> procs;
+
+    // 主程序从code的开头执行，其活动记录位于第1层
+    int32_t mainFrameSize;
+    int32_t mainMaxStack;
+
+    // 最深的层次，决定display的大小
+    int32_t maxLevel;
+};
+
+// 把语法树编译成字节码，要求分析没有任何错误
+// 活动记录的布局见FrameLayout，
+// 访问当前活动记录之外的变量时通过display找到其所在层次中最近的活动记录
+class BytecodeCompiler
+{
+public:
+
+    BytecodeCompiler(const Ast &ast, const VarTable &vars, const ProcTable &procs);
+
+    Bytecode Compile(void);
+
+private:
+
+    // 编译过程定义序列中的每个过程，连同其中嵌套的过程
+    void CompileProcs(NodeIndex first);
+
+    // 编译语句序列，所在函数体的层次为level_
+    void CompileExecs(NodeIndex first);
+
+    void CompileExec(NodeIndex node);
+
+    void CompileExpr(NodeIndex node);
+
+    void Emit(Op op);
+
+    void Emit(Op op, int32_t a);
+
+    void Emit(Op op, int32_t a, int32_t b);
+
+    // 变量的存取，按所在层次选择LoadLocal/Load
+    void EmitLoad(int var);
+
+    void EmitStore(int var);
+
+    // 记录操作数栈深度的变化
+    void Adjust(int delta);
+
+private:
+
+    const Ast &ast_;
+    const VarTable &vars_;
+    const ProcTable &procs_;
+    const FrameLayout layout_;
+
+    Bytecode out_;
+
+    // 正在编译的函数体的层次和操作数栈深度
+    int32_t level_;
+    int32_t depth_, maxDepth_;
+};
+
+#endif // BYTECODE_H
@@ -0,0 +1,265 @@
+#include <cstdio>
+#include <filesystem>
+
+#include "Compile.h"
+#include "DydFile.h"
+
+namespace
+{
+    // 以流式分析的方式分析w.src中的源代码，复用w中的Tokenizer和Parser
+    Parser &StartStreaming(CompileWorker &w, const std::string &filename, Parser::TokenSink sink)
+    {
+        if(w.tokenizer)
+        {
+            w.tokenizer->Reset(w.src.Data(), w.src.Size(), filename);
+            w.parser->Reset(*w.tokenizer, w.errs, std::move(sink), filename);
+        }
+        else
+        {
+            w.tokenizer.reset(new Tokenizer(w.src.Data(), w.src.Size(), filename));
+            w.parser.reset(new Parser(*w.tokenizer, w.errs, std::move(sink), filename));
+        }
+        return *w.parser;
+    }
+
+    void RunParser(Parser &parser, const CompileOptions &options)
+    {
+        if(options.tableDriven)
+            parser.ParseLL();
+        else
+            parser.Parse();
+    }
+
+    // 把词法或语法错误格式化到result.log中，返回是否有错误
+    bool CollectErrs(CompileWorker &w, const Parser &parser, CompileResult &result)
+    {
+        if(w.errs.empty() && parser.GetErrs().empty())
+            return false;
+
+        w.out.OpenString(result.log);
+        if(w.errs.size())
+        {
+            // 存在词法错误时语法分析的结果没有意义
+            result.lexErrs = w.errs.size();
+            WriteLexErrs(w.out, w.errs, w.src.Data());
+        }
+        else
+        {
+            result.syntaxErrs = parser.GetErrs().size();
+            WriteParserErrs(w.out, parser.GetErrs());
+        }
+        w.out.Close();
+        return true;
+    }
+}
+
+std::string ReplaceFileType(const std::string &name, const std::string &type)
+{
+    return name.substr(0, name.rfind(".")) + "." + type;
+}
+
+namespace
+{
+    void WriteErr(OutputFile &out, int line, const std::string &msg)
+    {
+        out.Put("***LINE: ");
+        out.PutInt(line);
+        out.Put("  ");
+        out.Put(msg);
+        out.Put('\n');
+    }
+}
+
+void WriteLexErrs(OutputFile &out, const std::vector<TokenizerError> &errs, const char *src)
+{
+    for(auto &e : errs)
+        WriteErr(out, e.line, e.Message(src));
+}
+
+void WriteParserErrs(OutputFile &out, const Parser::Errs &errs)
+{
+    for(auto &e : errs)
+        WriteErr(out, e.line, e.msg);
+}
+
+void CollectDocumentErrs(CompileWorker &w, const IncrementalParser &doc, CompileResult &result)
+{
+    result.opened = true;
+    result.bytes = doc.GetSourceSize();
+
+    // 与CollectErrs相同，存在词法错误时只报告词法错误
+    const std::vector<TokenizerError> lexErrs = doc.GetLexErrs();
+    const Parser::Errs errs = lexErrs.empty() ? doc.GetErrs() : Parser::Errs();
+    if(lexErrs.empty() && errs.empty())
+        return;
+
+    w.out.OpenString(result.log);
+    if(lexErrs.size())
+    {
+        result.lexErrs = lexErrs.size();
+        for(auto &e : lexErrs)
+            WriteErr(w.out, e.line, doc.LexErrMessage(e));
+    }
+    else
+    {
+        result.syntaxErrs = errs.size();
+        WriteParserErrs(w.out, errs);
+    }
+    w.out.Close();
+}
+
+// 每条记录的各行按固定的格式拼接，数值用to_chars写出
+void WriteVarfil(OutputFile &out, const VarTable &vars)
+{
+    for(const Var &v : vars)
+    {
+        out.Put("Var\n"
+                "    Name      = ");
+        out.Put(v.name.View());
+        out.Put("\n    Procedure = ");
+        out.Put(v.proc.View());
+        out.Put(v.kind == VarKind::Variable ?
+                "\n    Kind      = Variable\n" : "\n    Kind      = Parameter\n");
+        out.Put("    Type      = Integer\n"
+                "    Level     = ");
+        out.PutInt(v.level);
+        out.Put("\n    Offset    = ");
+        out.PutInt(v.posInTable);
+        out.Put('\n');
+    }
+}
+
+void WriteProfil(OutputFile &out, const ProcTable &procs)
+{
+    for(const Proc &p : procs)
+    {
+        out.Put("Proc\n"
+                "    Name      = ");
+        out.Put(p.name.View());
+        out.Put("\n    Type      = Integer\n"
+                "    Level     = ");
+        out.PutInt(p.level);
+        out.Put("\n    FirstVar  = ");
+        out.PutInt(p.varPosBegin);
+        out.Put("\n    LastVar   = ");
+        out.PutInt(p.varPosEnd - 1);
+        out.Put('\n');
+    }
+}
+
+bool CopyDyd(const std::string &dydFilename, const std::string &dysFilename)
+{
+    std::error_code ec;
+    std::filesystem::copy_file(dydFilename, dysFilename,
+                               std::filesystem::copy_options::overwrite_existing, ec);
+    return !ec;
+}
+
+bool WriteTextFile(OutputFile &out, const std::string &filename, const std::string &text)
+{
+    if(!out.Open(filename))
+        return false;
+    out.Put(text);
+    return out.Close();
+}
+
+void CompileFile(CompileWorker &w, const std::string &filename, const CompileOptions &options,
+                 CompileResult &result)
+{
+    if(!w.src.Open(filename))
+    {
+        result.log = (w.src.TooLarge() ? "File too large (over 4GB): " : "Cannot open file: ") +
+                     filename + "\n";
+        return;
+    }
+    result.opened = true;
+    result.bytes = w.src.Size();
+
+    const std::string dydFilename = ReplaceFileType(filename, "dyd");
+    const bool fromDyd = dydFilename == filename;
+    OutputFile &fout = w.out;
+    if(!fromDyd && !fout.Open(dydFilename))
+    {
+        result.written = false;
+        result.log = filename + ": Failed to open dyd file\n";
+        return;
+    }
+
+    DybWriter *dyb = options.emitDyb ? &w.dyb : nullptr;
+    w.dyb.Clear();
+    w.errs.clear();
+
+    // 从.dyd分析时语法分析器只能使用完整的词法单元序列，不与流式分析的语法分析器共用
+    std::unique_ptr<Parser> dydParser;
+    Parser *parser;
+    if(fromDyd)
+    {
+        if(ReadDydTokens(w.src.Data(), w.src.Size(), w.toks, w.errs) && dyb)
+            dyb->AddTokens(w.toks);
+        dydParser.reset(new Parser(w.toks, filename));
+        parser = dydParser.get();
+    }
+    else
+    {
+        parser = &StartStreaming(w, filename, [&fout, dyb](const Tokenizer::TokenStream &window)
+        {
+            WriteDydTokens(fout, window);
+            if(dyb)
+                dyb->AddTokens(window);
+        });
+    }
+
+    RunParser(*parser, options);
+    bool written = fout.Close();
+
+    if(CollectErrs(w, *parser, result))
+    {
+        if(result.lexErrs && !fromDyd)
+            remove(dydFilename.c_str());
+        result.written = WriteTextFile(fout, ReplaceFileType(filename, "err"), result.log);
+        return;
+    }
+
+    written = CopyDyd(dydFilename, ReplaceFileType(filename, "dys")) && written;
+
+    fout.Open(ReplaceFileType(filename, "varfil"));
+    WriteVarfil(fout, parser->GetVars());
+    written = fout.Close() && written;
+
+    if(dyb)
+    {
+        written = dyb->Write(fout, ReplaceFileType(filename, "dyb"),
+                             parser->GetVars(), parser->GetProcs()) && written;
+    }
+
+    fout.Open(ReplaceFileType(filename, "profil"));
+    WriteProfil(fout, parser->GetProcs());
+    written = fout.Close() && written;
+
+    result.written = written;
+    if(!written)
+        result.log = filename + ": Failed to write output files\n";
+}
+
+void CompileSource(CompileWorker &w, const char *data, size_t size,
+                   const CompileOptions &options, CompileResult &result)
+{
+    if(!w.src.Assign(data, size))
+    {
+        result.log = "Source too large (over 4GB)\n";
+        return;
+    }
+    result.opened = true;
+    result.bytes = size;
+    w.errs.clear();
+
+    Parser &parser = StartStreaming(w, "-", nullptr);
+    RunParser(parser, options);
+    if(CollectErrs(w, parser, result))
+        return;
+
+    w.out.OpenString(result.tables);
+    WriteVarfil(w.out, parser.GetVars());
+    WriteProfil(w.out, parser.GetProcs());
+    w.out.Close();
+}
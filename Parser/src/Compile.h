@@ -0,0 +1,87 @@
+#ifndef COMPILE_H
+#define COMPILE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DybFile.h"
+#include "Incremental.h"
+#include "OutputFile.h"
+#include "Parser.h"
+#include "SourceFile.h"
+#include "Tokenizer.h"
+
+// 分析一个文件（或一段源代码）的完整流程，供批量模式和编译服务共用
+
+std::string ReplaceFileType(const std::string &name, const std::string &type);
+
+// 错误信息，每行格式为"***LINE: 行号  信息"，与.err文件的内容相同
+void WriteLexErrs(OutputFile &out, const std::vector<TokenizerError> &errs, const char *src);
+
+void WriteParserErrs(OutputFile &out, const Parser::Errs &errs);
+
+void WriteVarfil(OutputFile &out, const VarTable &vars);
+
+void WriteProfil(OutputFile &out, const ProcTable &procs);
+
+// dys与dyd内容相同，由内核直接复制
+bool CopyDyd(const std::string &dydFilename, const std::string &dysFilename);
+
+// 写出一段已经格式化好的内容
+bool WriteTextFile(OutputFile &out, const std::string &filename, const std::string &text);
+
+// 每个工作线程持有的分析状态，在依次分析的文件之间复用
+struct CompileWorker
+{
+    SourceFile src;
+    std::unique_ptr<Tokenizer> tokenizer;
+    std::unique_ptr<Parser> parser;
+    std::vector<TokenizerError> errs;
+    OutputFile out;
+    DybWriter dyb;
+
+    // 输入为.dyd时解码出的词法单元序列
+    TokenBuffer toks;
+};
+
+// 对每个文件都相同的选项
+struct CompileOptions
+{
+    bool tableDriven = false;
+    bool emitDyb = false;
+};
+
+struct CompileResult
+{
+    bool opened = false;
+    bool written = true;
+    size_t bytes = 0;
+    size_t lexErrs = 0;
+    size_t syntaxErrs = 0;
+
+    // 应当输出到控制台的内容：错误信息（与.err相同），或者无法读写文件的说明
+    std::string log;
+
+    // CompileSource成功时的变量表和过程表，内容依次与.varfil和.profil相同
+    std::string tables;
+
+    bool Succeeded(void) const
+    {
+        return opened && written && !lexErrs && !syntaxErrs;
+    }
+};
+
+// 流式分析一个文件并写出.dyd/.dys/.varfil/.profil/.err（以及.dyb），与单独分析时的输出相同
+// 文件是.dyd时解码其中的记录代替词法分析，.dyd本身不会被改写
+void CompileFile(CompileWorker &w, const std::string &filename, const CompileOptions &options,
+                 CompileResult &result);
+
+// 分析内存中的一段源代码，不读写任何文件，符号表放在result.tables中
+void CompileSource(CompileWorker &w, const char *data, size_t size,
+                   const CompileOptions &options, CompileResult &result);
+
+// 收集增量分析中的文档当前的错误信息，格式与CompileSource相同
+void CollectDocumentErrs(CompileWorker &w, const IncrementalParser &doc, CompileResult &result);
+
+#endif // COMPILE_H
@@ -0,0 +1,264 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "DybFile.h"
+
+namespace
+{
+    constexpr uint64_t ALIGNMENT = 8;
+
+    uint64_t AlignUp(uint64_t n)
+    {
+        return (n + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    template<typename T>
+    void PutArray(OutputFile &out, const std::vector<T> &v)
+    {
+        out.Put(std::string_view(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T)));
+    }
+
+    // 补零至8字节对齐，pos为当前已写出的字节数
+    void PutPadding(OutputFile &out, uint64_t &pos)
+    {
+        static constexpr char zeros[ALIGNMENT] = { };
+        const uint64_t aligned = AlignUp(pos);
+        out.Put(std::string_view(zeros, aligned - pos));
+        pos = aligned;
+    }
+
+    // 段[offset, offset + count * size)是否对齐且完全位于文件之内
+    bool SectionFits(uint64_t offset, uint64_t count, uint64_t size, uint64_t fileSize)
+    {
+        return offset % ALIGNMENT == 0 && offset <= fileSize &&
+               count <= (fileSize - offset) / size;
+    }
+}
+
+DybWriter::DybWriter(void)
+{
+    Clear();
+}
+
+void DybWriter::Clear(void)
+{
+    tokens_.clear();
+    pool_.clear();
+    strings_.clear();
+    fixed_.fill(DybString{ 0, 0 });
+}
+
+DybString DybWriter::Intern(std::string_view str)
+{
+    const auto found = strings_.find(str);
+    if(found != strings_.end())
+        return found->second;
+
+    const DybString s{ static_cast<uint32_t>(pool_.size()), static_cast<uint32_t>(str.size()) };
+    pool_.append(str);
+    pool_.push_back('\0');
+    strings_.emplace(str, s);
+    return s;
+}
+
+void DybWriter::AddTokens(const TokenBuffer &toks)
+{
+    // 与WriteDydTokens相同，沿行首偏移表顺序前进，不必逐个二分查找行号
+    const std::vector<uint32_t> &lineStarts = toks.LineStarts();
+    size_t next = 1;
+    int line = toks.FirstLine();
+    for(size_t i = 0; i < toks.Size(); ++i)
+    {
+        for(; next < lineStarts.size() && lineStarts[next] <= toks.Offset(i); ++next)
+            ++line;
+
+        const TokenType type = toks.Type(i);
+        DybToken t = { };
+        if(type == TokenType::Identifier || type == TokenType::IntLiteral)
+            t.str = Intern(toks.Str(i));
+        else
+        {
+            DybString &s = fixed_[static_cast<int>(type)];
+            if(!s.length)
+                s = Intern(toks.Str(i));
+            t.str = s;
+        }
+        t.value = type == TokenType::IntLiteral ? toks.Value(i) : 0;
+        t.line = line;
+        t.type = static_cast<uint8_t>(type);
+        tokens_.push_back(t);
+    }
+}
+
+bool DybWriter::Write(OutputFile &out, const std::string &filename,
+                      const VarTable &vars, const ProcTable &procs)
+{
+    std::vector<DybVar> dybVars;
+    dybVars.reserve(vars.size());
+    for(const Var &v : vars)
+    {
+        DybVar d = { };
+        d.name = Intern(v.name.View());
+        d.proc = Intern(v.proc.View());
+        d.level = v.level;
+        d.posInTable = static_cast<uint32_t>(v.posInTable);
+        d.kind = static_cast<uint8_t>(v.kind);
+        d.type = static_cast<uint8_t>(v.type);
+        dybVars.push_back(d);
+    }
+
+    std::vector<DybProc> dybProcs;
+    dybProcs.reserve(procs.size());
+    for(const Proc &p : procs)
+    {
+        DybProc d = { };
+        d.name = Intern(p.name.View());
+        d.level = p.level;
+        d.varPosBegin = static_cast<uint32_t>(p.varPosBegin);
+        d.varPosEnd = static_cast<uint32_t>(p.varPosEnd);
+        d.returnType = static_cast<uint8_t>(p.returnType);
+        dybProcs.push_back(d);
+    }
+
+    DybHeader h = { };
+    h.magic = DYB_MAGIC;
+    h.version = DYB_VERSION;
+    h.tokensOffset = AlignUp(sizeof(DybHeader));
+    h.tokenCount = tokens_.size();
+    h.varsOffset = AlignUp(h.tokensOffset + tokens_.size() * sizeof(DybToken));
+    h.varCount = dybVars.size();
+    h.procsOffset = AlignUp(h.varsOffset + dybVars.size() * sizeof(DybVar));
+    h.procCount = dybProcs.size();
+    h.poolOffset = AlignUp(h.procsOffset + dybProcs.size() * sizeof(DybProc));
+    h.poolSize = pool_.size();
+    h.fileSize = h.poolOffset + pool_.size();
+
+    if(!tokens_.empty() && tokens_.back().line > DYB_MAX_LINE)
+        return false;
+    if(!out.Open(filename))
+        return false;
+
+    uint64_t pos = sizeof(DybHeader);
+    out.Put(std::string_view(reinterpret_cast<const char*>(&h), sizeof(h)));
+    PutPadding(out, pos);
+    PutArray(out, tokens_);
+    pos += tokens_.size() * sizeof(DybToken);
+    PutPadding(out, pos);
+    PutArray(out, dybVars);
+    pos += dybVars.size() * sizeof(DybVar);
+    PutPadding(out, pos);
+    PutArray(out, dybProcs);
+    pos += dybProcs.size() * sizeof(DybProc);
+    PutPadding(out, pos);
+    out.Put(pool_);
+    return out.Close();
+}
+
+DybFile::DybFile(void)
+    : data_(nullptr), size_(0)
+{
+
+}
+
+DybFile::~DybFile(void)
+{
+    Close();
+}
+
+void DybFile::Close(void)
+{
+    if(data_)
+    {
+        munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+
+bool DybFile::Open(const std::string &filename)
+{
+    Close();
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+       static_cast<size_t>(st.st_size) < sizeof(DybHeader))
+    {
+        close(fd);
+        return false;
+    }
+
+    const size_t size = static_cast<size_t>(st.st_size);
+    void *m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(m == MAP_FAILED)
+        return false;
+    data_ = static_cast<const char*>(m);
+    size_ = size;
+
+    const DybHeader &h = Header();
+    if(h.magic != DYB_MAGIC || h.version != DYB_VERSION || h.fileSize != size ||
+       !SectionFits(h.tokensOffset, h.tokenCount, sizeof(DybToken), size) ||
+       !SectionFits(h.varsOffset, h.varCount, sizeof(DybVar), size) ||
+       !SectionFits(h.procsOffset, h.procCount, sizeof(DybProc), size) ||
+       !SectionFits(h.poolOffset, h.poolSize, 1, size))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool DybFile::Validate(std::string &error) const
+{
+    const DybHeader &h = Header();
+    auto inPool = [&h](DybString str)
+    {
+        return str.offset <= h.poolSize && str.length <= h.poolSize - str.offset;
+    };
+    auto fail = [&error](const char *what, size_t index, const char *msg)
+    {
+        error = std::string(what) + " " + std::to_string(index) + ": " + msg;
+        return false;
+    };
+
+    int32_t line = 1;
+    for(size_t i = 0; i < TokenCount(); ++i)
+    {
+        const DybToken &t = Tokens()[i];
+        if(t.type == 0 || t.type >= TOKEN_CODE_COUNT)
+            return fail("token", i, "invalid token type");
+        if(t.line < line || t.line > DYB_MAX_LINE)
+            return fail("token", i, "invalid line number");
+        if(!inPool(t.str))
+            return fail("token", i, "string out of range");
+        line = t.line;
+    }
+
+    for(size_t i = 0; i < VarCount(); ++i)
+    {
+        const DybVar &v = Vars()[i];
+        if(v.kind > static_cast<uint8_t>(VarKind::Variable) ||
+           v.type != static_cast<uint8_t>(VarType::Integer))
+            return fail("var", i, "invalid kind or type");
+        if(!inPool(v.name) || !inPool(v.proc))
+            return fail("var", i, "string out of range");
+    }
+
+    for(size_t i = 0; i < ProcCount(); ++i)
+    {
+        const DybProc &p = Procs()[i];
+        if(p.returnType != static_cast<uint8_t>(VarType::Integer))
+            return fail("proc", i, "invalid return type");
+        if(p.varPosBegin > p.varPosEnd || p.varPosEnd > VarCount())
+            return fail("proc", i, "variable range out of range");
+        if(!inPool(p.name))
+            return fail("proc", i, "string out of range");
+    }
+    return true;
+}
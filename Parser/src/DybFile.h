@@ -0,0 +1,205 @@
+#ifndef DYBFILE_H
+#define DYBFILE_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "OutputFile.h"
+#include "Parser.h"
+#include "Tokenizer.h"
+
+// .dyb：词法分析结果和符号表的二进制格式，与.dyd/.varfil/.profil的内容相同
+// 文件映射到内存后即可直接使用其中的数组，不需要任何解析：
+// 依次为DybHeader、词法单元数组、变量表、过程表和字符串池，各段都从8字节对齐的位置开始，
+// 位置以相对于文件开头的偏移记录；整数均为小端序（即x86-64的本机格式）
+// 记录中的字符串以DybString引用字符串池，池中每个字符串之后另有一个'\0'，相同的字符串只存放一次
+
+constexpr uint32_t DYB_MAGIC   = 0x31425944; // 文件开头的"DYB1"
+constexpr uint32_t DYB_VERSION = 1;
+
+// 行号的上限，超过时DybWriter不写出，DybFile::Validate也不接受；
+// 由.dyb重新生成.dyd时每行都要写出一条EOLN记录，限制行号即限制了输出的大小
+constexpr int32_t DYB_MAX_LINE = 1 << 24;
+
+struct DybString
+{
+    uint32_t offset;        // 在字符串池中的偏移
+    uint32_t length;        // 不含结尾的'\0'
+};
+
+// 换行不单独记录，两个词法单元之间的换行数即为它们的行号之差，
+// 结束标志的行号即为源文件的总行数
+struct DybToken
+{
+    DybString str;          // 词法单元文本，结束标志为"EOF"
+    int32_t value;          // 整形字面量的值，其他词法单元为0
+    int32_t line;
+    uint8_t type;           // TokenType，即dyd中的种别码
+    uint8_t reserved[3];
+};
+
+struct DybVar
+{
+    DybString name;
+    DybString proc;
+    int32_t level;
+    uint32_t posInTable;
+    uint8_t kind;           // VarKind：0为Parameter，1为Variable
+    uint8_t type;           // VarType：0为Integer
+    uint8_t reserved[2];
+};
+
+struct DybProc
+{
+    DybString name;
+    int32_t level;
+    uint32_t varPosBegin;   // 变量的有效范围是[varPosBegin, varPosEnd)
+    uint32_t varPosEnd;
+    uint8_t returnType;     // VarType
+    uint8_t reserved[3];
+};
+
+struct DybHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t fileSize;
+
+    uint64_t tokensOffset;
+    uint64_t tokenCount;
+    uint64_t varsOffset;
+    uint64_t varCount;
+    uint64_t procsOffset;
+    uint64_t procCount;
+    uint64_t poolOffset;
+    uint64_t poolSize;
+};
+
+static_assert(sizeof(DybString) == 8 && sizeof(DybToken) == 20 &&
+              sizeof(DybVar) == 28 && sizeof(DybProc) == 24 &&
+              sizeof(DybHeader) == 80, "dyb record layout");
+static_assert(std::is_trivially_copyable<DybToken>::value &&
+              std::is_trivially_copyable<DybVar>::value &&
+              std::is_trivially_copyable<DybProc>::value &&
+              std::is_trivially_copyable<DybHeader>::value, "dyb records are copied as bytes");
+static_assert(static_cast<int>(VarKind::Parameter) == 0 &&
+              static_cast<int>(VarKind::Variable) == 1 &&
+              static_cast<int>(VarType::Integer) == 0, "dyb enum values");
+
+// 随流式分析逐窗口收集词法单元，分析结束后连同符号表一次写出
+// 词法单元文本引用源代码，源代码需存活至Write返回
+class DybWriter
+{
+public:
+
+    DybWriter(void);
+
+    // 清空内容但保留容量，用于依次写出多个文件
+    void Clear(void);
+
+    // 追加一个窗口（或完整的词法单元序列）
+    void AddTokens(const TokenBuffer &toks);
+
+    // 经由out写出到filename，out的缓冲区可以在多次写出之间复用
+    bool Write(OutputFile &out, const std::string &filename,
+               const VarTable &vars, const ProcTable &procs);
+
+private:
+
+    DybString Intern(std::string_view str);
+
+    std::vector<DybToken> tokens_;
+    std::string pool_;
+
+    // 键引用源代码、静态字符串或符号表中的名字，只在一个文件的写出过程中使用
+    std::unordered_map<std::string_view, DybString> strings_;
+
+    // 标识符和整形字面量以外的词法单元文本由种别唯一确定，按种别缓存，长度为0表示尚未加入
+    std::array<DybString, TOKEN_CODE_COUNT> fixed_;
+};
+
+// 只读地映射一个.dyb文件；Open只检查文件头和各段的范围，不读取其余内容，
+// 使用记录中的字段之前应当先调用Validate
+// 其余成员只能在Open成功之后使用
+class DybFile
+{
+public:
+
+    DybFile(void);
+
+    ~DybFile(void);
+
+    DybFile(const DybFile &) = delete;
+    DybFile &operator=(const DybFile &) = delete;
+
+    bool Open(const std::string &filename);
+
+    // 逐条检查全部记录：词法单元的种别有效，行号从1开始不减且不超过DYB_MAX_LINE，
+    // 变量和过程中的枚举值有效，变量范围位于变量表之内，字符串都位于字符串池之内
+    // 不合法时返回false，并在error中说明第一处错误
+    bool Validate(std::string &error) const;
+
+    const DybHeader &Header(void) const
+    {
+        return *reinterpret_cast<const DybHeader*>(data_);
+    }
+
+    const DybToken *Tokens(void) const
+    {
+        return Section<DybToken>(Header().tokensOffset);
+    }
+
+    size_t TokenCount(void) const
+    {
+        return static_cast<size_t>(Header().tokenCount);
+    }
+
+    const DybVar *Vars(void) const
+    {
+        return Section<DybVar>(Header().varsOffset);
+    }
+
+    size_t VarCount(void) const
+    {
+        return static_cast<size_t>(Header().varCount);
+    }
+
+    const DybProc *Procs(void) const
+    {
+        return Section<DybProc>(Header().procsOffset);
+    }
+
+    size_t ProcCount(void) const
+    {
+        return static_cast<size_t>(Header().procCount);
+    }
+
+    // 超出字符串池的引用得到空串
+    std::string_view String(DybString str) const
+    {
+        const DybHeader &h = Header();
+        if(str.offset > h.poolSize || str.length > h.poolSize - str.offset)
+            return std::string_view();
+        return std::string_view(data_ + h.poolOffset + str.offset, str.length);
+    }
+
+private:
+
+    template<typename T>
+    const T *Section(uint64_t offset) const
+    {
+        return reinterpret_cast<const T*>(data_ + offset);
+    }
+
+    void Close(void);
+
+    const char *data_;
+    size_t size_;
+};
+
+#endif // DYBFILE_H
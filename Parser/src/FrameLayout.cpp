@@ -0,0 +1,78 @@
+#include <algorithm>
+
+#include "FrameLayout.h"
+
+FrameLayout::FrameLayout(const VarTable &vars, const ProcTable &procs)
+    : frames_(procs.size() + 1), owners_(vars.size()), slots_(vars.size()),
+      maxLevel_(1)
+{
+    for(size_t i = 0; i < procs.size(); ++i)
+    {
+        frames_[i] = Frame{ 1, procs[i].level + 1, -1 };
+        maxLevel_ = std::max(maxLevel_, frames_[i].level);
+    }
+    frames_.back() = Frame{ 1, 1, -1 };
+
+    // 按varPosBegin的顺序扫描过程，同一层次中后开始的过程总是覆盖先开始的（它们互不相交），
+    // 因此扫描到某个变量时，记录在其层次上的过程就是定义它的过程
+    std::vector<size_t> order(procs.size());
+    for(size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&procs](size_t a, size_t b)
+    {
+        const Proc &pa = procs[a], &pb = procs[b];
+        return pa.varPosBegin != pb.varPosBegin ? pa.varPosBegin < pb.varPosBegin :
+                                                  pa.varPosEnd < pb.varPosEnd;
+    });
+
+    std::vector<size_t> active(maxLevel_ + 1, MainFrame());
+    size_t next = 0;
+    for(size_t v = 0; v < vars.size(); ++v)
+    {
+        for(; next < order.size() && procs[order[next]].varPosBegin <= v; ++next)
+            active[frames_[order[next]].level] = order[next];
+
+        const Var &var = vars[v];
+        const size_t owner = var.level == 1 ? MainFrame() : active[var.level];
+        Frame &frame = frames_[owner];
+        owners_[v] = static_cast<uint32_t>(owner);
+        slots_[v] = frame.size++;
+        if(var.kind == VarKind::Parameter && owner != MainFrame())
+            frame.paramSlot = slots_[v];
+    }
+}
+
+size_t FrameLayout::MainFrame(void) const
+{
+    return frames_.size() - 1;
+}
+
+size_t FrameLayout::Owner(size_t var) const
+{
+    return owners_[var];
+}
+
+int32_t FrameLayout::Slot(size_t var) const
+{
+    return slots_[var];
+}
+
+int32_t FrameLayout::FrameSize(size_t proc) const
+{
+    return frames_[proc].size;
+}
+
+int32_t FrameLayout::Level(size_t proc) const
+{
+    return frames_[proc].level;
+}
+
+int32_t FrameLayout::ParamSlot(size_t proc) const
+{
+    return frames_[proc].paramSlot;
+}
+
+int32_t FrameLayout::MaxLevel(void) const
+{
+    return maxLevel_;
+}
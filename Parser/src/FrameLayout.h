@@ -0,0 +1,57 @@
+#ifndef FRAMELAYOUT_H
+#define FRAMELAYOUT_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Parser.h"
+
+// 活动记录的布局，供各个后端共用
+// 每个过程和主程序各有一种活动记录，第0个位置存放返回值，之后依次是函数体中定义的变量
+// 函数体中定义的变量，其Level即为函数体的层次，且都在该过程的[varPosBegin, varPosEnd)中，
+// 据此可以由VarTable和ProcTable确定每个变量属于哪个活动记录
+class FrameLayout
+{
+public:
+
+    FrameLayout(const VarTable &vars, const ProcTable &procs);
+
+    // 主程序以ProcTable的大小表示
+    size_t MainFrame(void) const;
+
+    // 变量所属的活动记录，以及在其中的位置
+    size_t Owner(size_t var) const;
+
+    int32_t Slot(size_t var) const;
+
+    // 活动记录中的位置数（含返回值）
+    int32_t FrameSize(size_t proc) const;
+
+    // 函数体所在的层次，主程序为1
+    int32_t Level(size_t proc) const;
+
+    // 参数在活动记录中的位置，函数体中没有定义参数时为-1
+    int32_t ParamSlot(size_t proc) const;
+
+    int32_t MaxLevel(void) const;
+
+private:
+
+    struct Frame
+    {
+        int32_t size;
+        int32_t level;
+        int32_t paramSlot;
+    };
+
+    // 与ProcTable一一对应，最后一项为主程序
+    std::vector<Frame> frames_;
+
+    // 与VarTable一一对应
+    std::vector<uint32_t> owners_;
+    std::vector<int32_t> slots_;
+
+    int32_t maxLevel_;
+};
+
+#endif // FRAMELAYOUT_H
@@ -0,0 +1,229 @@
+#ifndef GAPVECTOR_H
+#define GAPVECTOR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 间隙数组：在最近一次编辑的位置留出一段空位，插入和删除只需移动间隙，
+// 连续在同一处附近的编辑代价与数组长度无关
+// 元素按成员offset（在源代码中的偏移）排序，间隙之前的offset是到开头的距离，
+// 间隙之后的是到末尾（total，即源代码长度）的距离，
+// 因此编辑改变了源代码长度时，间隙之后的元素不需要修改；元素越过间隙时才换算
+template<typename T>
+class GapVector
+{
+public:
+
+    GapVector(void)
+        : gapBegin_(0), gapEnd_(0)
+    {
+
+    }
+
+    // 以items（offset为到开头的距离）为全部内容，间隙位于末尾
+    // 间隙预留为长度的1/16，items事先留有这么多容量时不需要重新分配
+    void Assign(std::vector<T> &&items)
+    {
+        buf_ = std::move(items);
+        gapBegin_ = buf_.size();
+        buf_.resize(GapSize(buf_.size()));
+        gapEnd_ = buf_.size();
+    }
+
+    static size_t GapSize(size_t size)
+    {
+        return size + size / 16 + 64;
+    }
+
+    size_t Size(void) const
+    {
+        return buf_.size() - (gapEnd_ - gapBegin_);
+    }
+
+    // 第i个元素，不换算offset
+    const T &Raw(size_t i) const
+    {
+        return buf_[i < gapBegin_ ? i : i + gapEnd_ - gapBegin_];
+    }
+
+    T &Raw(size_t i)
+    {
+        return buf_[i < gapBegin_ ? i : i + gapEnd_ - gapBegin_];
+    }
+
+    uint32_t OffsetAt(size_t i, uint32_t total) const
+    {
+        return i < gapBegin_ ? buf_[i].offset : total - Raw(i).offset;
+    }
+
+    // 第i个元素，offset换算为到开头的距离
+    T At(size_t i, uint32_t total) const
+    {
+        T rt = Raw(i);
+        rt.offset = OffsetAt(i, total);
+        return rt;
+    }
+
+    // 第一个offset不小于offset的元素的位置
+    size_t LowerBound(uint32_t offset, uint32_t total) const
+    {
+        return Bound(offset, total, false);
+    }
+
+    // 第一个offset大于offset的元素的位置
+    size_t UpperBound(uint32_t offset, uint32_t total) const
+    {
+        return Bound(offset, total, true);
+    }
+
+    // 把间隙移到第i个元素之前
+    void MoveGap(size_t i, uint32_t total)
+    {
+        // 间隙为空时元素会移到自身上，先扩大间隙
+        if(gapBegin_ == gapEnd_ && i != gapBegin_)
+            Grow();
+        while(gapBegin_ > i)
+        {
+            T &t = buf_[--gapEnd_];
+            t = std::move(buf_[--gapBegin_]);
+            t.offset = total - t.offset;
+        }
+        while(gapBegin_ < i)
+        {
+            T &t = buf_[gapBegin_++];
+            t = std::move(buf_[gapEnd_++]);
+            t.offset = total - t.offset;
+        }
+    }
+
+    // 删除间隙之后的count个元素
+    void Erase(size_t count)
+    {
+        gapEnd_ += count;
+    }
+
+    // 在间隙处插入一个元素，其offset为到开头的距离
+    void Insert(T value)
+    {
+        if(gapBegin_ == gapEnd_)
+            Grow();
+        buf_[gapBegin_++] = std::move(value);
+    }
+
+private:
+
+    size_t Bound(uint32_t offset, uint32_t total, bool upper) const
+    {
+        // 间隙两侧分别有序，先确定落在哪一侧
+        auto before = [&](uint32_t x) { return upper ? x <= offset : x < offset; };
+        if(gapBegin_ && !before(buf_[gapBegin_ - 1].offset))
+        {
+            return std::partition_point(buf_.begin(), buf_.begin() + gapBegin_,
+                [&](const T &t) { return before(t.offset); }) - buf_.begin();
+        }
+        return gapBegin_ + (std::partition_point(buf_.begin() + gapEnd_, buf_.end(),
+            [&](const T &t) { return before(total - t.offset); }) - buf_.begin() - gapEnd_);
+    }
+
+    void Grow(void)
+    {
+        const size_t after = buf_.size() - gapEnd_;
+        buf_.resize(std::max<size_t>(buf_.size() * 2, 64));
+        std::move_backward(buf_.begin() + gapEnd_, buf_.begin() + gapEnd_ + after, buf_.end());
+        gapEnd_ = buf_.size() - after;
+    }
+
+    std::vector<T> buf_;
+    size_t gapBegin_, gapEnd_;
+};
+
+// 源代码的间隙缓冲区
+class GapText
+{
+public:
+
+    GapText(void)
+        : gapBegin_(0), gapEnd_(0)
+    {
+
+    }
+
+    void Assign(const std::string &text)
+    {
+        buf_ = text;
+        gapBegin_ = gapEnd_ = buf_.size();
+    }
+
+    size_t Size(void) const
+    {
+        return buf_.size() - (gapEnd_ - gapBegin_);
+    }
+
+    char At(size_t i) const
+    {
+        return buf_[i < gapBegin_ ? i : i + gapEnd_ - gapBegin_];
+    }
+
+    // 把[begin, end)追加到out
+    void CopyTo(size_t begin, size_t end, std::string &out) const
+    {
+        if(begin < gapBegin_)
+            out.append(buf_, begin, std::min(end, gapBegin_) - begin);
+        if(end > gapBegin_)
+        {
+            const size_t from = std::max(begin, gapBegin_);
+            out.append(buf_, from + gapEnd_ - gapBegin_, end - from);
+        }
+    }
+
+    // 用text替换[offset, offset + length)
+    void Replace(size_t offset, size_t length, const std::string &text)
+    {
+        MoveGap(offset);
+        gapEnd_ += length;
+        if(gapEnd_ - gapBegin_ < text.size())
+            Grow(text.size());
+        std::memcpy(&buf_[gapBegin_], text.data(), text.size());
+        gapBegin_ += text.size();
+    }
+
+    // 把全部内容移到一起，其后至少有padding个'\0'，返回其开头
+    const char *Contiguous(size_t padding)
+    {
+        MoveGap(Size());
+        if(gapEnd_ - gapBegin_ < padding)
+            Grow(padding);
+        std::memset(&buf_[gapBegin_], 0, padding);
+        return buf_.data();
+    }
+
+private:
+
+    void MoveGap(size_t i)
+    {
+        if(i < gapBegin_)
+            std::memmove(&buf_[gapEnd_ - (gapBegin_ - i)], &buf_[i], gapBegin_ - i);
+        else if(i > gapBegin_)
+            std::memmove(&buf_[gapBegin_], &buf_[gapEnd_], i - gapBegin_);
+        gapEnd_ = gapEnd_ + i - gapBegin_;
+        gapBegin_ = i;
+    }
+
+    // 使间隙至少能容纳size个字节
+    void Grow(size_t size)
+    {
+        const size_t after = buf_.size() - gapEnd_;
+        buf_.resize(std::max(buf_.size() * 2, gapBegin_ + size + after + 4096));
+        std::memmove(&buf_[buf_.size() - after], &buf_[gapEnd_], after);
+        gapEnd_ = buf_.size() - after;
+    }
+
+    std::string buf_;
+    size_t gapBegin_, gapEnd_;
+};
+
+#endif // GAPVECTOR_H
@@ -0,0 +1,363 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Incremental.h"
+#include "SourceFile.h"
+
+IncrementalParser::IncrementalParser(const std::string &src,
+                                     const std::string &filename)
+    : filename_(filename), hasNul_(false)
+{
+    text_.Assign(src);
+    Rebuild();
+}
+
+bool IncrementalParser::Apply(const std::vector<SourceEdit> &edits)
+{
+    bool rt = true;
+    for(auto &e : edits)
+        rt = Apply(e) && rt;
+    return rt;
+}
+
+bool IncrementalParser::Apply(const SourceEdit &edit)
+{
+    const uint32_t oldSize = Total();
+    const uint32_t offset = static_cast<uint32_t>(std::min<size_t>(edit.offset, oldSize));
+    const uint32_t length = static_cast<uint32_t>(std::min<size_t>(edit.length, oldSize - offset));
+    const int64_t delta = static_cast<int64_t>(edit.text.size()) - length;
+
+    // 编辑前受影响的词法单元[a, b)：与被替换的区间重叠或者相邻的都可能改变
+    size_t a = toks_.LowerBound(offset, oldSize);
+    if(a > 0 && toks_.OffsetAt(a - 1, oldSize) + toks_.Raw(a - 1).length >= offset)
+        --a;
+    const size_t b = toks_.UpperBound(offset + length, oldSize);
+
+    text_.Replace(offset, length, edit.text);
+
+    // 被替换的换行之后的行首都要删去
+    const size_t lineFirst = lineStarts_.UpperBound(offset, oldSize);
+    const size_t lineLast = lineStarts_.UpperBound(offset + length, oldSize);
+    lineStarts_.MoveGap(lineFirst, oldSize);
+    lineStarts_.Erase(lineLast - lineFirst);
+    for(const char *p = edit.text.data(), *end = p + edit.text.size();
+        (p = static_cast<const char*>(std::memchr(p, '\n', end - p))) != nullptr; ++p)
+    {
+        lineStarts_.Insert(LineStart{ static_cast<uint32_t>(offset + (p - edit.text.data()) + 1) });
+    }
+
+    // 源代码中间的'\0'会截断分析，不值得为此维护增量的结果
+    if(hasNul_ || std::memchr(edit.text.data(), '\0', edit.text.size()) ||
+       !ReparseBody(a, b, delta, oldSize))
+    {
+        Rebuild();
+        return false;
+    }
+    return true;
+}
+
+bool IncrementalParser::ReparseBody(size_t a, size_t b, int64_t delta, uint32_t oldSize)
+{
+    // 被改动的词法单元中有begin或end时，函数体的边界可能已经改变
+    for(size_t i = a; i < b; ++i)
+    {
+        const TokenType type = toks_.Raw(i).type;
+        if(type == TokenType::Begin || type == TokenType::End || type == TokenType::EndMark)
+            return false;
+    }
+
+    // 向前找到没有配对的begin，向后找到与之配对的end，即包含编辑的最内层函数体
+    size_t open = a;
+    for(int depth = 0; ; )
+    {
+        if(open == 0)
+            return false;
+        const TokenType type = toks_.Raw(--open).type;
+        if(type == TokenType::End)
+            ++depth;
+        else if(type == TokenType::Begin && depth-- == 0)
+            break;
+    }
+    size_t close = b;
+    for(int depth = 0; ; ++close)
+    {
+        const TokenType type = toks_.Raw(close).type;
+        if(type == TokenType::EndMark)
+            return false;
+        if(type == TokenType::Begin)
+            ++depth;
+        else if(type == TokenType::End && depth-- == 0)
+            break;
+    }
+
+    // 主程序的begin没有记录过程；此前分析出错的过程不能保证其后的结果与完整的分析相同
+    if(toks_.Raw(open).value == 0)
+        return false;
+    const size_t proc = static_cast<size_t>(toks_.Raw(open).value - 1);
+    const uint32_t bodyBegin = toks_.OffsetAt(open, oldSize);
+    const uint32_t oldBodyEnd = toks_.OffsetAt(close, oldSize) + toks_.Raw(close).length;
+    const uint32_t bodyEnd = static_cast<uint32_t>(oldBodyEnd + delta);
+    if(!procClean_[proc] || (errs_.Size() && errs_.OffsetAt(0, oldSize) < bodyBegin))
+        return false;
+
+    // 单独取出编辑后的函数体，重新进行词法分析和语法分析
+    std::string body;
+    body.reserve(bodyEnd - bodyBegin + SourceFile::PADDING);
+    text_.CopyTo(bodyBegin, bodyEnd, body);
+    body.append(SourceFile::PADDING, '\0');
+
+    std::vector<TokenizerError> bodyLexErrs;
+    const Tokenizer::TokenStream bodyToks =
+        Tokenizer(body.data(), bodyEnd - bodyBegin, filename_).Tokenize(bodyLexErrs);
+
+    // 外层的名字在其作用域中、并且定义在这个过程之前时可见
+    std::vector<uint32_t> scopes;
+    for(uint32_t s = procParents_[proc]; ; s = procParents_[s])
+    {
+        scopes.push_back(s);
+        if(s == MAIN)
+            break;
+    }
+    const Proc &old = procs_[proc];
+    const size_t varBase = old.varPosBegin;
+    const size_t procBase = procPosBegins_[proc];
+    auto visible = [&scopes](const std::unordered_map<ScopedName, size_t, ScopedNameHash> &defs,
+                             const Name &name, size_t limit)
+    {
+        for(uint32_t s : scopes)
+        {
+            const auto it = defs.find(ScopedName{ s, name });
+            if(it != defs.end() && it->second < limit)
+                return true;
+        }
+        return false;
+    };
+    Parser::OuterScope outer;
+    outer.hasVar = [&](const Name &name) { return visible(scopeVars_, name, varBase); };
+    outer.hasProc = [&](const Name &name) { return visible(scopeProcs_, name, procBase); };
+
+    Parser parser(bodyToks, filename_);
+    Parser::ProcSpan span;
+    if(!parser.ParseDetachedBody(procParams_[proc], old.name, old.level, outer, span) || !span.clean)
+        return false;
+
+    // 函数体定义的变量和过程没有变化时，其后的分析结果不受影响
+    const VarTable &vars = parser.GetVars();
+    const ProcTable &procs = parser.GetProcs();
+    if(vars.size() != old.varPosEnd - old.varPosBegin || procs.size() != proc - procBase)
+        return false;
+    for(size_t i = 0; i < vars.size(); ++i)
+    {
+        const Var &x = vars[i], &y = vars_[varBase + i];
+        if(x.name != y.name || x.proc != y.proc || x.kind != y.kind || x.type != y.type ||
+           x.level != y.level)
+            return false;
+    }
+    for(size_t i = 0; i < procs.size(); ++i)
+    {
+        const Proc &x = procs[i], &y = procs_[procBase + i];
+        if(x.name != y.name || x.returnType != y.returnType || x.level != y.level ||
+           x.varPosBegin + varBase != y.varPosBegin || x.varPosEnd + varBase != y.varPosEnd)
+            return false;
+    }
+
+    // 替换函数体中的词法单元，重新记录其中各个函数体的begin
+    toks_.MoveGap(open, oldSize);
+    toks_.Erase(close + 1 - open);
+    for(size_t i = 0; i + 1 < bodyToks.Size(); ++i)
+    {
+        toks_.Insert(TokenRecord{ bodyToks.Offset(i) + bodyBegin, bodyToks.Length(i),
+                                  bodyToks.Value(i), bodyToks.Type(i) });
+    }
+    toks_.Raw(open).value = static_cast<int>(proc + 1);
+    const std::vector<Parser::ProcSpan> &spans = parser.GetProcSpans();
+    for(size_t i = 0; i < spans.size(); ++i)
+    {
+        toks_.Raw(open + spans[i].bodyBegin).value = static_cast<int>(procBase + i + 1);
+        procParams_[procBase + i] = bodyToks.NameAt(spans[i].paramTok);
+        procClean_[procBase + i] = spans[i].clean;
+    }
+
+    // 替换函数体中的词法错误和语法错误
+    const size_t lexFirst = lexErrs_.LowerBound(bodyBegin, oldSize);
+    const size_t lexLast = lexErrs_.LowerBound(oldBodyEnd, oldSize);
+    lexErrs_.MoveGap(lexFirst, oldSize);
+    lexErrs_.Erase(lexLast - lexFirst);
+    for(TokenizerError e : bodyLexErrs)
+    {
+        e.offset += bodyBegin;
+        lexErrs_.Insert(e);
+    }
+
+    const size_t errFirst = errs_.LowerBound(bodyBegin, oldSize);
+    const size_t errLast = errs_.LowerBound(oldBodyEnd, oldSize);
+    errs_.MoveGap(errFirst, oldSize);
+    errs_.Erase(errLast - errFirst);
+    for(const ParserError &e : parser.GetErrs())
+        errs_.Insert(SyntaxError{ e.offset + bodyBegin, e.msg });
+
+    return true;
+}
+
+std::string IncrementalParser::GetSource(void) const
+{
+    std::string rt;
+    rt.reserve(text_.Size());
+    text_.CopyTo(0, text_.Size(), rt);
+    return rt;
+}
+
+size_t IncrementalParser::GetSourceSize(void) const
+{
+    return text_.Size();
+}
+
+size_t IncrementalParser::TokenCount(void) const
+{
+    return toks_.Size();
+}
+
+IncrementalParser::Token IncrementalParser::GetToken(size_t i) const
+{
+    const TokenRecord &t = toks_.Raw(i);
+    return Token{ t.type, toks_.OffsetAt(i, Total()), t.length,
+                  t.type == TokenType::Begin ? 0 : t.value };
+}
+
+int IncrementalParser::LineAt(uint32_t offset) const
+{
+    return static_cast<int>(lineStarts_.UpperBound(offset, Total()));
+}
+
+size_t IncrementalParser::LineCount(void) const
+{
+    return lineStarts_.Size();
+}
+
+std::vector<TokenizerError> IncrementalParser::GetLexErrs(void) const
+{
+    std::vector<TokenizerError> rt;
+    rt.reserve(lexErrs_.Size());
+    for(size_t i = 0; i < lexErrs_.Size(); ++i)
+    {
+        rt.push_back(lexErrs_.At(i, Total()));
+        rt.back().line = LineAt(rt.back().offset);
+    }
+    return rt;
+}
+
+Parser::Errs IncrementalParser::GetErrs(void) const
+{
+    Parser::Errs rt;
+    rt.reserve(errs_.Size());
+    for(size_t i = 0; i < errs_.Size(); ++i)
+    {
+        const uint32_t offset = errs_.OffsetAt(i, Total());
+        rt.push_back(ParserError(filename_, LineAt(offset), offset, errs_.Raw(i).msg));
+    }
+    return rt;
+}
+
+std::string IncrementalParser::LexErrMessage(const TokenizerError &e) const
+{
+    // Message从源代码中取出出错的片段，这里只给它这一段
+    std::string str;
+    text_.CopyTo(e.offset, e.offset + e.length, str);
+    TokenizerError local = e;
+    local.offset = 0;
+    return local.Message(str.c_str());
+}
+
+const VarTable &IncrementalParser::GetVars(void) const
+{
+    return vars_;
+}
+
+const ProcTable &IncrementalParser::GetProcs(void) const
+{
+    return procs_;
+}
+
+void IncrementalParser::Rebuild(void)
+{
+    const size_t size = text_.Size();
+    const char *src = text_.Contiguous(SourceFile::PADDING);
+    hasNul_ = std::memchr(src, '\0', size) != nullptr;
+
+    std::vector<TokenizerError> lexErrs;
+    const Tokenizer::TokenStream toks = Tokenizer(src, size, filename_).Tokenize(lexErrs);
+    Parser parser(toks, filename_);
+    parser.Parse();
+
+    std::vector<TokenRecord> records;
+    records.reserve(GapVector<TokenRecord>::GapSize(toks.Size()));
+    for(size_t i = 0; i < toks.Size(); ++i)
+        records.push_back(TokenRecord{ toks.Offset(i), toks.Length(i), toks.Value(i), toks.Type(i) });
+
+    const std::vector<Parser::ProcSpan> &spans = parser.GetProcSpans();
+    procParams_.resize(spans.size());
+    procPosBegins_.resize(spans.size());
+    procClean_.resize(spans.size());
+    for(size_t i = 0; i < spans.size(); ++i)
+    {
+        records[spans[i].bodyBegin].value = static_cast<int>(i + 1);
+        procParams_[i] = toks.NameAt(spans[i].paramTok);
+        procPosBegins_[i] = spans[i].procPosBegin;
+        procClean_[i] = spans[i].clean;
+    }
+    toks_.Assign(std::move(records));
+
+    std::vector<LineStart> lines;
+    lines.reserve(GapVector<LineStart>::GapSize(toks.LineStarts().size()));
+    for(uint32_t offset : toks.LineStarts())
+        lines.push_back(LineStart{ offset });
+    lineStarts_.Assign(std::move(lines));
+
+    lexErrs_.Assign(std::move(lexErrs));
+
+    std::vector<SyntaxError> errs;
+    errs.reserve(parser.GetErrs().size());
+    for(const ParserError &e : parser.GetErrs())
+        errs.push_back(SyntaxError{ e.offset, e.msg });
+    errs_.Assign(std::move(errs));
+
+    vars_ = parser.GetVars();
+    procs_ = parser.GetProcs();
+    BuildScopes();
+}
+
+void IncrementalParser::BuildScopes(void)
+{
+    // 过程按分析完的先后存放，其函数体中的过程都在它之前，并且从procPosBegins_起连续存放，
+    // 其中尚未找到所在作用域的就是直接定义在它的函数体中的；
+    // 函数体的变量中除去这些过程的之外，都直接定义在它的函数体中
+    procParents_.assign(procs_.size(), MAIN);
+    std::vector<uint32_t> varScopes(vars_.size(), MAIN);
+    std::vector<uint32_t> pending;
+    for(uint32_t p = 0; p < procs_.size(); ++p)
+    {
+        const auto first = std::lower_bound(pending.begin(), pending.end(), procPosBegins_[p]);
+        size_t v = procs_[p].varPosBegin;
+        for(auto it = first; it != pending.end(); ++it)
+        {
+            procParents_[*it] = p;
+            for(; v < procs_[*it].varPosBegin; ++v)
+                varScopes[v] = p;
+            v = std::max(v, procs_[*it].varPosEnd);
+        }
+        for(; v < procs_[p].varPosEnd; ++v)
+            varScopes[v] = p;
+        pending.erase(first, pending.end());
+        pending.push_back(p);
+    }
+
+    // 同一作用域中的名字不会重复定义（重复的定义不会进入各个表），有多个时保留最早的一个
+    scopeVars_.clear();
+    scopeVars_.reserve(vars_.size());
+    for(size_t v = 0; v < vars_.size(); ++v)
+        scopeVars_.emplace(ScopedName{ varScopes[v], vars_[v].name }, v);
+    scopeProcs_.clear();
+    scopeProcs_.reserve(procs_.size());
+    for(size_t p = 0; p < procs_.size(); ++p)
+        scopeProcs_.emplace(ScopedName{ procParents_[p], procs_[p].name }, p);
+}
@@ -0,0 +1,155 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GapVector.h"
+#include "Parser.h"
+#include "Tokenizer.h"
+
+// 对源代码的一次编辑：用text替换[offset, offset + length)
+struct SourceEdit
+{
+    size_t offset;
+    size_t length;
+    std::string text;
+};
+
+// 供编辑器使用的增量分析
+// 源代码、词法单元、行首偏移和两种错误都放在间隙数组中（见GapVector.h），
+// 编辑处之后的内容以到末尾的距离记录，不随编辑移动
+// 每次编辑只重新分析包含它的最内层函数体：函数体单独取出来分析，外层的名字按定义的位置查找，
+// 定义的变量和过程没有变化时VarTable和ProcTable保持不变，只替换这个函数体中的词法单元和错误
+// 编辑改变了函数体的边界或者其中的定义，或者位于主程序中时，退回到完整的分析
+class IncrementalParser
+{
+public:
+
+    struct Token
+    {
+        TokenType type;
+        uint32_t offset, length;
+        int value;
+    };
+
+    IncrementalParser(const std::string &src, const std::string &filename);
+
+    IncrementalParser(const IncrementalParser &) = delete;
+    IncrementalParser &operator=(const IncrementalParser &) = delete;
+
+    // 依次应用各个编辑，每个编辑的偏移都以应用了之前的编辑后的源代码为准
+    // 返回是否全部通过增量分析完成
+    bool Apply(const std::vector<SourceEdit> &edits);
+
+    bool Apply(const SourceEdit &edit);
+
+    std::string GetSource(void) const;
+
+    size_t GetSourceSize(void) const;
+
+    // 词法单元序列，最后一个是结束标志
+    size_t TokenCount(void) const;
+
+    Token GetToken(size_t i) const;
+
+    // 源代码中offset处所在的行
+    int LineAt(uint32_t offset) const;
+
+    size_t LineCount(void) const;
+
+    // 以下两项按出现的顺序排列，行号为当前源代码中的行号
+    std::vector<TokenizerError> GetLexErrs(void) const;
+
+    Parser::Errs GetErrs(void) const;
+
+    std::string LexErrMessage(const TokenizerError &e) const;
+
+    const VarTable &GetVars(void) const;
+
+    const ProcTable &GetProcs(void) const;
+
+private:
+
+    // 词法单元；函数体的begin（关键字的value本来总为0）在value中记录其过程在ProcTable中的位置加1
+    struct TokenRecord
+    {
+        uint32_t offset, length;
+        int value;
+        TokenType type;
+    };
+
+    struct LineStart
+    {
+        uint32_t offset;
+    };
+
+    struct SyntaxError
+    {
+        uint32_t offset;
+        std::string msg;
+    };
+
+    // 某一层作用域（过程在ProcTable中的位置，主程序为MAIN）中的一个名字
+    struct ScopedName
+    {
+        uint32_t scope;
+        Name name;
+
+        bool operator==(const ScopedName &other) const
+        {
+            return scope == other.scope && name == other.name;
+        }
+    };
+
+    struct ScopedNameHash
+    {
+        size_t operator()(const ScopedName &n) const
+        {
+            return n.name.Hash() ^ (n.scope * 0x9e3779b9u);
+        }
+    };
+
+    static constexpr uint32_t MAIN = UINT32_MAX;
+
+    // 在已经应用到源代码和行首偏移表的编辑之后，重新分析包含它的最内层函数体
+    // [a, b)为编辑前受影响的词法单元，delta为源代码长度的变化，oldSize为编辑前的长度，失败时返回false
+    bool ReparseBody(size_t a, size_t b, int64_t delta, uint32_t oldSize);
+
+    // 重新进行完整的词法分析和语法分析
+    void Rebuild(void);
+
+    // 按各定义所在的作用域建立名字的索引，增量分析不改变各个表，因此只在完整的分析之后建立
+    void BuildScopes(void);
+
+    uint32_t Total(void) const
+    {
+        return static_cast<uint32_t>(text_.Size());
+    }
+
+    std::string filename_;
+
+    GapText text_;
+    bool hasNul_;
+
+    GapVector<TokenRecord> toks_;
+    GapVector<LineStart> lineStarts_;
+    GapVector<TokenizerError> lexErrs_;
+    GapVector<SyntaxError> errs_;
+
+    VarTable vars_;
+    ProcTable procs_;
+
+    // 与procs_一一对应：参数名，函数体中第一个过程的位置，函数体分析结束时层次是否正确恢复
+    std::vector<Name> procParams_;
+    std::vector<size_t> procPosBegins_;
+    std::vector<bool> procClean_;
+
+    // 由BuildScopes建立：各过程所在的作用域，以及各作用域中的变量和过程
+    std::vector<uint32_t> procParents_;
+    std::unordered_map<ScopedName, size_t, ScopedNameHash> scopeVars_;
+    std::unordered_map<ScopedName, size_t, ScopedNameHash> scopeProcs_;
+};
+
+#endif // INCREMENTAL_H
@@ -0,0 +1,408 @@
+#include "Ir.h"
+
+size_t IrFunction::InstCount(void) const
+{
+    size_t count = 0;
+    for(const IrBlock &block : blocks)
+        count += block.insts.size();
+    return count;
+}
+
+size_t IrProgram::InstCount(void) const
+{
+    size_t count = 0;
+    for(const IrFunction &function : functions)
+        count += function.InstCount();
+    return count;
+}
+
+IrBuilder::IrBuilder(const Ast &ast, const VarTable &vars, const ProcTable &procs)
+    : ast_(ast), vars_(vars), procs_(procs), layout_(vars, procs),
+      function_(nullptr), block_(0), level_(1)
+{
+
+}
+
+IrProgram IrBuilder::Build(void)
+{
+    program_ = IrProgram();
+    escaped_.assign(vars_.size(), false);
+
+    const AstNode &root = ast_[ast_.Root()];
+
+    FindEscaped(root.child[1], 1);
+    FindEscapedInProcs(root.child[0]);
+
+    paramVars_.assign(procs_.size(), -1);
+    for(size_t v = 0; v < vars_.size(); ++v)
+    {
+        const size_t owner = layout_.Owner(v);
+        if(vars_[v].kind == VarKind::Parameter && owner != layout_.MainFrame())
+            paramVars_[owner] = static_cast<int>(v);
+    }
+
+    BuildFunction(layout_.MainFrame(), root.child[1]);
+    BuildProcs(root.child[0]);
+
+    return std::move(program_);
+}
+
+void IrBuilder::FindEscaped(NodeIndex first, int32_t level)
+{
+    for(NodeIndex i = first; i != NO_NODE; i = ast_[i].next)
+    {
+        const AstNode &node = ast_[i];
+        switch(node.kind)
+        {
+        case AstKind::Read:
+        case AstKind::Write:
+            MarkEscaped(node.value, level);
+            break;
+
+        case AstKind::If:
+        {
+            const AstNode &cond = ast_[node.child[0]];
+            FindEscapedInExpr(cond.child[0], level);
+            FindEscapedInExpr(cond.child[1], level);
+            FindEscaped(node.child[1], level);
+            FindEscaped(node.child[2], level);
+            break;
+        }
+
+        case AstKind::Assign:
+            if(!(node.flags & ASSIGN_RESULT))
+                MarkEscaped(node.value, level);
+            FindEscapedInExpr(node.child[0], level);
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+void IrBuilder::FindEscapedInProcs(NodeIndex first)
+{
+    for(NodeIndex i = first; i != NO_NODE; i = ast_[i].next)
+    {
+        const AstNode &node = ast_[i];
+        FindEscaped(node.child[1], layout_.Level(node.value));
+        FindEscapedInProcs(node.child[0]);
+    }
+}
+
+void IrBuilder::FindEscapedInExpr(NodeIndex i, int32_t level)
+{
+    const AstNode &node = ast_[i];
+    switch(node.kind)
+    {
+    case AstKind::VarRef:
+        MarkEscaped(node.value, level);
+        break;
+
+    case AstKind::Minus:
+    case AstKind::Times:
+        FindEscapedInExpr(node.child[0], level);
+        FindEscapedInExpr(node.child[1], level);
+        break;
+
+    case AstKind::Call:
+        FindEscapedInExpr(node.child[0], level);
+        break;
+
+    default:
+        break;
+    }
+}
+
+void IrBuilder::MarkEscaped(int var, int32_t level)
+{
+    if(vars_[var].level < level)
+        escaped_[var] = true;
+}
+
+void IrBuilder::BuildFunction(size_t proc, NodeIndex execs)
+{
+    program_.functions.emplace_back();
+    function_ = &program_.functions.back();
+    function_->proc = proc;
+    function_->valueCount = 0;
+
+    level_ = layout_.Level(proc);
+    block_ = NewBlock(-1);
+
+    // 返回值和变量都从0开始
+    current_.assign(layout_.FrameSize(proc), Emit(IrOp::Const, NO_VALUE, NO_VALUE, 0));
+
+    if(proc != layout_.MainFrame() && paramVars_[proc] >= 0)
+        WriteVar(paramVars_[proc], Emit(IrOp::Param));
+
+    BuildExecs(execs);
+
+    if(proc == layout_.MainFrame())
+        EmitNoValue(IrOp::Ret);
+    else
+        EmitNoValue(IrOp::Ret, current_[0]);
+}
+
+void IrBuilder::BuildProcs(NodeIndex first)
+{
+    for(NodeIndex i = first; i != NO_NODE; i = ast_[i].next)
+    {
+        const AstNode &node = ast_[i];
+        BuildFunction(node.value, node.child[1]);
+        BuildProcs(node.child[0]);
+    }
+}
+
+void IrBuilder::BuildExecs(NodeIndex first)
+{
+    for(NodeIndex i = first; i != NO_NODE; i = ast_[i].next)
+        BuildExec(i);
+}
+
+void IrBuilder::BuildExec(NodeIndex i)
+{
+    const AstNode &node = ast_[i];
+    switch(node.kind)
+    {
+    case AstKind::Read:
+        WriteVar(node.value, Emit(IrOp::Read));
+        break;
+
+    case AstKind::Write:
+        EmitNoValue(IrOp::Write, ReadVar(node.value));
+        break;
+
+    case AstKind::If:
+    {
+        const AstNode &cond = ast_[node.child[0]];
+        const IrValue a = BuildExpr(cond.child[0]);
+        const IrValue b = BuildExpr(cond.child[1]);
+        EmitNoValue(IrOp::Branch, a, b);
+
+        const int32_t head = block_;
+        const size_t branch = function_->blocks[head].insts.size() - 1;
+        function_->blocks[head].insts[branch].cond = cond.op;
+        std::vector<IrValue> saved = current_;
+
+        const int32_t thenBlock = block_ = NewBlock(head);
+        BuildExec(node.child[1]);
+        const int32_t thenEnd = block_;
+        EmitNoValue(IrOp::Jump);
+
+        std::vector<IrValue> thenValues = std::move(current_);
+        current_ = std::move(saved);
+
+        const int32_t elseBlock = block_ = NewBlock(head);
+        BuildExec(node.child[2]);
+        const int32_t elseEnd = block_;
+        EmitNoValue(IrOp::Jump);
+
+        const int32_t join = block_ = NewBlock(head);
+        std::vector<IrBlock> &blocks = function_->blocks;
+        blocks[head].insts[branch].imm = thenBlock;
+        blocks[head].insts[branch].imm2 = elseBlock;
+        blocks[thenEnd].insts.back().imm = join;
+        blocks[elseEnd].insts.back().imm = join;
+        blocks[join].preds[0] = thenEnd;
+        blocks[join].preds[1] = elseEnd;
+
+        for(size_t s = 0; s < current_.size(); ++s)
+        {
+            if(thenValues[s] != current_[s])
+                current_[s] = Emit(IrOp::Phi, thenValues[s], current_[s]);
+        }
+        break;
+    }
+
+    case AstKind::Assign:
+    {
+        const IrValue value = BuildExpr(node.child[0]);
+        if(node.flags & ASSIGN_RESULT)
+            current_[0] = Emit(IrOp::Copy, value);
+        else
+            WriteVar(node.value, value);
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+IrValue IrBuilder::BuildExpr(NodeIndex i)
+{
+    const AstNode &node = ast_[i];
+    switch(node.kind)
+    {
+    case AstKind::IntLiteral:
+        return Emit(IrOp::Const, NO_VALUE, NO_VALUE, node.value);
+
+    case AstKind::VarRef:
+        return ReadVar(node.value);
+
+    case AstKind::Minus:
+    case AstKind::Times:
+    {
+        const IrValue a = BuildExpr(node.child[0]);
+        const IrValue b = BuildExpr(node.child[1]);
+        return Emit(node.kind == AstKind::Minus ? IrOp::Sub : IrOp::Mul, a, b);
+    }
+
+    case AstKind::Call:
+    {
+        const IrValue arg = BuildExpr(node.child[0]);
+        const IrValue result = Emit(IrOp::Call, arg, NO_VALUE, ast_[node.value].value);
+        function_->blocks[block_].insts.back().imm2 = node.line;
+        return result;
+    }
+
+    default:
+        return NO_VALUE;
+    }
+}
+
+IrValue IrBuilder::ReadVar(int var)
+{
+    if(IsPromoted(var))
+        return current_[layout_.Slot(var)];
+    return Emit(IrOp::Load, NO_VALUE, NO_VALUE, var);
+}
+
+void IrBuilder::WriteVar(int var, IrValue value)
+{
+    if(IsPromoted(var))
+        current_[layout_.Slot(var)] = Emit(IrOp::Copy, value);
+    else
+        EmitNoValue(IrOp::Store, value, NO_VALUE, var);
+}
+
+bool IrBuilder::IsPromoted(int var) const
+{
+    // 未提升的变量若在本层函数体中定义，一定在某个内层过程中被访问过
+    return vars_[var].level == level_ && !escaped_[var];
+}
+
+int32_t IrBuilder::NewBlock(int32_t idom)
+{
+    function_->blocks.push_back(IrBlock{ { }, idom, { -1, -1 }, true });
+    return static_cast<int32_t>(function_->blocks.size() - 1);
+}
+
+IrValue IrBuilder::Emit(IrOp op, IrValue a, IrValue b, int32_t imm)
+{
+    const IrValue dest = function_->valueCount++;
+    function_->blocks[block_].insts.push_back(IrInst{ op, 0, dest, a, b, imm, 0 });
+    return dest;
+}
+
+void IrBuilder::EmitNoValue(IrOp op, IrValue a, IrValue b, int32_t imm)
+{
+    function_->blocks[block_].insts.push_back(IrInst{ op, 0, NO_VALUE, a, b, imm, 0 });
+}
+
+namespace
+{
+    const char *CondName(uint8_t cond)
+    {
+        switch(static_cast<TokenType>(cond))
+        {
+        case TokenType::Less:         return "lt";
+        case TokenType::LessEqual:    return "le";
+        case TokenType::Equal:        return "eq";
+        case TokenType::GreaterEqual: return "ge";
+        case TokenType::Greater:      return "gt";
+        default:                      return "ne";
+        }
+    }
+
+    void PrintInst(std::ostream &out, const IrInst &inst,
+                   const IrBlock &block, const VarTable &vars, const ProcTable &procs)
+    {
+        out << "    ";
+        if(inst.dest != NO_VALUE)
+            out << '%' << inst.dest << " = ";
+
+        switch(inst.op)
+        {
+        case IrOp::Const:
+            out << "const " << inst.imm;
+            break;
+        case IrOp::Param:
+            out << "param";
+            break;
+        case IrOp::Load:
+            out << "load " << vars[inst.imm].name << '#' << inst.imm;
+            break;
+        case IrOp::Store:
+            out << "store " << vars[inst.imm].name << '#' << inst.imm << ", %" << inst.a;
+            break;
+        case IrOp::Copy:
+            out << "copy %" << inst.a;
+            break;
+        case IrOp::Sub:
+            out << "sub %" << inst.a << ", %" << inst.b;
+            break;
+        case IrOp::Mul:
+            out << "mul %" << inst.a << ", %" << inst.b;
+            break;
+        case IrOp::Phi:
+            out << "phi [%" << inst.a << ", L" << block.preds[0]
+                << "], [%" << inst.b << ", L" << block.preds[1] << ']';
+            break;
+        case IrOp::Call:
+            out << "call " << procs[inst.imm].name << '#' << inst.imm << "(%" << inst.a << ')';
+            break;
+        case IrOp::Read:
+            out << "read";
+            break;
+        case IrOp::Write:
+            out << "write %" << inst.a;
+            break;
+        case IrOp::Branch:
+            out << "br " << CondName(inst.cond) << " %" << inst.a << ", %" << inst.b
+                << ", L" << inst.imm << ", L" << inst.imm2;
+            break;
+        case IrOp::Jump:
+            out << "jmp L" << inst.imm;
+            break;
+        case IrOp::Ret:
+            out << "ret";
+            if(inst.a != NO_VALUE)
+                out << " %" << inst.a;
+            break;
+        case IrOp::Nop:
+            out << "nop";
+            break;
+        }
+        out << '\n';
+    }
+}
+
+void PrintIr(std::ostream &out, const IrProgram &program,
+             const VarTable &vars, const ProcTable &procs)
+{
+    for(const IrFunction &function : program.functions)
+    {
+        if(function.proc == procs.size())
+            out << "function main (level 1)\n";
+        else
+            out << "function " << procs[function.proc].name << '#' << function.proc
+                << " (level " << procs[function.proc].level + 1 << ")\n";
+
+        for(size_t b = 0; b < function.blocks.size(); ++b)
+        {
+            const IrBlock &block = function.blocks[b];
+            if(!block.reachable)
+                continue;
+            out << 'L' << b << ':';
+            if(block.idom >= 0)
+                out << "    ; idom L" << block.idom;
+            out << '\n';
+            for(const IrInst &inst : block.insts)
+                PrintInst(out, inst, block, vars, procs);
+        }
+        out << '\n';
+    }
+}
@@ -0,0 +1,182 @@
+#ifndef IR_H
+#define IR_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "Ast.h"
+#include "FrameLayout.h"
+#include "Parser.h"
+
+// SSA形式的三地址中间表示
+// 每条指令至多定义一个值，值在所属函数中从0开始编号
+// 只在本层函数体中访问的变量提升为SSA值，被内层过程访问的变量（调用可能修改它们）
+// 仍存放在活动记录中，以Load和Store访问
+// 语言中没有循环，控制流图无环；基本块按创建的顺序排列，前驱总在后继之前，
+// 且每个汇合块恰有两个前驱（if的两个分支）
+
+using IrValue = int32_t;
+
+constexpr IrValue NO_VALUE = -1;
+
+enum class IrOp : uint8_t
+{
+    Const,      // dest = imm
+    Param,      // dest = 实参
+    Load,       // dest = 变量imm
+    Store,      // 变量imm = a
+    Copy,       // dest = a
+    Sub,        // dest = a - b
+    Mul,        // dest = a * b
+    Phi,        // dest = 从第一个前驱到达时为a，从第二个前驱到达时为b
+    Call,       // dest = 过程imm(a)，imm2为调用所在的行
+    Read,       // dest = 读入的整数
+    Write,      // 输出a
+    Branch,     // 比较a和b，满足cond时转到块imm，否则转到块imm2
+    Jump,       // 转到块imm
+    Ret,        // 返回a，主程序没有a
+    Nop         // 已删除，由优化遍在结束时清理
+};
+
+struct IrInst
+{
+    IrOp op;
+    uint8_t cond;       // Branch: 比较运算符的TokenType
+    IrValue dest;
+    IrValue a;
+    IrValue b;
+    int32_t imm;
+    int32_t imm2;
+};
+
+// 运算按补码回绕，与字节码和生成的汇编一致
+inline int32_t IrSub(int32_t a, int32_t b)
+{
+    return static_cast<int32_t>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b));
+}
+
+inline int32_t IrMul(int32_t a, int32_t b)
+{
+    return static_cast<int32_t>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b));
+}
+
+// Branch的比较
+inline bool IrCompare(uint8_t cond, int32_t a, int32_t b)
+{
+    switch(static_cast<TokenType>(cond))
+    {
+    case TokenType::Less:         return a < b;
+    case TokenType::LessEqual:    return a <= b;
+    case TokenType::Equal:        return a == b;
+    case TokenType::GreaterEqual: return a >= b;
+    case TokenType::Greater:      return a > b;
+    default:                      return a != b;
+    }
+}
+
+struct IrBlock
+{
+    std::vector<IrInst> insts;
+
+    // 直接支配者，入口块为-1
+    int32_t idom;
+
+    // 汇合块的两个前驱，Phi的a、b依次与之对应；其他块为-1
+    int32_t preds[2];
+
+    // 常量传播删去的不可达块不再有指令
+    bool reachable;
+};
+
+struct IrFunction
+{
+    // 在ProcTable中的位置，主程序为FrameLayout::MainFrame()
+    size_t proc;
+
+    // 第0块为入口
+    std::vector<IrBlock> blocks;
+
+    int32_t valueCount;
+
+    size_t InstCount(void) const;
+};
+
+struct IrProgram
+{
+    // 主程序在最前，之后的过程按在源程序中出现的顺序排列
+    std::vector<IrFunction> functions;
+
+    size_t InstCount(void) const;
+};
+
+// 把语法树翻译成IR，要求分析没有任何错误
+// 翻译是直接的：每个字面量一条Const，每次给提升的变量赋值一条Copy，
+// 冗余留给之后的优化遍处理
+class IrBuilder
+{
+public:
+
+    IrBuilder(const Ast &ast, const VarTable &vars, const ProcTable &procs);
+
+    IrProgram Build(void);
+
+private:
+
+    // 找出被内层过程访问的变量
+    void FindEscaped(NodeIndex execs, int32_t level);
+
+    void FindEscapedInProcs(NodeIndex first);
+
+    void FindEscapedInExpr(NodeIndex expr, int32_t level);
+
+    void MarkEscaped(int var, int32_t level);
+
+    void BuildFunction(size_t proc, NodeIndex execs);
+
+    void BuildProcs(NodeIndex first);
+
+    void BuildExecs(NodeIndex first);
+
+    void BuildExec(NodeIndex node);
+
+    IrValue BuildExpr(NodeIndex node);
+
+    IrValue ReadVar(int var);
+
+    void WriteVar(int var, IrValue value);
+
+    bool IsPromoted(int var) const;
+
+    int32_t NewBlock(int32_t idom);
+
+    IrValue Emit(IrOp op, IrValue a = NO_VALUE, IrValue b = NO_VALUE, int32_t imm = 0);
+
+    void EmitNoValue(IrOp op, IrValue a = NO_VALUE, IrValue b = NO_VALUE, int32_t imm = 0);
+
+private:
+
+    const Ast &ast_;
+    const VarTable &vars_;
+    const ProcTable &procs_;
+    const FrameLayout layout_;
+
+    std::vector<bool> escaped_;
+
+    // 每个过程的参数在VarTable中的位置，函数体中没有定义参数时为-1
+    std::vector<int> paramVars_;
+
+    IrProgram program_;
+    IrFunction *function_;
+    int32_t block_;
+    int32_t level_;
+
+    // 提升的变量在当前位置的值，以在活动记录中的位置为下标，第0个为返回值
+    std::vector<IrValue> current_;
+};
+
+// 以文本形式输出，用于.ir文件
+void PrintIr(std::ostream &out, const IrProgram &program,
+             const VarTable &vars, const ProcTable &procs);
+
+#endif // IR_H
@@ -0,0 +1,427 @@
+#include <algorithm>
+#include <chrono>
+
+#include "IrOpt.h"
+#include "PartialEval.h"
+
+namespace
+{
+    // 被删去的指令的结果由replace中记录的值代替，沿替换链解析到最终的值
+    IrValue Resolve(std::vector<IrValue> &replace, IrValue v)
+    {
+        if(v == NO_VALUE)
+            return v;
+        IrValue root = v;
+        while(replace[root] != root)
+            root = replace[root];
+        while(replace[v] != root)
+        {
+            const IrValue next = replace[v];
+            replace[v] = root;
+            v = next;
+        }
+        return root;
+    }
+
+    std::vector<IrValue> IdentityReplacements(const IrFunction &function)
+    {
+        std::vector<IrValue> replace(function.valueCount);
+        for(IrValue v = 0; v < function.valueCount; ++v)
+            replace[v] = v;
+        return replace;
+    }
+
+    void ResolveOperands(std::vector<IrValue> &replace, IrInst &inst)
+    {
+        inst.a = Resolve(replace, inst.a);
+        inst.b = Resolve(replace, inst.b);
+    }
+
+    // 以v代替inst的结果并删去inst
+    void ReplaceWith(std::vector<IrValue> &replace, IrInst &inst, IrValue v)
+    {
+        replace[inst.dest] = v;
+        inst.op = IrOp::Nop;
+    }
+
+    void MakeConst(IrInst &inst, int32_t value)
+    {
+        inst.op = IrOp::Const;
+        inst.a = inst.b = NO_VALUE;
+        inst.imm = value;
+    }
+
+    void RemoveNops(IrFunction &function)
+    {
+        for(IrBlock &block : function.blocks)
+        {
+            block.insts.erase(std::remove_if(block.insts.begin(), block.insts.end(),
+                [](const IrInst &inst) { return inst.op == IrOp::Nop; }), block.insts.end());
+        }
+    }
+
+    bool IsPure(IrOp op)
+    {
+        switch(op)
+        {
+        case IrOp::Const:
+        case IrOp::Param:
+        case IrOp::Load:
+        case IrOp::Copy:
+        case IrOp::Sub:
+        case IrOp::Mul:
+        case IrOp::Phi:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // 可以消除的表达式压缩成64位的键：最高两位区分Const、Sub和Mul，
+    // Const的低32位为常量，Sub和Mul依次为两个操作数（值的编号都小于2^31）；0表示空位
+    uint64_t ExprKey(const IrInst &inst)
+    {
+        switch(inst.op)
+        {
+        case IrOp::Const:
+            return 1ull << 62 | static_cast<uint32_t>(inst.imm);
+        case IrOp::Sub:
+            return 2ull << 62 | static_cast<uint64_t>(inst.a) << 31 | static_cast<uint64_t>(inst.b);
+        case IrOp::Mul:
+            return 3ull << 62 | static_cast<uint64_t>(std::min(inst.a, inst.b)) << 31 |
+                                static_cast<uint64_t>(std::max(inst.a, inst.b));
+        default:
+            return 0;
+        }
+    }
+
+    // 开放定址的散列表，容量固定为可能插入的键数的1.5倍以上，不会填满
+    // 只按插入的相反顺序删除：删去最后插入的键时，其后不再有键经过这个位置，直接清空即可
+    class ExprTable
+    {
+    public:
+
+        explicit ExprTable(size_t count)
+            : entries_(count + count / 2 + 16, Entry{ 0, NO_VALUE })
+        {
+
+        }
+
+        // 找到key时返回其值，否则插入value并返回NO_VALUE
+        IrValue FindOrInsert(uint64_t key, IrValue value)
+        {
+            size_t i = Slot(key);
+            for(; entries_[i].key != 0; i = i + 1 < entries_.size() ? i + 1 : 0)
+            {
+                if(entries_[i].key == key)
+                    return entries_[i].value;
+            }
+            entries_[i] = Entry{ key, value };
+            inserted_.push_back(i);
+            return NO_VALUE;
+        }
+
+        size_t Mark(void) const
+        {
+            return inserted_.size();
+        }
+
+        // 删去mark之后插入的键
+        void Rollback(size_t mark)
+        {
+            while(inserted_.size() > mark)
+            {
+                entries_[inserted_.back()].key = 0;
+                inserted_.pop_back();
+            }
+        }
+
+    private:
+
+        struct Entry
+        {
+            uint64_t key;
+            IrValue value;
+        };
+
+        // 值的编号是连续的，充分混合后再按比例映射到[0, size)
+        size_t Slot(uint64_t key) const
+        {
+            key ^= key >> 33;
+            key *= 0xFF51AFD7ED558CCDull;
+            key ^= key >> 33;
+            key *= 0xC4CEB9FE1A85EC53ull;
+            key ^= key >> 33;
+            return static_cast<size_t>(
+                (static_cast<unsigned __int128>(key) * entries_.size()) >> 64);
+        }
+
+        std::vector<Entry> entries_;
+        std::vector<size_t> inserted_;
+    };
+}
+
+void PropagateConstants(IrFunction &function)
+{
+    std::vector<IrValue> replace = IdentityReplacements(function);
+    std::vector<bool> known(function.valueCount, false);
+    std::vector<int32_t> value(function.valueCount, 0);
+
+    const auto isConst = [&known](IrValue v) { return v != NO_VALUE && known[v]; };
+
+    std::vector<IrBlock> &blocks = function.blocks;
+    for(size_t b = 0; b < blocks.size(); ++b)
+        blocks[b].reachable = b == 0;
+
+    // 前驱总在后继之前，按顺序扫描一遍即可，使用总在定义之后
+    for(IrBlock &block : blocks)
+    {
+        if(!block.reachable)
+        {
+            std::vector<IrInst>().swap(block.insts);
+            continue;
+        }
+
+        for(IrInst &inst : block.insts)
+        {
+            ResolveOperands(replace, inst);
+            switch(inst.op)
+            {
+            case IrOp::Copy:
+                if(isConst(inst.a))
+                    MakeConst(inst, value[inst.a]);
+                break;
+
+            case IrOp::Sub:
+                if(isConst(inst.a) && isConst(inst.b))
+                    MakeConst(inst, IrSub(value[inst.a], value[inst.b]));
+                else if(isConst(inst.b) && value[inst.b] == 0)
+                    ReplaceWith(replace, inst, inst.a);
+                else if(inst.a == inst.b)
+                    MakeConst(inst, 0);
+                break;
+
+            case IrOp::Mul:
+                if(isConst(inst.a) && isConst(inst.b))
+                    MakeConst(inst, IrMul(value[inst.a], value[inst.b]));
+                else if((isConst(inst.a) && value[inst.a] == 0) ||
+                        (isConst(inst.b) && value[inst.b] == 0))
+                    MakeConst(inst, 0);
+                else if(isConst(inst.a) && value[inst.a] == 1)
+                    ReplaceWith(replace, inst, inst.b);
+                else if(isConst(inst.b) && value[inst.b] == 1)
+                    ReplaceWith(replace, inst, inst.a);
+                break;
+
+            case IrOp::Phi:
+                if(!blocks[block.preds[0]].reachable)
+                    ReplaceWith(replace, inst, inst.b);
+                else if(!blocks[block.preds[1]].reachable)
+                    ReplaceWith(replace, inst, inst.a);
+                else if(inst.a == inst.b)
+                    ReplaceWith(replace, inst, inst.a);
+                else if(isConst(inst.a) && isConst(inst.b) && value[inst.a] == value[inst.b])
+                    MakeConst(inst, value[inst.a]);
+                break;
+
+            case IrOp::Branch:
+                if((isConst(inst.a) && isConst(inst.b)) || inst.a == inst.b)
+                {
+                    const bool taken = inst.a == inst.b ? IrCompare(inst.cond, 0, 0) :
+                                       IrCompare(inst.cond, value[inst.a], value[inst.b]);
+                    const int32_t target = taken ? inst.imm : inst.imm2;
+                    inst.op = IrOp::Jump;
+                    inst.a = inst.b = NO_VALUE;
+                    inst.imm = target;
+                }
+                break;
+
+            default:
+                break;
+            }
+
+            if(inst.op == IrOp::Const)
+            {
+                known[inst.dest] = true;
+                value[inst.dest] = inst.imm;
+            }
+        }
+
+        const IrInst &last = block.insts.back();
+        if(last.op == IrOp::Jump)
+            blocks[last.imm].reachable = true;
+        else if(last.op == IrOp::Branch)
+            blocks[last.imm].reachable = blocks[last.imm2].reachable = true;
+    }
+
+    RemoveNops(function);
+}
+
+void EliminateCommonSubexpressions(IrFunction &function)
+{
+    std::vector<IrValue> replace = IdentityReplacements(function);
+    std::vector<IrBlock> &blocks = function.blocks;
+
+    // 支配树，子节点按块的顺序排列，因此Phi的操作数总在Phi之前被处理
+    std::vector<std::vector<int32_t>> children(blocks.size());
+    for(size_t b = 1; b < blocks.size(); ++b)
+    {
+        if(blocks[b].reachable)
+            children[blocks[b].idom].push_back(static_cast<int32_t>(b));
+    }
+
+    // 作用域随支配树的深度优先遍历进出，离开一个块时撤销它加入的表达式
+    size_t candidates = 0;
+    for(const IrBlock &block : blocks)
+    {
+        for(const IrInst &inst : block.insts)
+            candidates += ExprKey(inst) != 0;
+    }
+    ExprTable available(candidates);
+
+    struct Visit
+    {
+        int32_t block;
+        size_t child;
+        size_t added;
+    };
+    std::vector<Visit> stack;
+    stack.push_back(Visit{ 0, 0, 0 });
+    bool entering = true;
+
+    while(!stack.empty())
+    {
+        Visit &visit = stack.back();
+        if(entering)
+        {
+            visit.added = available.Mark();
+            for(IrInst &inst : blocks[visit.block].insts)
+            {
+                ResolveOperands(replace, inst);
+
+                const uint64_t key = ExprKey(inst);
+                if(key == 0)
+                    continue;
+
+                const IrValue found = available.FindOrInsert(key, inst.dest);
+                if(found != NO_VALUE)
+                    ReplaceWith(replace, inst, found);
+            }
+        }
+
+        const std::vector<int32_t> &next = children[visit.block];
+        if(visit.child < next.size())
+        {
+            const int32_t child = next[visit.child++];
+            stack.push_back(Visit{ child, 0, 0 });
+            entering = true;
+        }
+        else
+        {
+            available.Rollback(visit.added);
+            stack.pop_back();
+            entering = false;
+        }
+    }
+
+    RemoveNops(function);
+}
+
+void PropagateCopies(IrFunction &function)
+{
+    std::vector<IrValue> replace = IdentityReplacements(function);
+    for(IrBlock &block : function.blocks)
+    {
+        for(IrInst &inst : block.insts)
+        {
+            ResolveOperands(replace, inst);
+            if(inst.op == IrOp::Copy)
+                ReplaceWith(replace, inst, inst.a);
+        }
+    }
+
+    RemoveNops(function);
+}
+
+void EliminateDeadCode(IrFunction &function)
+{
+    struct Location
+    {
+        int32_t block;
+        int32_t index;
+    };
+
+    std::vector<int32_t> uses(function.valueCount, 0);
+    std::vector<Location> defs(function.valueCount, Location{ -1, -1 });
+    std::vector<IrBlock> &blocks = function.blocks;
+
+    for(size_t b = 0; b < blocks.size(); ++b)
+    {
+        for(size_t i = 0; i < blocks[b].insts.size(); ++i)
+        {
+            const IrInst &inst = blocks[b].insts[i];
+            if(inst.dest != NO_VALUE)
+                defs[inst.dest] = Location{ static_cast<int32_t>(b), static_cast<int32_t>(i) };
+            if(inst.a != NO_VALUE)
+                ++uses[inst.a];
+            if(inst.b != NO_VALUE)
+                ++uses[inst.b];
+        }
+    }
+
+    std::vector<IrValue> dead;
+    for(IrValue v = 0; v < function.valueCount; ++v)
+    {
+        if(defs[v].block >= 0 && uses[v] == 0 &&
+           IsPure(blocks[defs[v].block].insts[defs[v].index].op))
+            dead.push_back(v);
+    }
+
+    // 删去一条指令后，其操作数可能随之失去最后一次使用
+    while(!dead.empty())
+    {
+        const Location at = defs[dead.back()];
+        dead.pop_back();
+
+        IrInst &inst = blocks[at.block].insts[at.index];
+        inst.op = IrOp::Nop;
+        for(const IrValue operand : { inst.a, inst.b })
+        {
+            if(operand != NO_VALUE && --uses[operand] == 0 &&
+               IsPure(blocks[defs[operand].block].insts[defs[operand].index].op))
+                dead.push_back(operand);
+        }
+    }
+
+    RemoveNops(function);
+}
+
+std::vector<IrPassStats> OptimizeIr(IrProgram &program, PartialEvaluator *evaluator)
+{
+    std::vector<IrPassStats> stats;
+    const auto measure = [&program, &stats](const char *name, const auto &run)
+    {
+        const size_t before = program.InstCount();
+        const auto begin = std::chrono::steady_clock::now();
+        run();
+        const double seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - begin).count();
+        stats.push_back(IrPassStats{ name, before, program.InstCount(), seconds });
+    };
+    const auto forEach = [&program](void (*pass)(IrFunction&))
+    {
+        return [&program, pass]
+        {
+            for(IrFunction &function : program.functions)
+                pass(function);
+        };
+    };
+
+    measure("copy propagation", forEach(PropagateCopies));
+    measure("constant propagation", forEach(PropagateConstants));
+    if(evaluator)
+        measure("partial evaluation", [&program, evaluator] { evaluator->Run(program); });
+    measure("common subexpression elimination", forEach(EliminateCommonSubexpressions));
+    measure("dead code elimination", forEach(EliminateDeadCode));
+    return stats;
+}
@@ -0,0 +1,37 @@
+#ifndef IROPT_H
+#define IROPT_H
+
+#include <vector>
+
+#include "Ir.h"
+
+class PartialEvaluator;
+
+// 一个优化遍在整个程序上的效果
+struct IrPassStats
+{
+    const char *name;
+    size_t before;
+    size_t after;
+    double seconds;
+};
+
+// 复写传播：以Copy的源代替其结果，删去所有Copy
+void PropagateCopies(IrFunction &function);
+
+// 常量传播：折叠常量运算和恒真恒假的分支，删去不可达的块，
+// 并化简x - 0、x * 1、x * 0、x - x和只有一个可达前驱的Phi
+void PropagateConstants(IrFunction &function);
+
+// 公共子表达式消除：沿支配树查找相同的Const、Sub和Mul，以支配者的值代替
+void EliminateCommonSubexpressions(IrFunction &function);
+
+// 死代码消除：删去结果没有被使用的无副作用指令（Read和Call保留）
+void EliminateDeadCode(IrFunction &function);
+
+// 依次执行以上各遍，返回每一遍的效果
+// 复写传播在最前，之后的遍比较值时不必再看穿Copy；
+// 给出evaluator时在常量传播之后做部分求值（见PartialEval.h）
+std::vector<IrPassStats> OptimizeIr(IrProgram &program, PartialEvaluator *evaluator = nullptr);
+
+#endif // IROPT_H
@@ -1,167 +1,584 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
-#include <iomanip>
 #include <iostream>
-#include <iterator>
-#include <map>
+#include <memory>
 #include <utility>
 
+#include "Asm.h"
+#include "Bytecode.h"
+#include "Compile.h"
+#include "DybFile.h"
+#include "DydFile.h"
+#include "Ir.h"
+#include "IrOpt.h"
+#include "OutputFile.h"
 #include "Parser.h"
+#include "PartialEval.h"
+#include "Server.h"
+#include "SourceFile.h"
+#include "ThreadPool.h"
 #include "Tokenizer.h"
+#include "Vm.h"
 
 using namespace std;
 
-bool ReadFile(const string &filename, string &output)
+// 由.dyb文件重新生成文本格式的.dyd、.dys、.varfil和.profil，
+// 内容与分析源文件时直接写出的完全相同，可以用来检查.dyb的读写
+int ConvertDyb(const string &filename)
 {
-    ifstream fin(filename, ifstream::in);
-    if(!fin)
+    DybFile dyb;
+    if(!dyb.Open(filename))
+    {
+        cout << "Cannot open dyb file: " << filename << endl;
+        return -1;
+    }
+    string error;
+    if(!dyb.Validate(error))
+    {
+        cout << "Invalid dyb file: " << filename << ": " << error << endl;
+        return -1;
+    }
+
+    const string dydFilename = ReplaceFileType(filename, "dyd");
+    OutputFile fout;
+    if(!fout.Open(dydFilename))
+    {
+        cout << "Failed to open dyd file" << endl;
+        return -1;
+    }
+    int line = 1;
+    for(size_t i = 0; i < dyb.TokenCount(); ++i)
+    {
+        const DybToken &t = dyb.Tokens()[i];
+        for(; line < t.line; ++line)
+            WriteDydToken(fout, "EOLN", TokenType::NewLine);
+        WriteDydToken(fout, dyb.String(t.str), static_cast<TokenType>(t.type));
+    }
+    if(!fout.Close() || !CopyDyd(dydFilename, ReplaceFileType(filename, "dys")))
+    {
+        cout << "Failed to write dyd file" << endl;
+        return -1;
+    }
+
+    VarTable vars(dyb.VarCount());
+    for(size_t i = 0; i < vars.size(); ++i)
+    {
+        const DybVar &v = dyb.Vars()[i];
+        vars[i] = Var{ Name(dyb.String(v.name)), Name(dyb.String(v.proc)),
+                       static_cast<VarKind>(v.kind), static_cast<VarType>(v.type),
+                       v.level, v.posInTable };
+    }
+    ProcTable procs(dyb.ProcCount());
+    for(size_t i = 0; i < procs.size(); ++i)
+    {
+        const DybProc &p = dyb.Procs()[i];
+        procs[i] = Proc{ Name(dyb.String(p.name)), static_cast<VarType>(p.returnType),
+                         p.level, p.varPosBegin, p.varPosEnd };
+    }
+
+    fout.Open(ReplaceFileType(filename, "varfil"));
+    WriteVarfil(fout, vars);
+    bool written = fout.Close();
+    fout.Open(ReplaceFileType(filename, "profil"));
+    WriteProfil(fout, procs);
+    written = fout.Close() && written;
+    if(!written)
+    {
+        cout << "Failed to write output files" << endl;
+        return -1;
+    }
+
+    cout << "Converted " << dyb.TokenCount() << " tokens, " << vars.size() << " vars, "
+         << procs.size() << " procs" << endl;
+    return 0;
+}
+
+// 把命令行中的文件和目录（递归查找其中的.pas文件）展开成文件列表
+bool CollectFiles(const vector<string> &paths, vector<string> &files)
+{
+    for(const string &path : paths)
+    {
+        error_code ec;
+        if(!filesystem::is_directory(path, ec))
+        {
+            files.push_back(path);
+            continue;
+        }
+
+        vector<string> found;
+        filesystem::recursive_directory_iterator it(path, ec), end;
+        for(; !ec && it != end; it.increment(ec))
+        {
+            if(it->is_regular_file(ec) && it->path().extension() == ".pas")
+                found.push_back(it->path().string());
+        }
+        if(ec)
+        {
+            cout << "Cannot read directory: " << path << endl;
+            return false;
+        }
+        sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    }
+    return true;
+}
+
+// 批量模式：在线程池中并发分析全部文件，每个工作线程复用自己的CompileWorker
+// 较大的文件先开始，窃取发生在最后，此时剩下的都是小文件，各线程几乎同时结束
+int CompileBatch(const vector<string> &files, size_t threadCount, const CompileOptions &options)
+{
+    vector<size_t> order(files.size());
+    vector<uintmax_t> sizes(files.size());
+    for(size_t i = 0; i < files.size(); ++i)
+    {
+        error_code ec;
+        order[i] = i;
+        sizes[i] = filesystem::file_size(files[i], ec);
+        if(ec)
+            sizes[i] = 0;
+    }
+
+    // 每个队列的尾部最先被取走，因此按从小到大的顺序提交
+    stable_sort(order.begin(), order.end(),
+                [&](size_t a, size_t b) { return sizes[a] < sizes[b]; });
+
+    vector<CompileResult> results(files.size());
+    const auto begin = chrono::steady_clock::now();
+    size_t workerCount;
+    {
+        ThreadPool pool(threadCount);
+        workerCount = pool.Size();
+        vector<CompileWorker> workers(workerCount);
+        for(const size_t i : order)
+        {
+            pool.Submit([&, i]
+            {
+                CompileFile(workers[pool.CurrentWorker()], files[i], options, results[i]);
+            });
+        }
+        pool.Wait();
+    }
+    const double seconds = chrono::duration<double>(
+        chrono::steady_clock::now() - begin).count();
+
+    size_t succeeded = 0, lexFailed = 0, syntaxFailed = 0, unreadable = 0;
+    size_t lexErrs = 0, syntaxErrs = 0, bytes = 0;
+    for(size_t i = 0; i < files.size(); ++i)
+    {
+        const CompileResult &r = results[i];
+        if(r.lexErrs || r.syntaxErrs)
+            cout << files[i] << ":\n";
+        cout << r.log;
+        bytes += r.bytes;
+        lexErrs += r.lexErrs;
+        syntaxErrs += r.syntaxErrs;
+        if(!r.opened)
+            ++unreadable;
+        else if(r.lexErrs)
+            ++lexFailed;
+        else if(r.syntaxErrs)
+            ++syntaxFailed;
+        else if(r.written)
+            ++succeeded;
+    }
+
+    cout << "Files: " << files.size() << ", succeeded: " << succeeded
+         << ", lexical errors: " << lexFailed << " (" << lexErrs << ")"
+         << ", syntax errors: " << syntaxFailed << " (" << syntaxErrs << ")"
+         << ", unreadable: " << unreadable << endl;
+    cout << "Batch: " << bytes << " bytes in " << seconds * 1000 << " ms on "
+         << workerCount << " threads, "
+         << (seconds > 0 ? files.size() / seconds : 0) << " files/s, "
+         << (seconds > 0 ? bytes / seconds / 1e6 : 0) << " MB/s" << endl;
+
+    return succeeded == files.size() ? 0 : -1;
+}
+
+// -j的参数只能是十进制的非负整数，超过线程池的上限时按上限
+bool ParseThreadCount(const char *arg, size_t &threadCount)
+{
+    if(*arg < '0' || *arg > '9')
         return false;
-    output = string(istreambuf_iterator<char>(fin),
-                         istreambuf_iterator<char>());
+    char *end;
+    errno = 0;
+    const unsigned long value = strtoul(arg, &end, 10);
+    if(*end)
+        return false;
+    threadCount = errno == ERANGE || value > ThreadPool::MAX_THREADS ?
+                  ThreadPool::MAX_THREADS : static_cast<size_t>(value);
     return true;
 }
 
-string ReplaceFileType(const string &name, const string &type)
+// 解析-fuel的参数：只能由数字组成，超出uint64_t的范围时失败
+bool ParseFuel(const char *arg, uint64_t &fuel)
 {
-    return name.substr(0, name.rfind(".")) + "." + type;
+    if(*arg < '0' || *arg > '9')
+        return false;
+    char *end;
+    errno = 0;
+    const unsigned long long value = strtoull(arg, &end, 10);
+    if(*end || errno == ERANGE)
+        return false;
+    fuel = value;
+    return true;
 }
 
 int main(int argc, char *argv[])
 {
     // 源代码读入
     
-    if(argc < 2)
+    // 命令行：parser [-j 线程数] [-ast] [-ll] [-dyb] [-run] [-asm] [-ir] [-fuel 步数] filename...
+    // 线程数不为1时并行进行词法分析和主程序中各过程定义的语法分析，为0时使用全部硬件线程，最多为ThreadPool::MAX_THREADS
+    // 给出多个文件或者目录（递归查找其中的.pas文件）时进入批量模式：每个文件的输出与单独分析时相同，
+    // 文件之间在-j个线程上并发分析（默认为全部硬件线程），最后输出汇总；批量模式只支持-ll和-dyb
+    // -ast同时构造语法树，并报告其内存占用
+    // -ll改用表驱动的LL(1)分析，不受嵌套深度的限制，此时忽略-ast
+    // -dyb在分析成功后另外写出二进制的.dyb文件（见DybFile.h）
+    // 给出的文件是.dyb时，不做分析，而是由它重新生成.dyd、.dys、.varfil和.profil
+    // 给出的文件是.dyd（例如Tokenizer_NFrac的输出）时，直接把其中的记录解码为词法单元序列，
+    // 跳过词法分析，其余与分析源文件时相同；.dyd本身不会被改写
+    // -run在分析成功后编译成字节码并执行，从标准输入读入，向标准输出写出，
+    // 最后报告执行的指令数和速度；需要语法树，因此忽略-ll
+    // -asm在分析成功后生成x86-64汇编.s文件，用as和ld即可得到独立的可执行文件；同样忽略-ll
+    // -ir在分析成功后翻译成SSA形式的中间表示，优化后写入.ir文件，并报告每一遍的耗时和效果；同样忽略-ll
+    // -fuel为-ir中部分求值每处调用最多执行的指令数，为0时不做部分求值
+    // --server 套接字：作为常驻的编译服务运行（见Server.h），在-j个线程上服务（默认为全部硬件线程），
+    // 每个请求的分析与批量模式相同，只支持-ll和-dyb
+    // parser --client 套接字 filename...：把文件交给服务分析，输出和退出码与直接分析相同；
+    // "-"表示分析标准输入，只输出错误信息或者符号表，"-stop"表示停止服务
+
+    if(argc >= 3 && string(argv[1]) == "--client")
+        return RunClient(argv[2], vector<string>(argv + 3, argv + argc));
+
+    size_t threadCount = 1;
+    string socketPath;
+    bool buildAst = false;
+    bool tableDriven = false;
+    bool run = false;
+    bool emitAsm = false;
+    bool emitIr = false;
+    bool emitDyb = false;
+    uint64_t fuel = PartialEvaluator::DEFAULT_FUEL;
+    bool threadsGiven = false;
+    vector<string> paths;
+    for(int i = 1; i < argc; ++i)
     {
-        cout << "Usage: tokenizer filename" << endl;
-        return -1;
+        const string arg = argv[i];
+        if(arg == "-j" && i + 1 < argc)
+        {
+            if(!ParseThreadCount(argv[++i], threadCount))
+            {
+                cout << "Invalid thread count: " << argv[i] << endl;
+                return -1;
+            }
+            threadsGiven = true;
+        }
+        else if(arg == "-ast")
+            buildAst = true;
+        else if(arg == "-ll")
+            tableDriven = true;
+        else if(arg == "-run")
+            run = true;
+        else if(arg == "-asm")
+            emitAsm = true;
+        else if(arg == "-ir")
+            emitIr = true;
+        else if(arg == "-dyb")
+            emitDyb = true;
+        else if(arg == "-fuel")
+        {
+            const char *value = i + 1 < argc ? argv[++i] : "";
+            if(!ParseFuel(value, fuel))
+            {
+                cout << "Invalid fuel: " << value << endl;
+                return -1;
+            }
+        }
+        else if(arg == "--server" && i + 1 < argc)
+            socketPath = argv[++i];
+        else
+            paths.push_back(arg);
     }
 
-    const std::string filename = argv[1];
+    CompileOptions options;
+    options.tableDriven = tableDriven;
+    options.emitDyb = emitDyb;
+    if(!socketPath.empty() && paths.empty())
+        return RunServer(socketPath, threadsGiven ? threadCount : 0, options);
 
-    string src;
-    if(!ReadFile(filename, src))
+    if(paths.empty() || !socketPath.empty())
     {
-        cout << "Cannot open file: "
-             << filename << endl;
+        cout << "Usage: parser [-j threads] [-ast] [-ll] [-dyb] [-run] [-asm] [-ir] [-fuel steps] filename...\n"
+                "       parser [-j threads] [-ll] [-dyb] --server socket\n"
+                "       parser --client socket filename|-|-stop..." << endl;
         return -1;
     }
 
-    // 词法分析及其错误输出
-
-    vector<TokenizerException> errs;
-    Tokenizer::TokenStream toks = Tokenizer(src, filename).Tokenize(errs);
-
-    if(errs.size())
+    error_code ec;
+    if(paths.size() > 1 || filesystem::is_directory(paths[0], ec))
     {
-        ofstream fout(ReplaceFileType(filename, "err"), ofstream::out);
-        for(auto &e : errs)
+        if(buildAst || run || emitAsm || emitIr)
         {
-            fout << "***LINE: " << e.line
-                 << "  " << e.msg << endl;
-            cout << "***LINE: " << e.line
-                 << "  " << e.msg << endl;
+            cout << "-ast, -run, -asm and -ir take a single file" << endl;
+            return -1;
         }
-        return -1;
+        vector<string> files;
+        if(!CollectFiles(paths, files))
+            return -1;
+        return CompileBatch(files, threadsGiven ? threadCount : 0, options);
     }
+    const string &filename = paths[0];
 
-    // 词法分析结果输出
+    if(filesystem::path(filename).extension() == ".dyb")
+        return ConvertDyb(filename);
 
-    ofstream fout(ReplaceFileType(filename, "dyd"), ofstream::out);
-    if(!fout)
+    if(run || emitAsm || emitIr)
     {
-        cout << "Failed to open dyd file" << endl;
+        buildAst = true;
+        tableDriven = false;
+    }
+
+    SourceFile src;
+    if(!src.Open(filename))
+    {
+        cout << (src.TooLarge() ? "File too large (over 4GB): " : "Cannot open file: ")
+             << filename << endl;
         return -1;
     }
-    for(auto &t : toks)
+
+    const string dydFilename = ReplaceFileType(filename, "dyd");
+    const bool fromDyd = dydFilename == filename;
+    OutputFile fout;
+    if(!fromDyd && !fout.Open(dydFilename))
     {
-        fout << setw(16) << setfill(' ')
-             << t.tokenStr
-             << " "
-             << setw(2) << setfill('0')
-             << static_cast<int>(t.type)
-             << endl;
+        cout << "Failed to open dyd file" << endl;
+        return -1;
     }
 
-    fout.close();
+    vector<TokenizerError> errs;
+    Tokenizer tokenizer(src.Data(), src.Size(), filename);
+    Tokenizer::TokenStream toks;
+    unique_ptr<Parser> parser;
+    unique_ptr<ThreadPool> pool;
+    DybWriter dyb;
 
-    // 语法分析及其错误输出
+    if(fromDyd)
+    {
+        // 词法分析的结果已经在dyd中，解码后即可进行语法分析
 
-    Parser parser(toks, filename);
-    
-    parser.Parse();
-    if(parser.GetErrs().size())
+        if(threadCount != 1)
+            pool.reset(new ThreadPool(threadCount));
+        if(ReadDydTokens(src.Data(), src.Size(), toks, errs) && emitDyb)
+            dyb.AddTokens(toks);
+        parser.reset(new Parser(toks, filename));
+    }
+    else if(threadCount != 1)
     {
-        ofstream fout(ReplaceFileType(filename, "err"), ofstream::out);
-        for(auto &e : parser.GetErrs())
+        // 并行词法分析，得到完整的词法单元序列后再进行语法分析
+
+        pool.reset(new ThreadPool(threadCount));
+        toks = tokenizer.TokenizeParallel(*pool, errs);
+        if(errs.empty())
         {
-            fout << "***LINE: " << e.line
-                << "  " << e.msg << endl;
-            cout << "***LINE: " << e.line
-                << "  " << e.msg << endl;
+            WriteDydTokens(fout, toks);
+            if(emitDyb)
+                dyb.AddTokens(toks);
         }
+        parser.reset(new Parser(toks, filename));
+    }
+    else
+    {
+        // 词法分析与语法分析交替进行，词法分析结果随语法分析的进行逐窗口输出
+
+        parser.reset(new Parser(tokenizer, errs,
+            [&](const Tokenizer::TokenStream &window)
+            {
+                WriteDydTokens(fout, window);
+                if(emitDyb)
+                    dyb.AddTokens(window);
+            }, filename));
+    }
+
+    if(tableDriven)
+    {
+        buildAst = false;
+        parser->ParseLL();
+    }
+    else if(pool && !buildAst)
+        parser->ParseParallel(*pool);
+    else
+        parser->Parse(buildAst);
+    const bool written = fout.Close();
+
+    // 词法错误输出，此时语法分析的结果没有意义
+
+    if(errs.size())
+    {
+        if(!fromDyd)
+            remove(dydFilename.c_str());
+
+        string text;
+        fout.OpenString(text);
+        WriteLexErrs(fout, errs, src.Data());
+        fout.Close();
+        cout << text;
+        if(!WriteTextFile(fout, ReplaceFileType(filename, "err"), text))
+            cout << "Failed to write err file" << endl;
         return -1;
     }
 
-    // 语法分析结果输出
+    // 语法分析错误输出
 
-    fout.open(ReplaceFileType(filename, "dys"), ofstream::out);
-    if(!fout)
+    if(parser->GetErrs().size())
     {
-        cout << "Failed to open dys file" << endl;
+        string text;
+        fout.OpenString(text);
+        WriteParserErrs(fout, parser->GetErrs());
+        fout.Close();
+        cout << text;
+        if(!WriteTextFile(fout, ReplaceFileType(filename, "err"), text))
+            cout << "Failed to write err file" << endl;
         return -1;
     }
-    for(auto &t : toks)
+
+    // 语法分析结果输出，dys与dyd内容相同，直接复制
+
+    if(!written)
     {
-        fout << setw(16) << setfill(' ')
-             << t.tokenStr
-             << " "
-             << setw(2) << setfill('0')
-             << static_cast<int>(t.type)
-             << endl;
+        cout << "Failed to write dyd file" << endl;
+        return -1;
     }
-    fout.close();
 
-    fout.open(ReplaceFileType(filename, "varfil"), ofstream::out);
-    if(!fout)
+    if(!CopyDyd(dydFilename, ReplaceFileType(filename, "dys")))
     {
-        cout << "Failed to open varfil file" << endl;
+        cout << "Failed to write dys file" << endl;
         return -1;
     }
 
-    for(const Var &v : parser.GetVars())
+    if(!fout.Open(ReplaceFileType(filename, "varfil")))
     {
-        fout << "Var"                              << endl
-             << "    Name      = " << v.name       << endl
-             << "    Procedure = " << v.proc       << endl
-             << "    Kind      = " <<
-                (v.kind == VarKind::Variable ?
-                    "Variable" : "Parameter")      << endl
-             << "    Type      = " << "Integer"    << endl
-             << "    Level     = " << v.level      << endl
-             << "    Offset    = " << v.posInTable << endl;
+        cout << "Failed to open varfil file" << endl;
+        return -1;
     }
 
-    fout.close();
+    WriteVarfil(fout, parser->GetVars());
+    bool tablesWritten = fout.Close();
 
-    fout.open(ReplaceFileType(filename, "profil"), ofstream::out);
-    if(!fout)
+    if(!fout.Open(ReplaceFileType(filename, "profil")))
     {
         cout << "Failed to open profil file" << endl;
         return -1;
     }
 
-    for(const Proc &p : parser.GetProcs())
+    WriteProfil(fout, parser->GetProcs());
+    tablesWritten = fout.Close() && tablesWritten;
+
+    if(!tablesWritten)
+    {
+        cout << "Failed to write output files" << endl;
+        return -1;
+    }
+
+    if(emitDyb && !dyb.Write(fout, ReplaceFileType(filename, "dyb"),
+                             parser->GetVars(), parser->GetProcs()))
     {
-        fout << "Proc"                                << endl
-             << "    Name      = " << p.name          << endl
-             << "    Type      = " << "Integer"       << endl
-             << "    Level     = " << p.level         << endl
-             << "    FirstVar  = " << p.varPosBegin   << endl
-             << "    LastVar   = " << p.varPosEnd - 1 << endl;
+        cout << "Failed to write dyb file" << endl;
+        return -1;
     }
 
-    fout.close();
+    if(buildAst)
+    {
+        const Ast &ast = parser->GetAst();
+        cout << "AST: " << ast.Size() << " nodes, "
+             << sizeof(AstNode) << " bytes per node, "
+             << ast.MemoryUsage() << " bytes allocated" << endl;
+    }
 
     cout << "Parsing succeeded" << endl;
 
+    if(emitAsm)
+    {
+        ofstream out(ReplaceFileType(filename, "s"), ofstream::out);
+        if(!out)
+        {
+            cout << "Failed to open s file" << endl;
+            return -1;
+        }
+        AsmCompiler(parser->GetAst(), parser->GetVars(), parser->GetProcs()).Compile(out);
+        out.close();
+        if(!out)
+        {
+            cout << "Failed to write s file" << endl;
+            return -1;
+        }
+    }
+
+    if(emitIr)
+    {
+        const auto begin = chrono::steady_clock::now();
+        IrProgram ir = IrBuilder(parser->GetAst(), parser->GetVars(), parser->GetProcs()).Build();
+        const double seconds = chrono::duration<double>(
+            chrono::steady_clock::now() - begin).count();
+        cout << "IR: " << ir.InstCount() << " instructions built in "
+             << seconds * 1000 << " ms" << endl;
+
+        PartialEvaluator evaluator(parser->GetVars(), parser->GetProcs(), fuel);
+        for(const IrPassStats &pass : OptimizeIr(ir, fuel ? &evaluator : nullptr))
+        {
+            cout << "IR: " << pass.name << ": " << pass.before << " -> " << pass.after
+                 << " instructions (-" << pass.before - pass.after << ") in "
+                 << pass.seconds * 1000 << " ms" << endl;
+        }
+
+        ofstream out(ReplaceFileType(filename, "ir"), ofstream::out);
+        if(!out)
+        {
+            cout << "Failed to open ir file" << endl;
+            return -1;
+        }
+        if(fuel)
+        {
+            cout << "IR: " << evaluator.GetFolded().size() << " calls folded" << endl;
+            PrintFoldedCalls(out, evaluator.GetFolded(), parser->GetProcs());
+        }
+        PrintIr(out, ir, parser->GetVars(), parser->GetProcs());
+        out.close();
+        if(!out)
+        {
+            cout << "Failed to write ir file" << endl;
+            return -1;
+        }
+    }
+
+    if(run)
+    {
+        const Bytecode code = BytecodeCompiler(parser->GetAst(),
+                                               parser->GetVars(),
+                                               parser->GetProcs()).Compile();
+        Vm vm;
+
+        const auto begin = chrono::steady_clock::now();
+        const bool ok = vm.Run(code, cin, cout);
+        const double seconds = chrono::duration<double>(
+            chrono::steady_clock::now() - begin).count();
+        cout.flush();
+
+        if(!ok)
+        {
+            cout << "***RUNTIME: " << vm.GetError() << endl;
+            return -1;
+        }
+
+        const uint64_t count = vm.GetInstructionCount();
+        cout << "VM: " << count << " instructions in "
+             << seconds * 1000 << " ms, "
+             << (seconds > 0 ? count / seconds / 1e6 : 0) << " M instructions/s" << endl;
+    }
+
     return 0;
 }
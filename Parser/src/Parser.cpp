@@ -1,31 +1,96 @@
-#include <algorithm>
-
 #include "Parser.h"
 
-Parser::Parser(const Tokenizer::TokenStream &toks,
-               const std::string &filename)
-    : filename_(filename), level_(0)
+namespace
 {
-    for(auto &t : toks)
+    // 词法单元类型的集合，以位掩码表示
+    constexpr uint32_t TokenBit(TokenType type)
     {
-        if(t.type != TokenType::NewLine)
-            toks_.push_back(t);
+        return 1u << static_cast<int>(type);
     }
-    cur_ = toks_.begin();
+
+    static_assert(static_cast<int>(TokenType::EndMark) < 32, "token set must fit in 32 bits");
+
+    // 定义和语句出错后，都跳到下一个分号、end或者程序末尾处继续分析
+    constexpr uint32_t SYNC_DEFS  = TokenBit(TokenType::Semicolon) |
+                                    TokenBit(TokenType::End) |
+                                    TokenBit(TokenType::EndMark);
+    constexpr uint32_t SYNC_EXECS = SYNC_DEFS;
+
+    constexpr uint32_t COMPARE_OPS = TokenBit(TokenType::Less) |
+                                     TokenBit(TokenType::LessEqual) |
+                                     TokenBit(TokenType::Equal) |
+                                     TokenBit(TokenType::GreaterEqual) |
+                                     TokenBit(TokenType::Greater) |
+                                     TokenBit(TokenType::NotEqual);
 }
 
-void Parser::Parse(void)
+Parser::Parser(const Tokenizer::TokenStream &toks,
+               const std::string &filename)
+    : toks_(&toks), cur_(0),
+      tokenizer_(nullptr), lexErrs_(nullptr),
+      filename_(filename), level_(0), outer_(nullptr),
+      containingNode_(NO_NODE), buildAst_(false)
 {
-    try
+
+}
+
+Parser::Parser(Tokenizer &tokenizer,
+               std::vector<TokenizerError> &lexErrs,
+               TokenSink sink,
+               const std::string &filename)
+    : toks_(&window_), cur_(0),
+      tokenizer_(&tokenizer), lexErrs_(&lexErrs), sink_(std::move(sink)),
+      window_(tokenizer.Source()),
+      filename_(filename), level_(0), outer_(nullptr),
+      containingNode_(NO_NODE), buildAst_(false)
+{
+    window_.Reserve(WINDOW_SIZE + 1);
+    tokenizer_->Fill(window_, WINDOW_SIZE, *lexErrs_);
+}
+
+void Parser::Reset(Tokenizer &tokenizer,
+                   std::vector<TokenizerError> &lexErrs,
+                   TokenSink sink,
+                   const std::string &filename)
+{
+    toks_ = &window_;
+    cur_ = 0;
+    tokenizer_ = &tokenizer;
+    lexErrs_ = &lexErrs;
+    sink_ = std::move(sink);
+    window_.Reset(tokenizer.Source());
+
+    vars_.clear();
+    procs_.clear();
+    spans_.clear();
+    varSyms_.Clear();
+    procSyms_.Clear();
+
+    filename_ = filename;
+    level_ = 0;
+    containingProc_ = Name();
+    containingNode_ = NO_NODE;
+    buildAst_ = false;
+    ast_.Clear();
+    procNodes_.clear();
+    errs_.clear();
+
+    tokenizer_->Fill(window_, WINDOW_SIZE, *lexErrs_);
+}
+
+void Parser::Parse(bool buildAst)
+{
+    buildAst_ = buildAst;
+
+    NodeIndex root = NO_NODE;
+    if(ParseProgram(root))
     {
-        ParseProgram();
+        ast_.SetRoot(root);
         if(!Match(TokenType::EndMark))
             Error("program end expected");
     }
-    catch(const ParserException &err)
-    {
-        errs_.push_back(err);
-    }
+
+    Finish();
 }
 
 const VarTable &Parser::GetVars(void) const
@@ -43,149 +108,300 @@ const Parser::Errs &Parser::GetErrs(void) const
     return errs_;
 }
 
-void Parser::Error(const std::string &msg) const
+const Ast &Parser::GetAst(void) const
 {
-    throw ParserException(filename_, Current().line, msg);
+    return ast_;
 }
 
-void Parser::ErrorRecWithDef(void)
+const std::vector<Parser::ProcSpan> &Parser::GetProcSpans(void) const
 {
-    while(Current().type != TokenType::Semicolon)
+    return spans_;
+}
+
+bool Parser::ParseDetachedBody(const Name &paramName, const Name &procName, int level,
+                               const OuterScope &outer, ProcSpan &span)
+{
+    // 定义部分中containingProc_总为空，只在执行语句部分中为所在的过程
+    outer_ = &outer;
+    level_ = level;
+    containingProc_ = Name();
+
+    span.procPosBegin = 0;
+    span.errPosBegin = 0;
+    const bool ok = ParseProcBody(paramName, procName, span, NO_NODE);
+    span.errPosEnd = errs_.size();
+
+    outer_ = nullptr;
+    return ok && Current() == TokenType::EndMark;
+}
+
+void Parser::EnterScope(void)
+{
+    ++level_;
+    varSyms_.EnterScope();
+    procSyms_.EnterScope();
+}
+
+void Parser::LeaveScope(void)
+{
+    --level_;
+    varSyms_.LeaveScope();
+    procSyms_.LeaveScope();
+}
+
+void Parser::RestoreScopes(size_t varCount, size_t procCount, int level)
+{
+    varSyms_.Clear();
+    procSyms_.Clear();
+    level_ = 0;
+
+    // 定义按出现的顺序重放，每个定义的层次即为其所在作用域的深度
+    // 过程在其函数体分析完之后才加入ProcTable，即位于其最后一个变量之后
+    auto moveTo = [this](int level)
+    {
+        while(level_ < level)
+            EnterScope();
+        while(level_ > level)
+            LeaveScope();
+    };
+
+    size_t p = 0;
+    for(size_t v = 0; ; ++v)
     {
-        if(Current().type == TokenType::EndMark ||
-           Current().type == TokenType::End)
+        for(; p < procCount && procs_[p].varPosEnd <= v; ++p)
+        {
+            moveTo(procs_[p].level);
+            procSyms_.Define(procs_[p].name, p);
+        }
+        if(v == varCount)
             break;
-        Next();
+        moveTo(vars_[v].level);
+        varSyms_.Define(vars_[v].name, v);
     }
+    moveTo(level);
+}
+
+NodeIndex Parser::NewNode(AstKind kind)
+{
+    if(!buildAst_)
+        return NO_NODE;
+    return ast_.Add(kind, CurrentLine());
+}
+
+void Parser::AppendNode(NodeIndex &first, NodeIndex &last, NodeIndex node)
+{
+    if(node == NO_NODE)
+        return;
+    if(last == NO_NODE)
+        first = node;
+    else
+        ast_[last].next = node;
+    last = node;
+}
+
+bool Parser::Error(const std::string &msg)
+{
+    errs_.push_back(ParserError(filename_, CurrentLine(), toks_->Offset(cur_), msg));
+    return false;
+}
+
+void Parser::Synchronize(uint32_t syncSet)
+{
+    while(!(TokenBit(Current()) & syncSet))
+        Next();
 }
 
 bool Parser::Match(TokenType type)
 {
-    if(cur_->type == type)
+    if(Current() == type)
     {
-        if(cur_ != toks_.end())
-            ++cur_;
+        Next();
         return true;
     }
     return false;
 }
 
-const Token &Parser::Current(void) const
+TokenType Parser::Current(void) const
+{
+    return toks_->Type(cur_);
+}
+
+Name Parser::CurrentName(void) const
 {
-    return *cur_;
+    return toks_->NameAt(cur_);
+}
+
+int Parser::CurrentLine(void) const
+{
+    return toks_->Line(cur_);
 }
 
 void Parser::Next(void)
 {
-    ++cur_;
+    // 停留在结束标志上，不越过序列末尾
+    if(cur_ + 1 < toks_->Size())
+        ++cur_;
+    else if(tokenizer_ && Current() != TokenType::EndMark)
+        Refill();
 }
 
-void Parser::CheckVarDef(const std::string &v) const
+void Parser::Refill(void)
 {
-    auto it = std::find_if(vars_.begin(), vars_.end(),
-    [&](const Var &var)->bool
+    if(sink_)
+        sink_(window_);
+    window_.Recycle();
+    tokenizer_->Fill(window_, WINDOW_SIZE, *lexErrs_);
+    cur_ = 0;
+}
+
+void Parser::Finish(void)
+{
+    if(!tokenizer_)
+        return;
+    cur_ = toks_->Size() - 1;
+    while(Current() != TokenType::EndMark)
     {
-        return var.name == v && var.level <= level_;
-    });
-    if(it == vars_.end())
-        Error("undefined variable: " + v);
+        Refill();
+        cur_ = toks_->Size() - 1;
+    }
+    if(sink_)
+        sink_(window_);
 }
 
-void Parser::CheckProcDef(const std::string &p) const
+bool Parser::CheckVarDef(const Name &name, int &var)
+{
+    const size_t i = varSyms_.Find(name);
+    if(i == SymbolTable::NONE)
+    {
+        // 外层作用域中的变量不在VarTable中，只用于检查，不构造语法树
+        if(outer_ && outer_->hasVar(name))
+        {
+            var = -1;
+            return true;
+        }
+        return Error("undefined variable: " + std::string(name.View()));
+    }
+    var = static_cast<int>(i);
+    return true;
+}
+
+bool Parser::CheckProcDef(const Name &name, NodeIndex &proc)
 {
     // 当前正在分析的过程还未被加入过程名表中
     // 所以这里单独比较一下，以允许递归调用
-    if(p == containingProc_)
-        return;
+    if(name == containingProc_)
+    {
+        proc = containingNode_;
+        return true;
+    }
 
-    auto it = std::find_if(procs_.begin(), procs_.end(),
-    [&](const Proc &proc)->bool
+    const size_t i = procSyms_.Find(name);
+    if(i == SymbolTable::NONE)
     {
-        return proc.name == p && proc.level <= level_;
-    });
-    if(it == procs_.end())
-        Error("undefined procedure: " + p);
+        if(outer_ && outer_->hasProc(name))
+        {
+            proc = NO_NODE;
+            return true;
+        }
+        return Error("undefined procedure: " + std::string(name.View()));
+    }
+    proc = buildAst_ ? procNodes_[i] : NO_NODE;
+    return true;
 }
 
-void Parser::ParseProgram(void)
+bool Parser::ParseProgram(NodeIndex &node)
 {
-    return ParseSubprogram();
+    return ParseSubprogram(node);
 }
 
-void Parser::ParseSubprogram()
+bool Parser::ParseSubprogram(NodeIndex &node)
 {
+    node = NewNode(AstKind::Program);
+
     if(!Match(TokenType::Begin))
-        Error("'begin' expected");
+        return Error("'begin' expected");
 
-    ++level_;
+    EnterScope();
 
-    ParseDefs();
-    ParseExecs();
+    const NodeIndex procs = ParseDefs();
+    const NodeIndex execs = ParseExecs();
+    if(node != NO_NODE)
+    {
+        ast_[node].child[0] = procs;
+        ast_[node].child[1] = execs;
+    }
 
     if(!Match(TokenType::End))
-        Error("'end' expected");
+        return Error("'end' expected");
 
-    --level_;
+    LeaveScope();
+
+    return true;
 }
 
-void Parser::ParseDefs(const std::string &paramName,
-                       const std::string &procName)
+NodeIndex Parser::ParseDefs(const Name &paramName,
+                            const Name &procName)
 {
+    NodeIndex first = NO_NODE, last = NO_NODE;
     do {
-        try{
-            if(!Match(TokenType::Integer))
-                Error("'integer' expected");
-            
-            if(Match(TokenType::Function))
-                ParseProcDef();
-            else
-                ParseVarDef(paramName, procName);
-            
-            if(!Match(TokenType::Semicolon) && !Match(TokenType::End))
-                Error("';' expected");
-        }
-        catch(const ParserException &err)
+        NodeIndex proc = NO_NODE;
+        if(ParseDef(paramName, procName, proc))
+            AppendNode(first, last, proc);
+        else
         {
-            errs_.push_back(err);
-            ErrorRecWithDef();
+            Synchronize(SYNC_DEFS);
             Match(TokenType::Semicolon);
         }
 
-    } while(Current().type == TokenType::Integer);
+    } while(Current() == TokenType::Integer);
+
+    return first;
+}
+
+bool Parser::ParseDef(const Name &paramName,
+                      const Name &procName,
+                      NodeIndex &proc)
+{
+    if(!Match(TokenType::Integer))
+        return Error("'integer' expected");
+
+    bool ok;
+    if(Match(TokenType::Function))
+        ok = ParseProcDef(proc);
+    else
+        ok = ParseVarDef(paramName, procName);
+
+    if(ok && !Match(TokenType::Semicolon) && !Match(TokenType::End))
+        ok = Error("';' expected");
+    return ok;
 }
 
-void Parser::ParseExecs()
+NodeIndex Parser::ParseExecs()
 {
+    NodeIndex first = NO_NODE, last = NO_NODE;
     do {
-        try
-        {
-            ParseExec();
-        }
-        catch(const ParserException &err)
-        {
-            errs_.push_back(err);
-            ErrorRecWithDef();
-        }
+        NodeIndex exec = NO_NODE;
+        if(ParseExec(exec))
+            AppendNode(first, last, exec);
+        else
+            Synchronize(SYNC_EXECS);
     } while(Match(TokenType::Semicolon));
+
+    return first;
 }
 
-void Parser::ParseVarDef(const std::string &paramName,
-                         const std::string &procName)
+bool Parser::ParseVarDef(const Name &paramName,
+                         const Name &procName)
 {
-    if(Current().type != TokenType::Identifier)
-        Error("variable name expected");
-    const std::string &newVarName = Current().tokenStr;
+    if(Current() != TokenType::Identifier)
+        return Error("variable name expected");
+    const Name newVarName = CurrentName();
 
     Next();
 
     // 不能在同一作用域内重复定义变量，也不允许定义和当前过程名相同的变量
-    auto it = std::find_if(vars_.begin(), vars_.end(),
-    [&](const Var &var)->bool
-    {
-        return var.name == newVarName && var.level == this->level_;
-    });
-    if(it != vars_.end() || newVarName == containingProc_)
-        Error("Variale redefined: " + newVarName);
+    if(varSyms_.DefinedInScope(newVarName) || newVarName == containingProc_)
+        return Error("Variale redefined: " + std::string(newVarName.View()));
     
     Var newVar =
     {
@@ -196,26 +412,24 @@ void Parser::ParseVarDef(const std::string &paramName,
         level_,
         vars_.size()
     };
+    varSyms_.Define(newVarName, vars_.size());
     vars_.push_back(newVar);
+    return true;
 }
 
-void Parser::ParseProcDef(void)
+bool Parser::ParseProcDef(NodeIndex &node)
 {
     // 取得函数名
-    if(Current().type != TokenType::Identifier)
-        Error("function name expected");
-    const std::string newProcName = Current().tokenStr;
+    if(Current() != TokenType::Identifier)
+        return Error("function name expected");
+    const Name newProcName = CurrentName();
+    node = NewNode(AstKind::ProcDef);
 
     Next();
 
     // 检查是否重定义
-    auto it = std::find_if(procs_.begin(), procs_.end(),
-    [&](const Proc &proc)->bool
-    {
-        return proc.name == newProcName && proc.level == level_;
-    });
-    if(it != procs_.end())
-        Error("Procedure redefined: " + newProcName);
+    if(procSyms_.DefinedInScope(newProcName))
+        return Error("Procedure redefined: " + std::string(newProcName.View()));
     
     // 保存变量开始位置
     size_t procVarBegin = vars_.size();
@@ -223,38 +437,27 @@ void Parser::ParseProcDef(void)
     // 识别参数列表
     // 等等，纳尼，只支持一个参数？
     if(!Match(TokenType::LeftBrac))
-        Error("'(' expected");
-    if(Current().type != TokenType::Identifier)
-        Error("parameter expected");
-    std::string paramName = Current().tokenStr;
+        return Error("'(' expected");
+    if(Current() != TokenType::Identifier)
+        return Error("parameter expected");
+    const Name paramName = CurrentName();
+    const size_t paramTok = cur_;
     Next();
     if(!Match(TokenType::RightBrac))
-        Error("')' expected");
+        return Error("')' expected");
     
     if(!Match(TokenType::Semicolon))
-        Error("';' expected");
+        return Error("';' expected");
 
-    ++level_;
-    
-    if(!Match(TokenType::Begin))
-        Error("'begin' expected");
-    
-    ParseDefs(paramName, newProcName);
+    ProcSpan span;
+    span.paramTok = paramTok;
+    span.procPosBegin = procs_.size();
+    span.errPosBegin = errs_.size();
 
-    // 检查参数类型定义了没
-    CheckVarDef(paramName);
+    if(!ParseProcBody(paramName, newProcName, span, node))
+        return false;
 
-    std::string oldCon = containingProc_;
-    containingProc_ = newProcName;
-
-    ParseExecs();
-
-    containingProc_ = oldCon;
-
-    --level_;
-
-    if(!Match(TokenType::End))
-        Error("'end' expected");
+    span.errPosEnd = errs_.size();
 
     size_t procVarEnd = vars_.size();
 
@@ -266,95 +469,257 @@ void Parser::ParseProcDef(void)
         procVarBegin,
         procVarEnd
     };
+    if(buildAst_)
+    {
+        ast_[node].value = static_cast<int>(procs_.size());
+        procNodes_.push_back(node);
+    }
+    procSyms_.Define(newProcName, procs_.size());
     procs_.push_back(newProc);
+    spans_.push_back(span);
+
+    return true;
+}
+
+bool Parser::ParseProcBody(const Name &paramName,
+                           const Name &procName,
+                           ProcSpan &span, NodeIndex node)
+{
+    // 出错返回时不离开作用域，层次也不恢复，与原先异常越过此处时的行为一致
+    EnterScope();
+    const int bodyLevel = level_;
+
+    span.bodyBegin = cur_;
+    if(!Match(TokenType::Begin))
+        return Error("'begin' expected");
+    
+    const NodeIndex procs = ParseDefs(paramName, procName);
+
+    // 检查参数类型定义了没
+    int param;
+    if(!CheckVarDef(paramName, param))
+        return false;
+
+    const Name oldCon = containingProc_;
+    const NodeIndex oldNode = containingNode_;
+    containingProc_ = procName;
+    containingNode_ = node;
+
+    const NodeIndex execs = ParseExecs();
+
+    containingProc_ = oldCon;
+    containingNode_ = oldNode;
+
+    if(node != NO_NODE)
+    {
+        ast_[node].child[0] = procs;
+        ast_[node].child[1] = execs;
+    }
+
+    span.clean = level_ == bodyLevel;
+    LeaveScope();
+
+    span.bodyEnd = cur_;
+    if(!Match(TokenType::End))
+        return Error("'end' expected");
+    return true;
 }
 
-void Parser::ParseExec(void)
+bool Parser::ParseExec(NodeIndex &node)
 {
-    if(Match(TokenType::Read) || Match(TokenType::Write))
+    const TokenType type = Current();
+    if(type == TokenType::Read || type == TokenType::Write)
     {
+        node = NewNode(type == TokenType::Read ? AstKind::Read : AstKind::Write);
+        Next();
+
         if(!Match(TokenType::LeftBrac))
-            Error("'(' expected");
+            return Error("'(' expected");
 
-        if(Current().type != TokenType::Identifier)
-            Error("'variable expected'");
-        CheckVarDef(Current().tokenStr);
+        if(Current() != TokenType::Identifier)
+            return Error("'variable expected'");
+        int var;
+        if(!CheckVarDef(CurrentName(), var))
+            return false;
+        if(node != NO_NODE)
+            ast_[node].value = var;
 
         Next();
 
         if(!Match(TokenType::RightBrac))
-            Error("')' expected");
+            return Error("')' expected");
+
+        return true;
     }
-    else if(Match(TokenType::If))
+    else if(type == TokenType::If)
     {
-        ParseArithExpr();
-        if(!Match(TokenType::Less) &&
-           !Match(TokenType::LessEqual) &&
-           !Match(TokenType::Equal) &&
-           !Match(TokenType::GreaterEqual) &&
-           !Match(TokenType::Greater) &&
-           !Match(TokenType::NotEqual))
-           Error("Comparation operator expected");
-        ParseArithExpr();
+        node = NewNode(AstKind::If);
+        Next();
+
+        const NodeIndex cond = NewNode(AstKind::Compare);
+        NodeIndex lhs, rhs, thenExec, elseExec;
+        if(!ParseArithExpr(lhs))
+            return false;
+        const TokenType op = Current();
+        if(!(TokenBit(op) & COMPARE_OPS))
+            return Error("Comparation operator expected");
+        Next();
+        if(!ParseArithExpr(rhs))
+            return false;
 
         if(!Match(TokenType::Then))
-            Error("'then' expected");
+            return Error("'then' expected");
         
-        ParseExec();
+        if(!ParseExec(thenExec))
+            return false;
 
         if(!Match(TokenType::Else))
-            Error("'else' expected");
+            return Error("'else' expected");
         
-        ParseExec();
+        if(!ParseExec(elseExec))
+            return false;
+
+        if(node != NO_NODE)
+        {
+            AstNode &c = ast_[cond];
+            c.op = static_cast<uint8_t>(op);
+            c.child[0] = lhs;
+            c.child[1] = rhs;
+
+            AstNode &n = ast_[node];
+            n.child[0] = cond;
+            n.child[1] = thenExec;
+            n.child[2] = elseExec;
+        }
+        return true;
     }
-    else if(Current().type == TokenType::Identifier)
+    else if(type == TokenType::Identifier)
     {
-        if(Current().tokenStr != containingProc_)
-            CheckVarDef(Current().tokenStr);
+        node = NewNode(AstKind::Assign);
+
+        // 给所在函数的名字赋值即设置函数的返回值
+        const Name name = CurrentName();
+        int target;
+        uint16_t flags = 0;
+        if(name != containingProc_)
+        {
+            if(!CheckVarDef(name, target))
+                return false;
+        }
+        else
+        {
+            target = static_cast<int>(containingNode_);
+            flags = ASSIGN_RESULT;
+        }
         Next();
 
         if(!Match(TokenType::Assign))
-            Error("':=' expected");
+            return Error("':=' expected");
         
-        ParseArithExpr();
+        NodeIndex expr;
+        if(!ParseArithExpr(expr))
+            return false;
+
+        if(node != NO_NODE)
+        {
+            AstNode &n = ast_[node];
+            n.flags = flags;
+            n.child[0] = expr;
+            n.value = target;
+        }
+        return true;
     }
     else
-        Error("unnknown statement type");
+        return Error("unnknown statement type");
 }
 
-void Parser::ParseArithExpr(void)
+bool Parser::ParseArithExpr(NodeIndex &node)
 {
-    ParseItem();
-    while(Match(TokenType::Minus))
-        ParseItem();
+    if(!ParseItem(node))
+        return false;
+    while(Current() == TokenType::Minus)
+    {
+        const NodeIndex lhs = node;
+        node = NewNode(AstKind::Minus);
+        Next();
+        NodeIndex rhs;
+        if(!ParseItem(rhs))
+            return false;
+        if(node != NO_NODE)
+        {
+            ast_[node].child[0] = lhs;
+            ast_[node].child[1] = rhs;
+        }
+    }
+    return true;
 }
 
-void Parser::ParseItem(void)
+bool Parser::ParseItem(NodeIndex &node)
 {
-    ParseFactor();
-    while(Match(TokenType::Times))
-        ParseFactor();
+    if(!ParseFactor(node))
+        return false;
+    while(Current() == TokenType::Times)
+    {
+        const NodeIndex lhs = node;
+        node = NewNode(AstKind::Times);
+        Next();
+        NodeIndex rhs;
+        if(!ParseFactor(rhs))
+            return false;
+        if(node != NO_NODE)
+        {
+            ast_[node].child[0] = lhs;
+            ast_[node].child[1] = rhs;
+        }
+    }
+    return true;
 }
 
-void Parser::ParseFactor(void)
+bool Parser::ParseFactor(NodeIndex &node)
 {
-    if(Match(TokenType::IntLiteral))
-        return;
+    if(Current() == TokenType::IntLiteral)
+    {
+        node = NewNode(AstKind::IntLiteral);
+        if(node != NO_NODE)
+            ast_[node].value = toks_->Value(cur_);
+        Next();
+        return true;
+    }
     
-    if(Current().type != TokenType::Identifier)
-        Error("variable/procedure name expected");
-    const std::string &refName = Current().tokenStr;
+    if(Current() != TokenType::Identifier)
+        return Error("variable/procedure name expected");
+    const Name refName = CurrentName();
+    node = NewNode(AstKind::VarRef);
     Next();
 
     if(Match(TokenType::LeftBrac)) // 是个函数调用而非变量引用
     {
-        CheckProcDef(refName);
+        NodeIndex proc, arg;
+        if(!CheckProcDef(refName, proc))
+            return false;
         
-        ParseArithExpr();
+        if(!ParseArithExpr(arg))
+            return false;
     
         if(!Match(TokenType::RightBrac))
-            Error("')' expected");
+            return Error("')' expected");
+
+        if(node != NO_NODE)
+        {
+            AstNode &n = ast_[node];
+            n.kind = AstKind::Call;
+            n.child[0] = arg;
+            n.value = static_cast<int>(proc);
+        }
     }
     else
-        CheckVarDef(refName);
+    {
+        int var;
+        if(!CheckVarDef(refName, var))
+            return false;
+        if(node != NO_NODE)
+            ast_[node].value = var;
+    }
+
+    return true;
 }
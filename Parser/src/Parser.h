@@ -1,11 +1,16 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <functional>
 #include <string>
 #include <vector>
 
+#include "Ast.h"
+#include "SymbolTable.h"
 #include "Tokenizer.h"
 
+class ThreadPool;
+
 enum class VarKind
 {
     Parameter,
@@ -19,8 +24,8 @@ enum class VarType
 
 struct Var
 {
-    std::string name;
-    std::string proc;
+    Name name;
+    Name proc;
 
     VarKind kind;
     VarType type;
@@ -31,7 +36,7 @@ struct Var
 
 struct Proc
 {
-    std::string name;
+    Name name;
 
     VarType returnType;
 
@@ -42,17 +47,19 @@ struct Proc
 using VarTable  = std::vector<Var>;
 using ProcTable = std::vector<Proc>;
 
-struct ParserException
+// 语法错误，出错时直接记录下来而不抛出异常
+struct ParserError
 {
-    ParserException(const std::string &filename, int line,
-                    const std::string msg)
-        : filename(filename), line(line), msg(msg)
+    ParserError(const std::string &filename, int line, uint32_t offset,
+                const std::string msg)
+        : filename(filename), line(line), offset(offset), msg(msg)
     {
 
     }
 
     std::string filename;
     int line;
+    uint32_t offset; // 出错处的词法单元在源代码中的偏移
 
     std::string msg;
 };
@@ -60,12 +67,66 @@ struct ParserException
 class Parser
 {
 public:
-    using Errs = std::vector<ParserException>;
+    using Errs = std::vector<ParserError>;
+
+    // 过程定义在词法单元序列中的位置，与ProcTable一一对应，供增量分析使用
+    // 仅在对完整的词法单元序列进行分析时有意义
+    struct ProcSpan
+    {
+        size_t paramTok;               // 参数名
+        size_t bodyBegin, bodyEnd;     // 函数体的begin和end
+        size_t procPosBegin;           // 函数体中第一个过程在ProcTable中的位置
+        size_t errPosBegin, errPosEnd; // 函数体中产生的语法错误
+        bool clean;                    // 函数体分析结束时层次是否正确恢复
+    };
+
+    // 增量分析单独分析一个函数体时，其外层作用域中的名字由调用者判断是否可见
+    struct OuterScope
+    {
+        std::function<bool(const Name &)> hasVar;
+        std::function<bool(const Name &)> hasProc;
+    };
+
+    // 每当一个窗口内的词法单元被完全消耗时调用
+    using TokenSink = std::function<void(const Tokenizer::TokenStream &)>;
 
+    // 流式分析时每次从Tokenizer拉取的词法单元数
+    static constexpr size_t WINDOW_SIZE = 4096;
+
+    // 对已经完整分析好的词法单元序列进行语法分析
     Parser(const Tokenizer::TokenStream &toks,
            const std::string &filename);
 
-    void Parse(void);
+    // 流式分析：语法分析过程中按需从tokenizer拉取词法单元，
+    // 词法单元的内存占用与源文件大小无关
+    // 词法错误被追加到lexErrs中，被消耗完的词法单元依次交给sink
+    Parser(Tokenizer &tokenizer,
+           std::vector<TokenizerError> &lexErrs,
+           TokenSink sink,
+           const std::string &filename);
+
+    // 以流式分析的方式改为分析另一个文件，参数与上面的构造函数相同
+    // 各个表、符号表、语法树和窗口都只清空而保留已分配的内存，用于批量分析多个文件
+    void Reset(Tokenizer &tokenizer,
+               std::vector<TokenizerError> &lexErrs,
+               TokenSink sink,
+               const std::string &filename);
+
+    Parser(const Parser &) = delete;
+    Parser &operator=(const Parser &) = delete;
+
+    // buildAst为真时同时构造语法树，仅在没有语法错误时有意义
+    void Parse(bool buildAst = false);
+
+    // 以表驱动的LL(1)分析代替递归下降（见ParserLL.cpp），以显式栈代替调用栈，
+    // 任意深的嵌套都不会耗尽调用栈；VarTable、ProcTable和错误都与Parse()相同，不构造语法树
+    void ParseLL(void);
+
+    // 主程序中的各个过程定义互不嵌套，把它们按词法单元数分组，
+    // 各组在pool中并行分析后再按顺序合并（见ParserParallel.cpp），不构造语法树
+    // 仅用于完整的词法单元序列；结果与Parse()完全相同，
+    // 预扫描不出定义的边界或任一组出现语法错误时，退回到顺序分析
+    void ParseParallel(ThreadPool &pool);
 
     const VarTable &GetVars(void) const;
 
@@ -73,61 +134,156 @@ public:
 
     const Errs &GetErrs(void) const;
 
+    const Ast &GetAst(void) const;
+
+    const std::vector<ProcSpan> &GetProcSpans(void) const;
+
+    // 增量分析：词法单元序列恰好是一个函数体（从begin到end，其后为结束标志），
+    // 把它当作第level层中定义的过程procName的函数体来分析，本地找不到的名字交给outer
+    // VarTable、ProcTable和span中的位置都相对于这个函数体；返回是否恰好分析到了最后的end
+    bool ParseDetachedBody(const Name &paramName, const Name &procName, int level,
+                           const OuterScope &outer, ProcSpan &span);
+
 private:
 
-    void Error(const std::string &msg) const;
+    // ParseLL中正在分析的过程
+    struct ProcFrame;
+
+    // 主程序中的一个定义，由ParseParallel的预扫描得到
+    struct TopLevelDef
+    {
+        size_t begin; // 定义开头的integer
+        Name name;
+        bool isProc;
+    };
+
+    // 预扫描主程序中的定义：按begin和end的配对跳过函数体，只检查定义的大致结构
+    // defsEnd为定义之后第一个词法单元的位置；结构不符时返回false
+    bool ScanTopLevelDefs(std::vector<TopLevelDef> &defs, size_t &defsEnd) const;
+
+    // 在已有defs[0, first)这些外层定义的作用域中，分析defs[first, last)，
+    // end为最后一个定义之后的位置；出现任何语法错误或者定义的边界与预扫描不符时返回false
+    bool ParseDefRange(const std::vector<TopLevelDef> &defs,
+                       size_t first, size_t last, size_t end);
 
-    // 从分析定义时发生错误的状态恢复到可以继续进行分析的状态
-    void ErrorRecWithDef(void);
+    // 记录一个语法错误，总是返回false
+    // 各分析函数出错时返回false，调用者随之返回false，直到某个能够恢复的产生式为止，
+    // 效果与抛出异常后在该处捕获相同
+    bool Error(const std::string &msg);
+
+    // 跳过词法单元直到遇到syncSet中的某一个（见Parser.cpp中的同步集合），
+    // 从出错的状态恢复到可以继续进行分析的状态
+    void Synchronize(uint32_t syncSet);
 
     // 匹配一个token，若成功则跳过该token
     bool Match(TokenType type);
 
-    const Token &Current(void) const;
+    // 当前词法单元的类型、名字（仅对标识符有意义）和所在行
+    TokenType Current(void) const;
+
+    Name CurrentName(void) const;
+
+    int CurrentLine(void) const;
 
     void Next(void);
 
-    // 检查一个变量是否有定义
-    void CheckVarDef(const std::string &var) const;
+    // 流式分析时换入下一个窗口
+    void Refill(void);
+
+    // 消耗掉剩余的词法单元，保证sink看到完整的词法单元序列
+    void Finish(void);
+
+    // 进入和离开一层作用域，同时维护level_
+    void EnterScope(void);
+
+    void LeaveScope(void);
+
+    // 按VarTable的前varCount项和ProcTable的前procCount项重建作用域栈，
+    // 使之回到开始分析这些定义之后的位置时的状态，最后停留在第level层
+    void RestoreScopes(size_t varCount, size_t procCount, int level);
+
+    // 不构造语法树时返回NO_NODE
+    NodeIndex NewNode(AstKind kind);
+
+    // 把node接到序列[first, last]的末尾
+    void AppendNode(NodeIndex &first, NodeIndex &last, NodeIndex node);
 
-    // 检查一个过程是否有定义
-    void CheckProcDef(const std::string &var) const;
+    // 检查一个变量是否有定义，var为其在VarTable中的位置
+    bool CheckVarDef(const Name &name, int &var);
 
-    void ParseProgram(void);
+    // 检查一个过程是否有定义，proc为其ProcDef节点
+    bool CheckProcDef(const Name &name, NodeIndex &proc);
 
-    void ParseSubprogram(void);
+    // 以下各函数通过node返回所构造的语法树节点（或节点序列中的第一个），
+    // 返回值表示分析是否成功；ParseDefs和ParseExecs在内部恢复错误，总是成功
 
-    void ParseDefs(const std::string &paramName = "",
-                   const std::string &procName = "");
+    bool ParseProgram(NodeIndex &node);
 
-    void ParseVarDef(const std::string &paramName,
-                     const std::string &procName);
+    bool ParseSubprogram(NodeIndex &node);
 
-    void ParseProcDef(void);
+    NodeIndex ParseDefs(const Name &paramName = Name(),
+                        const Name &procName = Name());
 
-    void ParseExecs(void);
+    // 一个变量或过程定义，连同其后的分号（或end）；proc为过程定义的ProcDef节点
+    bool ParseDef(const Name &paramName,
+                  const Name &procName,
+                  NodeIndex &proc);
 
-    void ParseExec(void);
+    bool ParseVarDef(const Name &paramName,
+                     const Name &procName);
 
-    void ParseArithExpr(void);
+    bool ParseProcDef(NodeIndex &node);
 
-    void ParseItem(void);
+    // 从begin到end分析函数体，填写span中函数体相关的部分，以及node的子节点
+    bool ParseProcBody(const Name &paramName,
+                       const Name &procName,
+                       ProcSpan &span, NodeIndex node);
 
-    void ParseFactor(void);
+    NodeIndex ParseExecs(void);
+
+    bool ParseExec(NodeIndex &node);
+
+    bool ParseArithExpr(NodeIndex &node);
+
+    bool ParseItem(NodeIndex &node);
+
+    bool ParseFactor(NodeIndex &node);
 
 private:
 
-    Tokenizer::TokenStream toks_;
-    Tokenizer::TokenStream::iterator cur_;
+    const Tokenizer::TokenStream *toks_;
+    size_t cur_;
+
+    // 以下仅用于流式分析
+    Tokenizer *tokenizer_;
+    std::vector<TokenizerError> *lexErrs_;
+    TokenSink sink_;
+    Tokenizer::TokenStream window_;
 
     VarTable vars_;
     ProcTable procs_;
+    std::vector<ProcSpan> spans_;
+
+    // 当前可见的变量和过程，值为其在vars_和procs_中的位置
+    // 变量和过程的名字互不冲突，分别存放
+    SymbolTable varSyms_;
+    SymbolTable procSyms_;
 
     std::string filename_;
     int level_;
 
-    // 记录正在分析的过程名
-    std::string containingProc_;
+    // 仅在ParseDetachedBody中使用
+    const OuterScope *outer_;
+
+    // 记录正在分析的过程名及其ProcDef节点
+    Name containingProc_;
+    NodeIndex containingNode_;
+
+    bool buildAst_;
+    Ast ast_;
+
+    // 与procs_一一对应的ProcDef节点，仅在构造语法树时使用
+    std::vector<NodeIndex> procNodes_;
 
     Errs errs_;
 };
@@ -0,0 +1,663 @@
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "Parser.h"
+
+// 表驱动的LL(1)分析
+// 文法写成产生式表，FIRST集、可空性和分析表都在编译期算出；
+// 分析时以堆上的显式栈代替递归，嵌套的深度只受内存限制
+// 语义动作以动作符号的形式插在产生式中，执行的时机与递归下降的版本逐一对应，
+// 因此得到的VarTable/ProcTable和错误信息（包括行号）都与之完全相同
+
+namespace
+{
+    constexpr uint32_t TokenBit(TokenType type)
+    {
+        return 1u << static_cast<int>(type);
+    }
+
+    // 非终结符
+    enum Nonterminal : uint8_t
+    {
+        NT_PROGRAM,
+        NT_DEFS,
+        NT_DEFS_LOOP,  // 恢复点，对应ParseDefs中的循环
+        NT_DEF_ITEM,
+        NT_DEF_REST,
+        NT_DEF_TERM,
+        NT_VAR_DEF,
+        NT_PROC_DEF,
+        NT_PROC_BODY,
+        NT_EXECS,
+        NT_EXECS_LOOP, // 恢复点，对应ParseExecs中的循环
+        NT_EXEC,
+        NT_COMPARE_OP,
+        NT_EXPR,
+        NT_EXPR_TAIL,
+        NT_ITEM,
+        NT_ITEM_TAIL,
+        NT_FACTOR,
+        NT_FACTOR_TAIL,
+
+        NT_COUNT
+    };
+
+    // 语义动作
+    enum Action : uint8_t
+    {
+        A_ENTER_SCOPE,
+        A_LEAVE_SCOPE,
+        A_VAR_DEF,     // 定义刚读到的变量
+        A_PROC_HEAD,   // 检查刚读到的过程名，开始一个过程
+        A_BODY_BEGIN,  // 进入函数体
+        A_CHECK_PARAM, // 检查参数有定义
+        A_SET_CON,     // 开始分析函数体中的语句
+        A_BODY_END,    // 离开函数体
+        A_PROC_END,    // 过程分析完毕，加入过程表
+        A_CHECK_CALL,  // 检查刚读到的过程名
+        A_CHECK_REF    // 检查刚读到的变量名
+    };
+
+    // 匹配终结符后、跳过它之前执行的操作
+    enum Hook : uint8_t
+    {
+        H_NONE,
+        H_CAPTURE,     // 保存标识符的名字，供之后的动作使用
+        H_PARAM,       // 保存参数名
+        H_CHECK_VAR,   // 检查变量有定义
+        H_CHECK_TARGET // 检查赋值的目标有定义（所在函数名除外）
+    };
+
+    // 出错时的信息
+    enum Message : uint8_t
+    {
+        M_NONE,
+        M_BEGIN,
+        M_END,
+        M_PROGRAM_END,
+        M_INTEGER,
+        M_VAR_NAME,
+        M_FUNC_NAME,
+        M_LBRAC,
+        M_PARAM,
+        M_RBRAC,
+        M_SEMICOLON,
+        M_VARIABLE,
+        M_THEN,
+        M_ELSE,
+        M_ASSIGN,
+        M_STATEMENT,
+        M_COMPARE,
+        M_FACTOR
+    };
+
+    const char *const MESSAGES[] =
+    {
+        "",
+        "'begin' expected",
+        "'end' expected",
+        "program end expected",
+        "'integer' expected",
+        "variable name expected",
+        "function name expected",
+        "'(' expected",
+        "parameter expected",
+        "')' expected",
+        "';' expected",
+        "'variable expected'",
+        "'then' expected",
+        "'else' expected",
+        "':=' expected",
+        "unnknown statement type",
+        "Comparation operator expected",
+        "variable/procedure name expected"
+    };
+
+    enum SymbolKind : uint8_t
+    {
+        K_TERMINAL,
+        K_NONTERMINAL,
+        K_ACTION
+    };
+
+    // 文法符号，也是分析栈中的元素
+    struct Symbol
+    {
+        uint8_t kind;
+        uint8_t id;
+        uint8_t msg;  // 终结符不匹配时的错误信息
+        uint8_t hook;
+    };
+
+    constexpr Symbol T(TokenType type, uint8_t msg = M_NONE, uint8_t hook = H_NONE)
+    {
+        return Symbol{ K_TERMINAL, static_cast<uint8_t>(type), msg, hook };
+    }
+
+    constexpr Symbol N(Nonterminal nt)
+    {
+        return Symbol{ K_NONTERMINAL, nt, M_NONE, H_NONE };
+    }
+
+    constexpr Symbol A(Action action)
+    {
+        return Symbol{ K_ACTION, action, M_NONE, H_NONE };
+    }
+
+    constexpr int MAX_RHS = 8;
+
+    struct Production
+    {
+        uint8_t lhs;
+        uint8_t length;
+        Symbol rhs[MAX_RHS];
+    };
+
+    constexpr Production P(Nonterminal lhs, std::initializer_list<Symbol> rhs)
+    {
+        Production p = { lhs, 0, { } };
+        for(const Symbol &s : rhs)
+            p.rhs[p.length++] = s;
+        return p;
+    }
+
+    using TT = TokenType;
+
+    constexpr Production PRODUCTIONS[] =
+    {
+        P(NT_PROGRAM,     { T(TT::Begin, M_BEGIN), A(A_ENTER_SCOPE), N(NT_DEFS), N(NT_EXECS),
+                            T(TT::End, M_END), A(A_LEAVE_SCOPE), T(TT::EndMark, M_PROGRAM_END) }),
+
+        P(NT_DEFS,        { N(NT_DEF_ITEM), N(NT_DEFS_LOOP) }),
+        P(NT_DEFS_LOOP,   { N(NT_DEF_ITEM), N(NT_DEFS_LOOP) }),
+        P(NT_DEFS_LOOP,   { }),
+        P(NT_DEF_ITEM,    { T(TT::Integer, M_INTEGER), N(NT_DEF_REST), N(NT_DEF_TERM) }),
+        P(NT_DEF_REST,    { T(TT::Function), N(NT_PROC_DEF) }),
+        P(NT_DEF_REST,    { N(NT_VAR_DEF) }),
+        P(NT_DEF_TERM,    { T(TT::Semicolon) }),
+        P(NT_DEF_TERM,    { T(TT::End) }),
+        P(NT_VAR_DEF,     { T(TT::Identifier, M_VAR_NAME, H_CAPTURE), A(A_VAR_DEF) }),
+
+        P(NT_PROC_DEF,    { T(TT::Identifier, M_FUNC_NAME, H_CAPTURE), A(A_PROC_HEAD),
+                            T(TT::LeftBrac, M_LBRAC), T(TT::Identifier, M_PARAM, H_PARAM),
+                            T(TT::RightBrac, M_RBRAC), T(TT::Semicolon, M_SEMICOLON),
+                            N(NT_PROC_BODY), A(A_PROC_END) }),
+        P(NT_PROC_BODY,   { A(A_BODY_BEGIN), T(TT::Begin, M_BEGIN), N(NT_DEFS), A(A_CHECK_PARAM),
+                            A(A_SET_CON), N(NT_EXECS), A(A_BODY_END), T(TT::End, M_END) }),
+
+        P(NT_EXECS,       { N(NT_EXEC), N(NT_EXECS_LOOP) }),
+        P(NT_EXECS_LOOP,  { T(TT::Semicolon), N(NT_EXEC), N(NT_EXECS_LOOP) }),
+        P(NT_EXECS_LOOP,  { }),
+        P(NT_EXEC,        { T(TT::Read), T(TT::LeftBrac, M_LBRAC),
+                            T(TT::Identifier, M_VARIABLE, H_CHECK_VAR), T(TT::RightBrac, M_RBRAC) }),
+        P(NT_EXEC,        { T(TT::Write), T(TT::LeftBrac, M_LBRAC),
+                            T(TT::Identifier, M_VARIABLE, H_CHECK_VAR), T(TT::RightBrac, M_RBRAC) }),
+        P(NT_EXEC,        { T(TT::If), N(NT_EXPR), N(NT_COMPARE_OP), N(NT_EXPR),
+                            T(TT::Then, M_THEN), N(NT_EXEC), T(TT::Else, M_ELSE), N(NT_EXEC) }),
+        P(NT_EXEC,        { T(TT::Identifier, M_NONE, H_CHECK_TARGET), T(TT::Assign, M_ASSIGN),
+                            N(NT_EXPR) }),
+        P(NT_COMPARE_OP,  { T(TT::Less) }),
+        P(NT_COMPARE_OP,  { T(TT::LessEqual) }),
+        P(NT_COMPARE_OP,  { T(TT::Equal) }),
+        P(NT_COMPARE_OP,  { T(TT::GreaterEqual) }),
+        P(NT_COMPARE_OP,  { T(TT::Greater) }),
+        P(NT_COMPARE_OP,  { T(TT::NotEqual) }),
+
+        P(NT_EXPR,        { N(NT_ITEM), N(NT_EXPR_TAIL) }),
+        P(NT_EXPR_TAIL,   { T(TT::Minus), N(NT_ITEM), N(NT_EXPR_TAIL) }),
+        P(NT_EXPR_TAIL,   { }),
+        P(NT_ITEM,        { N(NT_FACTOR), N(NT_ITEM_TAIL) }),
+        P(NT_ITEM_TAIL,   { T(TT::Times), N(NT_FACTOR), N(NT_ITEM_TAIL) }),
+        P(NT_ITEM_TAIL,   { }),
+        P(NT_FACTOR,      { T(TT::IntLiteral) }),
+        P(NT_FACTOR,      { T(TT::Identifier, M_NONE, H_CAPTURE), N(NT_FACTOR_TAIL) }),
+        P(NT_FACTOR_TAIL, { T(TT::LeftBrac), A(A_CHECK_CALL), N(NT_EXPR), T(TT::RightBrac, M_RBRAC) }),
+        P(NT_FACTOR_TAIL, { A(A_CHECK_REF) })
+    };
+
+    constexpr int PRODUCTION_COUNT = sizeof(PRODUCTIONS) / sizeof(PRODUCTIONS[0]);
+
+    // 非终结符的附加信息
+    struct NonterminalInfo
+    {
+        // 表中没有对应的产生式时的错误信息
+        uint8_t msg;
+
+        // 表中没有对应的产生式时使用的产生式，为-1时按以下规则确定：
+        // 有可空的产生式则用它，只有一个产生式则用它（由其中的终结符报告错误），否则报错
+        int8_t fallback;
+
+        // 恢复点：出错时退回到最近的恢复点，跳到syncSet中的词法单元后继续分析
+        bool recovery;
+        uint32_t syncSet;
+        bool skipSemicolon;
+    };
+
+    // 与递归下降的版本相同，定义和语句出错后都跳到下一个分号、end或者程序末尾处
+    constexpr uint32_t SYNC_DEFS  = TokenBit(TT::Semicolon) |
+                                    TokenBit(TT::End) |
+                                    TokenBit(TT::EndMark);
+    constexpr uint32_t SYNC_EXECS = SYNC_DEFS;
+
+    constexpr NonterminalInfo NONTERMINALS[NT_COUNT] =
+    {
+        { M_NONE,      -1, false, 0,          false }, // NT_PROGRAM
+        { M_NONE,      -1, false, 0,          false }, // NT_DEFS
+        { M_NONE,      -1, true,  SYNC_DEFS,  true  }, // NT_DEFS_LOOP
+        { M_NONE,      -1, false, 0,          false }, // NT_DEF_ITEM
+        { M_NONE,       6, false, 0,          false }, // NT_DEF_REST，不是function即为变量定义
+        { M_SEMICOLON, -1, false, 0,          false }, // NT_DEF_TERM
+        { M_NONE,      -1, false, 0,          false }, // NT_VAR_DEF
+        { M_NONE,      -1, false, 0,          false }, // NT_PROC_DEF
+        { M_NONE,      -1, false, 0,          false }, // NT_PROC_BODY
+        { M_NONE,      -1, false, 0,          false }, // NT_EXECS
+        { M_NONE,      -1, true,  SYNC_EXECS, false }, // NT_EXECS_LOOP
+        { M_STATEMENT, -1, false, 0,          false }, // NT_EXEC
+        { M_COMPARE,   -1, false, 0,          false }, // NT_COMPARE_OP
+        { M_NONE,      -1, false, 0,          false }, // NT_EXPR
+        { M_NONE,      -1, false, 0,          false }, // NT_EXPR_TAIL
+        { M_NONE,      -1, false, 0,          false }, // NT_ITEM
+        { M_NONE,      -1, false, 0,          false }, // NT_ITEM_TAIL
+        { M_FACTOR,    -1, false, 0,          false }, // NT_FACTOR
+        { M_NONE,      -1, false, 0,          false }, // NT_FACTOR_TAIL
+    };
+
+    static_assert(PRODUCTIONS[6].lhs == NT_DEF_REST &&
+                  PRODUCTIONS[6].rhs[0].id == NT_VAR_DEF, "fallback of NT_DEF_REST");
+
+    // FIRST集与可空性
+    struct FirstSets
+    {
+        uint32_t first[NT_COUNT];
+        bool nullable[NT_COUNT];
+    };
+
+    // 产生式右部的FIRST集，nullable返回其是否可空
+    constexpr uint32_t FirstOfRhs(const FirstSets &f, const Production &p, bool &nullable)
+    {
+        uint32_t rt = 0;
+        for(int i = 0; i < p.length; ++i)
+        {
+            const Symbol &s = p.rhs[i];
+            if(s.kind == K_TERMINAL)
+            {
+                nullable = false;
+                return rt | (1u << s.id);
+            }
+            if(s.kind == K_NONTERMINAL)
+            {
+                rt |= f.first[s.id];
+                if(!f.nullable[s.id])
+                {
+                    nullable = false;
+                    return rt;
+                }
+            }
+            // 动作符号不消耗词法单元，视为空
+        }
+        nullable = true;
+        return rt;
+    }
+
+    constexpr FirstSets ComputeFirstSets(void)
+    {
+        FirstSets f = { { }, { } };
+        for(bool changed = true; changed;)
+        {
+            changed = false;
+            for(const Production &p : PRODUCTIONS)
+            {
+                bool nullable = false;
+                const uint32_t first = FirstOfRhs(f, p, nullable) | f.first[p.lhs];
+                nullable = nullable || f.nullable[p.lhs];
+                if(first != f.first[p.lhs] || nullable != f.nullable[p.lhs])
+                {
+                    f.first[p.lhs] = first;
+                    f.nullable[p.lhs] = nullable;
+                    changed = true;
+                }
+            }
+        }
+        return f;
+    }
+
+    constexpr FirstSets FIRST_SETS = ComputeFirstSets();
+
+    constexpr int8_t ERROR_ENTRY = -1;
+    constexpr int8_t CONFLICT_ENTRY = -2;
+
+    using ParseTable = std::array<std::array<int8_t, TOKEN_CODE_COUNT>, NT_COUNT>;
+
+    constexpr ParseTable BuildParseTable(void)
+    {
+        ParseTable t = { };
+        for(auto &row : t)
+        {
+            for(auto &e : row)
+                e = ERROR_ENTRY;
+        }
+
+        // 按FIRST集填表
+        for(int i = 0; i < PRODUCTION_COUNT; ++i)
+        {
+            const Production &p = PRODUCTIONS[i];
+            bool nullable = false;
+            const uint32_t first = FirstOfRhs(FIRST_SETS, p, nullable);
+            for(int tok = 0; tok < TOKEN_CODE_COUNT; ++tok)
+            {
+                if(first & (1u << tok))
+                    t[p.lhs][tok] = t[p.lhs][tok] == ERROR_ENTRY ? static_cast<int8_t>(i) : CONFLICT_ENTRY;
+            }
+        }
+
+        // 其余的表项
+        for(int nt = 0; nt < NT_COUNT; ++nt)
+        {
+            int8_t fallback = NONTERMINALS[nt].fallback;
+            int count = 0, single = ERROR_ENTRY;
+            for(int i = 0; i < PRODUCTION_COUNT && fallback < 0; ++i)
+            {
+                if(PRODUCTIONS[i].lhs != nt)
+                    continue;
+                ++count;
+                single = i;
+                bool nullable = false;
+                FirstOfRhs(FIRST_SETS, PRODUCTIONS[i], nullable);
+                if(nullable)
+                    fallback = static_cast<int8_t>(i);
+            }
+            if(fallback < 0 && count == 1)
+                fallback = static_cast<int8_t>(single);
+            if(fallback < 0 && NONTERMINALS[nt].msg == M_NONE)
+                fallback = CONFLICT_ENTRY; // 必须有错误信息
+
+            for(auto &e : t[nt])
+            {
+                if(e == ERROR_ENTRY)
+                    e = fallback;
+            }
+        }
+        return t;
+    }
+
+    constexpr ParseTable PARSE_TABLE = BuildParseTable();
+
+    constexpr bool IsLL1(void)
+    {
+        for(const auto &row : PARSE_TABLE)
+        {
+            for(int8_t e : row)
+            {
+                if(e == CONFLICT_ENTRY)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    static_assert(IsLL1(), "grammar is not LL(1)");
+
+    // 产生式右部按逆序排好，展开时整块压栈
+    struct Expansion
+    {
+        uint8_t length;
+        int8_t recovery; // 右部中恢复点在栈中的偏移，没有时为-1
+        Symbol rhs[MAX_RHS];
+    };
+
+    using ExpansionTable = std::array<Expansion, PRODUCTION_COUNT>;
+
+    constexpr ExpansionTable BuildExpansions(void)
+    {
+        ExpansionTable t = { };
+        for(int i = 0; i < PRODUCTION_COUNT; ++i)
+        {
+            const Production &p = PRODUCTIONS[i];
+            Expansion &e = t[i];
+            e.length = p.length;
+            e.recovery = -1;
+            for(int j = 0; j < p.length; ++j)
+            {
+                const Symbol &s = p.rhs[p.length - 1 - j];
+                e.rhs[j] = s;
+                if(s.kind == K_NONTERMINAL && NONTERMINALS[s.id].recovery)
+                    e.recovery = e.recovery < 0 ? static_cast<int8_t>(j) : MAX_RHS;
+            }
+        }
+        return t;
+    }
+
+    constexpr ExpansionTable EXPANSIONS = BuildExpansions();
+
+    constexpr bool OneRecoveryEach(void)
+    {
+        for(const Expansion &e : EXPANSIONS)
+        {
+            if(e.recovery == MAX_RHS)
+                return false;
+        }
+        return true;
+    }
+
+    static_assert(OneRecoveryEach(), "at most one recovery point per production");
+
+    // 恢复点在分析栈中的位置，以及压入它时各辅助栈的高度
+    struct RecoveryPoint
+    {
+        size_t stackPos;
+        size_t nameCount;
+        size_t frameCount;
+    };
+}
+
+// 正在分析的过程，对应递归下降版本中ParseProcDef和ParseProcBody的局部变量
+struct Parser::ProcFrame
+{
+    Name name, param;
+    size_t varBegin;
+    int bodyLevel;
+    Name oldCon;
+    ProcSpan span;
+};
+
+void Parser::ParseLL(void)
+{
+    buildAst_ = false;
+
+    // 栈中有效的部分为[0, top)，每次展开前保证至少能再放下MAX_RHS个符号
+    std::vector<Symbol> stack(64);
+    size_t top = 0;
+    std::vector<RecoveryPoint> recovery;
+    std::vector<Name> names;
+    std::vector<ProcFrame> frames;
+
+    // 出错后退回最近的恢复点，没有恢复点时分析结束
+    auto recover = [&](void)
+    {
+        if(recovery.empty())
+        {
+            top = 0;
+            return;
+        }
+        const RecoveryPoint &r = recovery.back();
+        top = r.stackPos + 1;
+        names.resize(r.nameCount);
+        frames.resize(r.frameCount);
+
+        const NonterminalInfo &info = NONTERMINALS[stack[top - 1].id];
+        Synchronize(info.syncSet);
+        if(info.skipSemicolon)
+            Match(TokenType::Semicolon);
+    };
+
+    auto popName = [&](void)
+    {
+        const Name name = names.back();
+        names.pop_back();
+        return name;
+    };
+
+    stack[top++] = N(NT_PROGRAM);
+    while(top)
+    {
+        const Symbol s = stack[--top];
+
+        bool ok = true;
+        int var;
+        NodeIndex proc;
+
+        switch(s.kind)
+        {
+        case K_TERMINAL:
+            if(Current() != static_cast<TokenType>(s.id))
+            {
+                ok = Error(MESSAGES[s.msg]);
+                break;
+            }
+            switch(s.hook)
+            {
+            case H_CAPTURE:
+                names.push_back(CurrentName());
+                break;
+            case H_PARAM:
+                frames.back().param = CurrentName();
+                frames.back().span.paramTok = cur_;
+                break;
+            case H_CHECK_VAR:
+                ok = CheckVarDef(CurrentName(), var);
+                break;
+            case H_CHECK_TARGET:
+                if(CurrentName() != containingProc_)
+                    ok = CheckVarDef(CurrentName(), var);
+                break;
+            }
+            if(ok)
+                Next();
+            break;
+
+        case K_NONTERMINAL:
+        {
+            if(NONTERMINALS[s.id].recovery)
+                recovery.pop_back();
+
+            const int8_t p = PARSE_TABLE[s.id][static_cast<int>(Current())];
+            if(p < 0)
+            {
+                ok = Error(MESSAGES[NONTERMINALS[s.id].msg]);
+                break;
+            }
+            const Expansion &e = EXPANSIONS[p];
+            if(e.recovery >= 0)
+                recovery.push_back(RecoveryPoint{ top + e.recovery,
+                                                  names.size(), frames.size() });
+            if(top + MAX_RHS > stack.size())
+                stack.resize(stack.size() * 2);
+            // 总是复制整个右部，定长的复制比按实际长度复制快得多
+            std::memcpy(&stack[top], e.rhs, sizeof(e.rhs));
+            top += e.length;
+            break;
+        }
+
+        case K_ACTION:
+            switch(s.id)
+            {
+            case A_ENTER_SCOPE:
+                EnterScope();
+                break;
+
+            case A_LEAVE_SCOPE:
+                LeaveScope();
+                break;
+
+            case A_VAR_DEF:
+            {
+                const Name name = popName();
+                if(varSyms_.DefinedInScope(name) || name == containingProc_)
+                {
+                    ok = Error("Variale redefined: " + std::string(name.View()));
+                    break;
+                }
+                const Name param = frames.empty() ? Name() : frames.back().param;
+                const Name procName = frames.empty() ? Name() : frames.back().name;
+                varSyms_.Define(name, vars_.size());
+                vars_.push_back(Var{ name, procName,
+                                     param == name ? VarKind::Parameter : VarKind::Variable,
+                                     VarType::Integer, level_, vars_.size() });
+                break;
+            }
+
+            case A_PROC_HEAD:
+            {
+                const Name name = popName();
+                if(procSyms_.DefinedInScope(name))
+                {
+                    ok = Error("Procedure redefined: " + std::string(name.View()));
+                    break;
+                }
+                frames.push_back(ProcFrame{ name, Name(), vars_.size(), 0, Name(), ProcSpan() });
+                break;
+            }
+
+            case A_BODY_BEGIN:
+            {
+                ProcFrame &f = frames.back();
+                f.span.procPosBegin = procs_.size();
+                f.span.errPosBegin = errs_.size();
+                EnterScope();
+                f.bodyLevel = level_;
+                f.span.bodyBegin = cur_;
+                break;
+            }
+
+            case A_CHECK_PARAM:
+                ok = CheckVarDef(frames.back().param, var);
+                break;
+
+            case A_SET_CON:
+                frames.back().oldCon = containingProc_;
+                containingProc_ = frames.back().name;
+                break;
+
+            case A_BODY_END:
+            {
+                ProcFrame &f = frames.back();
+                containingProc_ = f.oldCon;
+                f.span.clean = level_ == f.bodyLevel;
+                LeaveScope();
+                f.span.bodyEnd = cur_;
+                break;
+            }
+
+            case A_PROC_END:
+            {
+                ProcFrame &f = frames.back();
+                f.span.errPosEnd = errs_.size();
+                procSyms_.Define(f.name, procs_.size());
+                procs_.push_back(Proc{ f.name, VarType::Integer, level_,
+                                       f.varBegin, vars_.size() });
+                spans_.push_back(f.span);
+                frames.pop_back();
+                break;
+            }
+
+            case A_CHECK_CALL:
+                ok = CheckProcDef(popName(), proc);
+                break;
+
+            case A_CHECK_REF:
+                ok = CheckVarDef(popName(), var);
+                break;
+            }
+            break;
+        }
+
+        if(!ok)
+            recover();
+    }
+
+    Finish();
+}
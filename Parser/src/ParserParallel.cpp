@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <memory>
+
+#include "Parser.h"
+#include "ThreadPool.h"
+
+// 并行分析主程序中的过程定义
+// 主程序的各个过程定义之间只通过主程序作用域中的名字发生联系：
+// 分析一个函数体时，可见的外层符号恰好是它之前的各个主程序定义，
+// 而前面函数体内部的定义在离开函数体时已经弹出
+// 因此只要知道每组之前有哪些主程序定义，各组就可以独立地分析，
+// 得到的VarTable/ProcTable与顺序分析相比只差一个整体的偏移
+
+namespace
+{
+    // 每组至少包含的词法单元数，太小的组不值得单独分析
+    constexpr size_t MIN_GROUP_SIZE = 4096;
+}
+
+void Parser::ParseParallel(ThreadPool &pool)
+{
+    std::vector<TopLevelDef> defs;
+    size_t defsEnd = 0;
+    if(tokenizer_ || pool.Size() < 2 || !ScanTopLevelDefs(defs, defsEnd))
+    {
+        Parse();
+        return;
+    }
+
+    // 按词法单元数大致均分，分组的边界总在定义之间
+    const size_t total = defsEnd - defs.front().begin;
+    const size_t groupSize = std::max(MIN_GROUP_SIZE, total / (pool.Size() * 4) + 1);
+    std::vector<size_t> groups;
+    for(size_t i = 0; i < defs.size(); ++i)
+    {
+        if(groups.empty() || defs[i].begin - defs[groups.back()].begin >= groupSize)
+            groups.push_back(i);
+    }
+    groups.push_back(defs.size());
+
+    if(groups.size() < 3)
+    {
+        Parse();
+        return;
+    }
+
+    const size_t groupCount = groups.size() - 1;
+    std::vector<std::unique_ptr<Parser>> parts(groupCount);
+    std::vector<char> succeeded(groupCount, 0);
+    for(size_t g = 0; g < groupCount; ++g)
+    {
+        pool.Submit([this, g, defsEnd, &defs, &groups, &parts, &succeeded]
+        {
+            parts[g].reset(new Parser(*toks_, filename_));
+            succeeded[g] = parts[g]->ParseDefRange(defs, groups[g], groups[g + 1], defsEnd);
+        });
+    }
+    pool.Wait();
+
+    // 有错误时错误的顺序和恢复后的状态都依赖于之前的分析，交给顺序分析处理
+    if(std::count(succeeded.begin(), succeeded.end(), 0))
+    {
+        Parse();
+        return;
+    }
+
+    // 按组的顺序合并，修正各组内的位置
+    for(const auto &part : parts)
+    {
+        const size_t varBase = vars_.size();
+        const size_t procBase = procs_.size();
+        for(Var v : part->vars_)
+        {
+            v.posInTable += varBase;
+            vars_.push_back(v);
+        }
+        for(Proc p : part->procs_)
+        {
+            p.varPosBegin += varBase;
+            p.varPosEnd += varBase;
+            procs_.push_back(p);
+        }
+        for(ProcSpan s : part->spans_)
+        {
+            s.procPosBegin += procBase;
+            spans_.push_back(s);
+        }
+    }
+
+    // 剩下的部分与ParseSubprogram中定义之后的部分相同
+    RestoreScopes(vars_.size(), procs_.size(), 1);
+    cur_ = defsEnd;
+
+    ParseExecs();
+
+    if(!Match(TokenType::End))
+        Error("'end' expected");
+    else
+    {
+        LeaveScope();
+        if(!Match(TokenType::EndMark))
+            Error("program end expected");
+    }
+}
+
+bool Parser::ScanTopLevelDefs(std::vector<TopLevelDef> &defs, size_t &defsEnd) const
+{
+    // 期望的词法单元不会是结束标志，因此扫描不会越过序列末尾
+    size_t i = 0;
+    auto expect = [&](TokenType type)
+    {
+        if(toks_->Type(i) != type)
+            return false;
+        ++i;
+        return true;
+    };
+
+    if(!expect(TokenType::Begin))
+        return false;
+
+    do {
+        TopLevelDef def;
+        def.begin = i;
+        if(!expect(TokenType::Integer))
+            return false;
+
+        def.isProc = expect(TokenType::Function);
+        def.name = toks_->NameAt(i);
+        if(!expect(TokenType::Identifier))
+            return false;
+
+        if(def.isProc)
+        {
+            if(!expect(TokenType::LeftBrac) ||
+               !expect(TokenType::Identifier) ||
+               !expect(TokenType::RightBrac) ||
+               !expect(TokenType::Semicolon) ||
+               toks_->Type(i) != TokenType::Begin)
+                return false;
+
+            // 跳到与之配对的end之后
+            for(int depth = 0; ; )
+            {
+                const TokenType type = toks_->Type(i);
+                if(type == TokenType::EndMark)
+                    return false;
+                ++i;
+                if(type == TokenType::Begin)
+                    ++depth;
+                else if(type == TokenType::End && --depth == 0)
+                    break;
+            }
+        }
+
+        if(!expect(TokenType::Semicolon) && !expect(TokenType::End))
+            return false;
+
+        defs.push_back(def);
+
+    } while(toks_->Type(i) == TokenType::Integer);
+
+    defsEnd = i;
+    return true;
+}
+
+bool Parser::ParseDefRange(const std::vector<TopLevelDef> &defs,
+                           size_t first, size_t last, size_t end)
+{
+    // 重建主程序的作用域；不构造语法树时符号表中的值不会被用到
+    EnterScope();
+    for(size_t i = 0; i < first; ++i)
+        (defs[i].isProc ? procSyms_ : varSyms_).Define(defs[i].name, 0);
+
+    cur_ = defs[first].begin;
+    const size_t stop = last < defs.size() ? defs[last].begin : end;
+    while(cur_ < stop)
+    {
+        NodeIndex proc;
+        if(!ParseDef(Name(), Name(), proc))
+            return false;
+    }
+
+    return cur_ == stop && errs_.empty() && level_ == 1;
+}
@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <climits>
+
+#include "IrOpt.h"
+#include "PartialEval.h"
+
+PartialEvaluator::PartialEvaluator(const VarTable &vars, const ProcTable &procs, uint64_t fuel)
+    : vars_(vars), procs_(procs), layout_(vars, procs), fuel_(fuel),
+      program_(nullptr), remaining_(0)
+{
+
+}
+
+size_t PartialEvaluator::Run(IrProgram &program)
+{
+    program_ = &program;
+    functions_.assign(procs_.size(), 0);
+    for(size_t i = 0; i < program.functions.size(); ++i)
+    {
+        if(program.functions[i].proc < procs_.size())
+            functions_[program.functions[i].proc] = i;
+    }
+
+    FindPureFunctions(program);
+    memo_.clear();
+    exhausted_.clear();
+    folded_.clear();
+
+    // 折叠之后的常量传播可能使更多调用的实参成为常量
+    size_t total = 0;
+    for(;;)
+    {
+        size_t count = 0;
+        for(IrFunction &function : program.functions)
+        {
+            const size_t n = FoldCalls(function);
+            if(n)
+                PropagateConstants(function);
+            count += n;
+        }
+        if(!count)
+            break;
+        total += count;
+    }
+
+    program_ = nullptr;
+    return total;
+}
+
+const std::vector<FoldedCall> &PartialEvaluator::GetFolded(void) const
+{
+    return folded_;
+}
+
+void PartialEvaluator::FindPureFunctions(const IrProgram &program)
+{
+    const size_t n = procs_.size();
+
+    // 是否（可能间接地）读写，以及访问的本次调用之外的活动记录中最外的层次
+    std::vector<bool> io(n, false);
+    std::vector<int32_t> outer(n, INT32_MAX);
+    std::vector<std::vector<size_t>> callers(n);
+
+    for(const IrFunction &function : program.functions)
+    {
+        const size_t proc = function.proc;
+        if(proc == layout_.MainFrame())
+            continue;
+
+        const int32_t level = layout_.Level(proc);
+        for(const IrBlock &block : function.blocks)
+        {
+            for(const IrInst &inst : block.insts)
+            {
+                switch(inst.op)
+                {
+                case IrOp::Read:
+                case IrOp::Write:
+                    io[proc] = true;
+                    break;
+                case IrOp::Load:
+                case IrOp::Store:
+                    if(vars_[inst.imm].level < level)
+                        outer[proc] = std::min(outer[proc], vars_[inst.imm].level);
+                    break;
+                case IrOp::Call:
+                    callers[inst.imm].push_back(proc);
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+    }
+
+    // 沿调用关系反向传播；被调用者访问调用者自己的活动记录（它是调用者直接嵌套的过程）时不传播
+    std::vector<size_t> work;
+    for(size_t p = 0; p < n; ++p)
+    {
+        if(io[p] || outer[p] != INT32_MAX)
+            work.push_back(p);
+    }
+    while(!work.empty())
+    {
+        const size_t callee = work.back();
+        work.pop_back();
+        for(const size_t caller : callers[callee])
+        {
+            bool changed = false;
+            if(io[callee] && !io[caller])
+            {
+                io[caller] = true;
+                changed = true;
+            }
+            if(outer[callee] < layout_.Level(caller) && outer[callee] < outer[caller])
+            {
+                outer[caller] = outer[callee];
+                changed = true;
+            }
+            if(changed)
+                work.push_back(caller);
+        }
+    }
+
+    pure_.assign(n, false);
+    for(size_t p = 0; p < n; ++p)
+        pure_[p] = !io[p] && outer[p] == INT32_MAX;
+}
+
+size_t PartialEvaluator::FoldCalls(IrFunction &function)
+{
+    std::vector<bool> known(function.valueCount, false);
+    std::vector<int32_t> value(function.valueCount, 0);
+
+    size_t count = 0;
+    for(IrBlock &block : function.blocks)
+    {
+        for(IrInst &inst : block.insts)
+        {
+            if(inst.op == IrOp::Call && known[inst.a] && pure_[inst.imm])
+            {
+                const int32_t arg = value[inst.a];
+                int32_t result;
+                if(Evaluate(inst.imm, arg, result))
+                {
+                    folded_.push_back(FoldedCall{ function.proc, inst.imm2, inst.imm, arg,
+                                                  result, fuel_ - remaining_ });
+                    inst.op = IrOp::Const;
+                    inst.a = NO_VALUE;
+                    inst.imm = result;
+                    inst.imm2 = 0;
+                    ++count;
+                }
+            }
+
+            if(inst.op == IrOp::Const)
+            {
+                known[inst.dest] = true;
+                value[inst.dest] = inst.imm;
+            }
+        }
+    }
+    return count;
+}
+
+bool PartialEvaluator::Evaluate(size_t proc, int32_t arg, int32_t &result)
+{
+    const uint64_t key = static_cast<uint64_t>(proc) << 32 | static_cast<uint32_t>(arg);
+    if(exhausted_.count(key))
+        return false;
+
+    remaining_ = fuel_;
+    if(Execute(proc, arg, nullptr, 0, result))
+        return true;
+
+    // 同样的调用不再重复尝试
+    exhausted_.insert(key);
+    return false;
+}
+
+bool PartialEvaluator::Execute(size_t proc, int32_t arg, Frame *link, int depth, int32_t &result)
+{
+    const uint64_t key = static_cast<uint64_t>(proc) << 32 | static_cast<uint32_t>(arg);
+    if(pure_[proc])
+    {
+        const auto found = memo_.find(key);
+        if(found != memo_.end())
+        {
+            result = found->second;
+            return true;
+        }
+    }
+    if(depth >= MAX_DEPTH)
+        return false;
+
+    const IrFunction &function = program_->functions[functions_[proc]];
+    Frame frame{ std::vector<int32_t>(layout_.FrameSize(proc), 0), link, layout_.Level(proc) };
+    std::vector<int32_t> values(function.valueCount, 0);
+
+    int32_t block = 0, prev = -1;
+    for(;;)
+    {
+        int32_t next = -1;
+        for(const IrInst &inst : function.blocks[block].insts)
+        {
+            if(remaining_ == 0)
+                return false;
+            --remaining_;
+
+            switch(inst.op)
+            {
+            case IrOp::Const:
+                values[inst.dest] = inst.imm;
+                break;
+            case IrOp::Param:
+                values[inst.dest] = arg;
+                break;
+            case IrOp::Load:
+            case IrOp::Store:
+            {
+                Frame *owner = FrameAt(&frame, vars_[inst.imm].level);
+                if(!owner)
+                    return false;
+                int32_t &slot = owner->vars[layout_.Slot(inst.imm)];
+                if(inst.op == IrOp::Load)
+                    values[inst.dest] = slot;
+                else
+                    slot = values[inst.a];
+                break;
+            }
+            case IrOp::Copy:
+                values[inst.dest] = values[inst.a];
+                break;
+            case IrOp::Sub:
+                values[inst.dest] = IrSub(values[inst.a], values[inst.b]);
+                break;
+            case IrOp::Mul:
+                values[inst.dest] = IrMul(values[inst.a], values[inst.b]);
+                break;
+            case IrOp::Phi:
+                values[inst.dest] = prev == function.blocks[block].preds[0] ?
+                                    values[inst.a] : values[inst.b];
+                break;
+            case IrOp::Call:
+                if(!Execute(inst.imm, values[inst.a], FrameAt(&frame, layout_.Level(inst.imm) - 1),
+                            depth + 1, values[inst.dest]))
+                    return false;
+                break;
+            case IrOp::Branch:
+                next = IrCompare(inst.cond, values[inst.a], values[inst.b]) ? inst.imm : inst.imm2;
+                break;
+            case IrOp::Jump:
+                next = inst.imm;
+                break;
+            case IrOp::Ret:
+                result = values[inst.a];
+                if(pure_[proc])
+                    memo_.emplace(key, result);
+                return true;
+            default:
+                // 纯函数不会执行到Read和Write
+                return false;
+            }
+        }
+        prev = block;
+        block = next;
+    }
+}
+
+PartialEvaluator::Frame *PartialEvaluator::FrameAt(Frame *frame, int32_t level) const
+{
+    // 本次调用之外的活动记录不可见，纯函数也不会访问它们
+    while(frame && frame->level > level)
+        frame = frame->link;
+    return frame && frame->level == level ? frame : nullptr;
+}
+
+void PrintFoldedCalls(std::ostream &out, const std::vector<FoldedCall> &folded,
+                      const ProcTable &procs)
+{
+    out << "; folded calls: " << folded.size() << '\n';
+    for(const FoldedCall &call : folded)
+    {
+        out << ";   line " << call.line << " in ";
+        if(call.caller == procs.size())
+            out << "main";
+        else
+            out << procs[call.caller].name << '#' << call.caller;
+        out << ": " << procs[call.callee].name << '#' << call.callee
+            << '(' << call.arg << ") = " << call.result;
+        if(call.steps)
+            out << ", " << call.steps << " steps\n";
+        else
+            out << ", memoized\n";
+    }
+    out << '\n';
+}
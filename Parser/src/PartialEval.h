@@ -0,0 +1,94 @@
+#ifndef PARTIALEVAL_H
+#define PARTIALEVAL_H
+
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "FrameLayout.h"
+#include "Ir.h"
+#include "Parser.h"
+
+// 一处被折叠的调用
+struct FoldedCall
+{
+    size_t caller;      // 调用所在的函数，主程序为ProcTable的大小
+    int32_t line;
+    int32_t callee;
+    int32_t arg;
+    int32_t result;
+    uint64_t steps;     // 求值执行的IR指令数，为0时直接使用了之前求得的结果
+};
+
+// 编译期部分求值：实参为常量的纯函数调用在编译期执行，以结果代替调用
+// 纯函数是指执行过程中（含其调用的函数）既不读写，也不访问本次调用之外的活动记录中的变量，
+// 因此结果只取决于实参；函数内部嵌套的过程访问外层函数的变量不影响外层函数的纯度
+// 每处调用的求值最多执行fuel条指令，超出或递归过深时放弃折叠，保留原来的调用
+class PartialEvaluator
+{
+public:
+
+    static constexpr uint64_t DEFAULT_FUEL = 1000000;
+
+    PartialEvaluator(const VarTable &vars, const ProcTable &procs,
+                     uint64_t fuel = DEFAULT_FUEL);
+
+    // 反复折叠，并对调用所在的函数做常量传播，直到没有可以折叠的调用，返回折叠的调用数
+    size_t Run(IrProgram &program);
+
+    const std::vector<FoldedCall> &GetFolded(void) const;
+
+private:
+
+    struct Frame
+    {
+        std::vector<int32_t> vars;
+        Frame *link;
+        int32_t level;
+    };
+
+    void FindPureFunctions(const IrProgram &program);
+
+    size_t FoldCalls(IrFunction &function);
+
+    bool Evaluate(size_t proc, int32_t arg, int32_t &result);
+
+    bool Execute(size_t proc, int32_t arg, Frame *link, int depth, int32_t &result);
+
+    Frame *FrameAt(Frame *frame, int32_t level) const;
+
+private:
+
+    // 求值的调用深度上限，避免耗尽编译器自身的栈
+    static constexpr int MAX_DEPTH = 10000;
+
+    const VarTable &vars_;
+    const ProcTable &procs_;
+    const FrameLayout layout_;
+    const uint64_t fuel_;
+
+    const IrProgram *program_;
+
+    // 过程在IrProgram中的位置
+    std::vector<size_t> functions_;
+
+    std::vector<bool> pure_;
+
+    // 纯函数的求值结果，以(过程, 实参)为键
+    std::unordered_map<uint64_t, int32_t> memo_;
+
+    // 燃料耗尽而放弃的调用
+    std::unordered_set<uint64_t> exhausted_;
+
+    uint64_t remaining_;
+
+    std::vector<FoldedCall> folded_;
+};
+
+// 以注释的形式列出折叠的调用，用于.ir文件的开头
+void PrintFoldedCalls(std::ostream &out, const std::vector<FoldedCall> &folded,
+                      const ProcTable &procs);
+
+#endif // PARTIALEVAL_H
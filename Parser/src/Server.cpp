@@ -0,0 +1,768 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Server.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    // 请求行和SOURCE、OPEN、EDIT请求正文的长度上限，超过时断开连接
+    constexpr size_t MAX_LINE_SIZE = 1 << 16;
+    constexpr size_t MAX_SOURCE_SIZE = size_t(1) << 30;
+
+    using Clock = std::chrono::steady_clock;
+
+    // 没有请求时连接最多保持的时间，以及收完一个请求或者发完一个回复最多允许的时间
+    constexpr Clock::duration IDLE_TIMEOUT = std::chrono::minutes(5);
+    constexpr Clock::duration TRANSFER_TIMEOUT = std::chrono::seconds(10);
+
+    // 客户端一侧的连接：阻塞地读写，带缓冲地读取，析构时关闭套接字
+    class Connection
+    {
+    public:
+
+        explicit Connection(int fd)
+            : fd_(fd), buf_(1 << 16), pos_(0), size_(0)
+        {
+
+        }
+
+        ~Connection(void)
+        {
+            close(fd_);
+        }
+
+        Connection(const Connection &) = delete;
+        Connection &operator=(const Connection &) = delete;
+
+        // 读入一行，不含'\n'；连接已关闭或者行太长时返回false
+        bool ReadLine(std::string &line)
+        {
+            line.clear();
+            for(;;)
+            {
+                const char *begin = buf_.data() + pos_;
+                const char *end = buf_.data() + size_;
+                const char *eol = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+                if(eol)
+                {
+                    line.append(begin, eol);
+                    pos_ = eol + 1 - buf_.data();
+                    return true;
+                }
+                line.append(begin, end);
+                if(line.size() > MAX_LINE_SIZE || !Fill())
+                    return false;
+            }
+        }
+
+        // 恰好读入size个字节，缓冲区之外的部分随到达逐块追加，不预先按size分配
+        bool Read(std::string &data, size_t size)
+        {
+            data.clear();
+            for(;;)
+            {
+                const size_t got = std::min(size - data.size(), size_ - pos_);
+                data.append(buf_.data() + pos_, got);
+                pos_ += got;
+                if(data.size() == size)
+                    return true;
+                if(!Fill())
+                    return false;
+            }
+        }
+
+        // 对方已经断开时返回false，而不是产生SIGPIPE
+        bool Write(const std::string &data)
+        {
+            size_t sent = 0;
+            while(sent < data.size())
+            {
+                const ssize_t n = send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+                if(n < 0 && errno == EINTR)
+                    continue;
+                if(n <= 0)
+                    return false;
+                sent += static_cast<size_t>(n);
+            }
+            return true;
+        }
+
+    private:
+
+        bool Fill(void)
+        {
+            pos_ = size_ = 0;
+            for(;;)
+            {
+                const ssize_t n = recv(fd_, buf_.data(), buf_.size(), 0);
+                if(n < 0 && errno == EINTR)
+                    continue;
+                if(n <= 0)
+                    return false;
+                size_ = static_cast<size_t>(n);
+                return true;
+            }
+        }
+
+        int fd_;
+        std::vector<char> buf_;
+        size_t pos_;
+        size_t size_;
+    };
+
+    // 一个完整收到的请求
+    struct Request
+    {
+        enum class Kind
+        {
+            Path,
+            Source,
+            Open,
+            Edit,
+            Stop
+        };
+
+        Kind kind;
+        std::string arg; // PATH的路径，SOURCE、OPEN的源代码，或者EDIT替换成的内容
+        size_t offset = 0, length = 0; // EDIT替换的范围
+    };
+
+    // 服务一侧的连接，只由I/O线程读写；busy时其中的请求和回复属于正在处理它的工作线程
+    struct Session
+    {
+        int fd;
+        std::string in;                 // 已收到而尚未取出的字节
+        std::string out;                // 尚未发出的回复
+        size_t sent = 0;
+        bool eof = false;               // 对方已经关闭了写的一侧
+        bool busy = false;              // 有请求正在线程池中处理
+        bool closing = false;           // 回复发完后关闭，不再处理新的请求
+        Clock::time_point deadline;
+
+        Request request;
+        std::string reply;
+
+        // OPEN打开的文档，之后的EDIT在其上增量分析
+        std::unique_ptr<IncrementalParser> document;
+    };
+
+    enum class TakeResult
+    {
+        Incomplete,
+        Complete,
+        Invalid
+    };
+
+    void FormatReply(std::string &reply, int code, const std::string &payload)
+    {
+        reply = std::to_string(code);
+        reply += ' ';
+        reply += std::to_string(payload.size());
+        reply += '\n';
+        reply += payload;
+    }
+
+    bool StartsWith(const std::string &str, const char *prefix)
+    {
+        return str.compare(0, std::strlen(prefix), prefix) == 0;
+    }
+
+    // 从in的开头取出一个完整的请求；请求无效时error为应当回复的说明
+    TakeResult TakeRequest(std::string &in, Request &request, std::string &error)
+    {
+        const size_t eol = in.find('\n');
+        if(eol == std::string::npos)
+        {
+            if(in.size() <= MAX_LINE_SIZE)
+                return TakeResult::Incomplete;
+            error = "Request line too long\n";
+            return TakeResult::Invalid;
+        }
+
+        const std::string line = in.substr(0, eol);
+
+        // 带正文的请求：请求行中的各个数以一个空格分隔，最后一个为正文的字节数
+        struct BodyRequest
+        {
+            const char *prefix;
+            Request::Kind kind;
+            size_t count;
+        };
+        static const BodyRequest BODY_REQUESTS[] = {
+            { "SOURCE ", Request::Kind::Source, 1 },
+            { "OPEN ", Request::Kind::Open, 1 },
+            { "EDIT ", Request::Kind::Edit, 3 }
+        };
+        for(const BodyRequest &body : BODY_REQUESTS)
+        {
+            if(!StartsWith(line, body.prefix))
+                continue;
+            const size_t count = body.count;
+            size_t numbers[3];
+            const char *p = line.c_str() + std::strlen(body.prefix);
+            for(size_t i = 0; i < count; ++i)
+            {
+                if(*p < '0' || *p > '9')
+                    break;
+                char *end;
+                const unsigned long long value = std::strtoull(p, &end, 10);
+                if(value > MAX_SOURCE_SIZE || *end != (i + 1 < count ? ' ' : '\0'))
+                    break;
+                numbers[i] = static_cast<size_t>(value);
+                p = end + 1;
+                if(i + 1 == count)
+                {
+                    const size_t size = numbers[i];
+                    if(in.size() - eol - 1 < size)
+                        return TakeResult::Incomplete;
+                    request.kind = body.kind;
+                    request.offset = count == 3 ? numbers[0] : 0;
+                    request.length = count == 3 ? numbers[1] : 0;
+                    request.arg.assign(in, eol + 1, size);
+                    in.erase(0, eol + 1 + size);
+                    return TakeResult::Complete;
+                }
+            }
+            error = "Invalid request: " + line + "\n";
+            return TakeResult::Invalid;
+        }
+
+        if(StartsWith(line, "PATH "))
+        {
+            request.kind = Request::Kind::Path;
+            request.arg = line.substr(5);
+        }
+        else if(line == "STOP")
+            request.kind = Request::Kind::Stop;
+        else
+        {
+            error = "Unknown request: " + line + "\n";
+            return TakeResult::Invalid;
+        }
+        in.erase(0, eol + 1);
+        return TakeResult::Complete;
+    }
+
+    // 在工作线程中处理一个请求，document为发出请求的连接上打开的文档
+    void Handle(CompileWorker &w, const CompileOptions &options, const Request &request,
+                std::unique_ptr<IncrementalParser> &document, std::string &reply)
+    {
+        CompileResult result;
+        std::string payload;
+        if(request.kind == Request::Kind::Path)
+        {
+            CompileFile(w, request.arg, options, result);
+            payload.swap(result.log);
+            if(result.Succeeded())
+                payload += "Parsing succeeded\n";
+        }
+        else if(request.kind == Request::Kind::Open || request.kind == Request::Kind::Edit)
+        {
+            if(request.kind == Request::Kind::Open)
+                document.reset(new IncrementalParser(request.arg, "-"));
+            else if(!document)
+            {
+                FormatReply(reply, -1, "No document opened\n");
+                return;
+            }
+            else if(request.offset > document->GetSourceSize() ||
+                    request.length > document->GetSourceSize() - request.offset)
+            {
+                FormatReply(reply, -1, "Edit out of range\n");
+                return;
+            }
+            else
+                document->Apply(SourceEdit{ request.offset, request.length, request.arg });
+            CollectDocumentErrs(w, *document, result);
+            payload.swap(result.log);
+        }
+        else
+        {
+            CompileSource(w, request.arg.data(), request.arg.size(), options, result);
+            payload.swap(result.log);
+            payload += result.tables;
+        }
+        FormatReply(reply, result.Succeeded() ? 0 : -1, payload);
+    }
+
+    bool MakeAddress(const std::string &socketPath, sockaddr_un &addr)
+    {
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if(socketPath.size() >= sizeof(addr.sun_path))
+            return false;
+        std::memcpy(addr.sun_path, socketPath.c_str(), socketPath.size());
+        return true;
+    }
+
+    bool Connect(const sockaddr_un &addr, int &fd)
+    {
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(fd < 0)
+            return false;
+        if(connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0)
+            return true;
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    // 只删除上次服务留下的套接字：路径上是其他文件或者仍有服务在应答时拒绝启动
+    bool RemoveStaleSocket(const std::string &socketPath, const sockaddr_un &addr)
+    {
+        struct stat st;
+        if(lstat(socketPath.c_str(), &st) != 0)
+            return errno == ENOENT;
+        if(!S_ISSOCK(st.st_mode))
+        {
+            std::cout << "Not a socket: " << socketPath << std::endl;
+            return false;
+        }
+        int fd;
+        if(Connect(addr, fd))
+        {
+            close(fd);
+            std::cout << "Server already running on: " << socketPath << std::endl;
+            return false;
+        }
+        return unlink(socketPath.c_str()) == 0 || errno == ENOENT;
+    }
+
+    // 事件循环：由一个I/O线程完成接受连接和全部读写，只有收完整的请求才交给线程池，
+    // 因此空闲或者传输缓慢的连接不会占用工作线程
+    class EventLoop
+    {
+    public:
+
+        EventLoop(int listenFd, size_t threadCount, const CompileOptions &options)
+            : listenFd_(listenFd), acceptPaused_(false), options_(options),
+              pool_(threadCount), workers_(pool_.Size())
+        {
+
+        }
+
+        ~EventLoop(void)
+        {
+            // 正常结束时已经没有连接；poll出错而退出时须先等正在处理的请求完成
+            pool_.Wait();
+            for(Session &s : sessions_)
+                if(s.fd >= 0)
+                    close(s.fd);
+            if(listenFd_ >= 0)
+                close(listenFd_);
+            if(wakeFds_[0] >= 0)
+            {
+                close(wakeFds_[0]);
+                close(wakeFds_[1]);
+            }
+        }
+
+        size_t ThreadCount(void) const
+        {
+            return pool_.Size();
+        }
+
+        // 运行直到收到STOP并且全部连接都已关闭，返回是否因STOP而结束
+        bool Run(void);
+
+    private:
+
+        using Sessions = std::list<Session>;
+
+        void Accept(void);
+
+        void Receive(Session &s);
+
+        void Send(Session &s);
+
+        // 在没有请求正在处理、也没有回复待发时取出下一个请求
+        void Advance(Session &s);
+
+        void Stop(void);
+
+        void Close(Sessions::iterator it);
+
+        void CollectReplies(void);
+
+        int listenFd_;
+        bool acceptPaused_;
+        bool stopped_ = false;
+
+        // 工作线程完成请求后写入一个字节，唤醒poll
+        int wakeFds_[2] = { -1, -1 };
+
+        const CompileOptions &options_;
+        Sessions sessions_;
+
+        std::mutex doneMutex_;
+        std::vector<Session*> done_;
+
+        // 析构函数中已经等待全部请求完成，工作线程不会再使用workers_
+        ThreadPool pool_;
+        std::vector<CompileWorker> workers_;
+    };
+
+    bool EventLoop::Run(void)
+    {
+        if(pipe2(wakeFds_, O_CLOEXEC | O_NONBLOCK) != 0)
+            return false;
+
+        std::vector<pollfd> fds;
+        std::vector<Sessions::iterator> polled;
+        while(listenFd_ >= 0 || !sessions_.empty())
+        {
+            fds.clear();
+            polled.clear();
+            fds.push_back(pollfd{ wakeFds_[0], POLLIN, 0 });
+            const bool listening = listenFd_ >= 0 && !acceptPaused_;
+            if(listening)
+                fds.push_back(pollfd{ listenFd_, POLLIN, 0 });
+
+            const Clock::time_point now = Clock::now();
+            Clock::time_point wake = Clock::time_point::max();
+            for(auto it = sessions_.begin(); it != sessions_.end(); ++it)
+            {
+                // 正在处理的连接既不读也不写，也没有时限
+                if(it->busy)
+                    continue;
+                const short events = it->sent < it->out.size() ? POLLOUT : POLLIN;
+                fds.push_back(pollfd{ it->fd, events, 0 });
+                polled.push_back(it);
+                wake = std::min(wake, it->deadline);
+            }
+
+            int timeout = -1;
+            if(wake != Clock::time_point::max())
+            {
+                timeout = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    wake - now).count()) + 1;
+                timeout = std::max(timeout, 0);
+            }
+
+            if(poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR)
+                break;
+
+            if(fds[0].revents)
+                CollectReplies();
+            if(listening && fds[1].revents)
+                Accept();
+
+            const size_t first = fds.size() - polled.size();
+            for(size_t i = 0; i < polled.size(); ++i)
+            {
+                // 上面处理回复时可能已经关闭了连接，或者交出了下一个请求
+                Session &s = *polled[i];
+                if(s.busy || s.fd < 0)
+                    continue;
+                if(fds[first + i].revents & POLLOUT)
+                    Send(s);
+                else if(fds[first + i].revents)
+                    Receive(s);
+            }
+
+            // 处理收到的请求，再关闭已经结束或者超时的连接（STOP会结束排在它前面的连接）
+            for(Session &s : sessions_)
+                Advance(s);
+            const Clock::time_point later = Clock::now();
+            for(auto it = sessions_.begin(); it != sessions_.end(); )
+            {
+                auto next = std::next(it);
+                if(!it->busy && (it->fd < 0 || it->deadline <= later))
+                    Close(it);
+                it = next;
+            }
+        }
+        return stopped_;
+    }
+
+    void EventLoop::Accept(void)
+    {
+        for(;;)
+        {
+            const int fd = accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            if(fd < 0)
+            {
+                // 文件描述符用尽时暂停接受，直到有连接关闭
+                if(errno == EMFILE || errno == ENFILE)
+                    acceptPaused_ = true;
+                return;
+            }
+            sessions_.emplace_back();
+            Session &s = sessions_.back();
+            s.fd = fd;
+            s.deadline = Clock::now() + IDLE_TIMEOUT;
+        }
+    }
+
+    void EventLoop::Receive(Session &s)
+    {
+        char buf[1 << 16];
+        for(;;)
+        {
+            const ssize_t n = recv(s.fd, buf, sizeof(buf), 0);
+            if(n > 0)
+            {
+                // 一个请求的第一个字节到达后，须在时限内收完
+                if(s.in.empty())
+                    s.deadline = Clock::now() + TRANSFER_TIMEOUT;
+                s.in.append(buf, static_cast<size_t>(n));
+                if(s.in.size() > MAX_LINE_SIZE + MAX_SOURCE_SIZE)
+                    break;
+                continue;
+            }
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return;
+            break;
+        }
+        // 对方关闭或者出错；已经收完的请求仍然处理
+        s.eof = true;
+    }
+
+    void EventLoop::Send(Session &s)
+    {
+        while(s.sent < s.out.size())
+        {
+            const ssize_t n = send(s.fd, s.out.data() + s.sent, s.out.size() - s.sent, MSG_NOSIGNAL);
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return;
+            if(n <= 0)
+            {
+                s.out.clear();
+                s.sent = 0;
+                s.eof = s.closing = true;
+                return;
+            }
+            s.sent += static_cast<size_t>(n);
+        }
+        s.out.clear();
+        s.sent = 0;
+        s.deadline = Clock::now() + (s.in.empty() ? IDLE_TIMEOUT : TRANSFER_TIMEOUT);
+    }
+
+    void EventLoop::Advance(Session &s)
+    {
+        // 回复发完后接着处理已经收到的下一个请求
+        while(!s.busy && s.fd >= 0 && s.sent >= s.out.size())
+        {
+            if(s.closing)
+            {
+                close(s.fd);
+                s.fd = -1;
+                return;
+            }
+
+            std::string error;
+            switch(TakeRequest(s.in, s.request, error))
+            {
+            case TakeResult::Incomplete:
+                if(s.eof)
+                {
+                    close(s.fd);
+                    s.fd = -1;
+                }
+                return;
+
+            case TakeResult::Invalid:
+                FormatReply(s.out, -1, error);
+                s.closing = true;
+                break;
+
+            case TakeResult::Complete:
+                if(s.request.kind == Request::Kind::Stop)
+                {
+                    FormatReply(s.out, 0, "Server stopped\n");
+                    s.closing = true;
+                    Stop();
+                    break;
+                }
+                s.busy = true;
+                pool_.Submit([this, &s]
+                {
+                    Handle(workers_[pool_.CurrentWorker()], options_, s.request, s.document, s.reply);
+                    {
+                        std::lock_guard<std::mutex> lk(doneMutex_);
+                        done_.push_back(&s);
+                    }
+                    const char byte = 0;
+                    if(write(wakeFds_[1], &byte, 1) < 0)
+                    {
+                        // 管道已满时poll已经会被唤醒
+                    }
+                });
+                return;
+            }
+
+            s.sent = 0;
+            s.deadline = Clock::now() + TRANSFER_TIMEOUT;
+            Send(s);
+        }
+    }
+
+    void EventLoop::Stop(void)
+    {
+        // 不再接受新的连接；正在处理的请求完成并发出回复后，各连接依次关闭
+        stopped_ = true;
+        close(listenFd_);
+        listenFd_ = -1;
+        for(Session &s : sessions_)
+        {
+            s.closing = true;
+            if(!s.busy && s.fd >= 0 && s.sent >= s.out.size())
+            {
+                close(s.fd);
+                s.fd = -1;
+            }
+        }
+    }
+
+    void EventLoop::Close(Sessions::iterator it)
+    {
+        if(it->fd >= 0)
+            close(it->fd);
+        sessions_.erase(it);
+        acceptPaused_ = false;
+    }
+
+    void EventLoop::CollectReplies(void)
+    {
+        char buf[256];
+        while(read(wakeFds_[0], buf, sizeof(buf)) > 0)
+        {
+
+        }
+
+        std::vector<Session*> done;
+        {
+            std::lock_guard<std::mutex> lk(doneMutex_);
+            done.swap(done_);
+        }
+        for(Session *s : done)
+        {
+            s->busy = false;
+            s->out.swap(s->reply);
+            s->reply.clear();
+            s->sent = 0;
+            s->deadline = Clock::now() + TRANSFER_TIMEOUT;
+            Send(*s);
+        }
+    }
+}
+
+int RunServer(const std::string &socketPath, size_t threadCount, const CompileOptions &options)
+{
+    sockaddr_un addr;
+    if(!MakeAddress(socketPath, addr))
+    {
+        std::cout << "Socket path too long: " << socketPath << std::endl;
+        return -1;
+    }
+    if(!RemoveStaleSocket(socketPath, addr))
+        return -1;
+
+    const int listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    struct stat st;
+    if(listenFd < 0 ||
+       bind(listenFd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+       listen(listenFd, SOMAXCONN) != 0 ||
+       lstat(socketPath.c_str(), &st) != 0)
+    {
+        std::cout << "Cannot listen on socket: " << socketPath << std::endl;
+        if(listenFd >= 0)
+            close(listenFd);
+        return -1;
+    }
+
+    bool stopped;
+    {
+        EventLoop loop(listenFd, threadCount, options);
+        std::cout << "Listening on " << socketPath << " with "
+                  << loop.ThreadCount() << " threads" << std::endl;
+        stopped = loop.Run();
+    }
+
+    // 路径上已经换成了其他文件时不删除
+    struct stat now;
+    if(lstat(socketPath.c_str(), &now) == 0 && now.st_ino == st.st_ino && now.st_dev == st.st_dev)
+        unlink(socketPath.c_str());
+    if(!stopped)
+    {
+        std::cout << "Failed to accept connections on: " << socketPath << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int RunClient(const std::string &socketPath, const std::vector<std::string> &args)
+{
+    // 先备好全部请求（包括读完标准输入），连接之后不再等待用户
+    std::vector<std::string> requests;
+    for(const std::string &arg : args)
+    {
+        if(arg == "-")
+        {
+            const std::string source((std::istreambuf_iterator<char>(std::cin)),
+                                     std::istreambuf_iterator<char>());
+            requests.push_back("SOURCE " + std::to_string(source.size()) + "\n" + source);
+        }
+        else if(arg == "-stop")
+            requests.push_back("STOP\n");
+        else
+        {
+            // 服务的工作目录与客户端不同
+            std::error_code ec;
+            const std::filesystem::path path = std::filesystem::absolute(arg, ec);
+            requests.push_back("PATH " + (ec ? arg : path.string()) + "\n");
+        }
+    }
+
+    sockaddr_un addr;
+    int fd = -1;
+    if(!MakeAddress(socketPath, addr) || !Connect(addr, fd))
+    {
+        std::cout << "Cannot connect to server: " << socketPath << std::endl;
+        return -1;
+    }
+
+    Connection conn(fd);
+    std::string line, payload;
+    int exitCode = 0;
+    for(const std::string &request : requests)
+    {
+        int code;
+        size_t size;
+        if(!conn.Write(request) || !conn.ReadLine(line) ||
+           std::sscanf(line.c_str(), "%d %zu", &code, &size) != 2 ||
+           !conn.Read(payload, size))
+        {
+            std::cout << "Lost connection to server: " << socketPath << std::endl;
+            return -1;
+        }
+
+        std::cout.write(payload.data(), payload.size());
+        if(!exitCode)
+            exitCode = code;
+    }
+    std::cout.flush();
+    return exitCode;
+}
@@ -0,0 +1,33 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <string>
+#include <vector>
+
+#include "Compile.h"
+
+// 常驻的编译服务：在本地Unix域套接字上接受请求，由常驻线程池中的CompileWorker分析，
+// 分析器的各种缓冲区在请求之间复用，省去进程启动和内存分配的开销
+//
+// 一个连接上可以依次发送多个请求，每个请求之后是一个回复：
+//   PATH <文件路径>\n        分析文件并写出各输出文件，与命令行分析单个文件相同
+//   SOURCE <字节数>\n<源代码> 分析随请求发送的源代码，不读写任何文件
+//   OPEN <字节数>\n<源代码>   在这个连接上打开一个文档，供之后的EDIT增量分析（见Incremental.h）
+//   EDIT <偏移> <长度> <字节数>\n<内容>
+//                            用内容替换文档中[偏移, 偏移 + 长度)的部分
+//   STOP\n                   停止服务
+// 回复为"<退出码> <字节数>\n<内容>"，退出码与命令行相同（成功为0，失败为-1）；
+// PATH的内容为命令行输出到控制台的内容，SOURCE的内容为错误信息，或者成功时的变量表和过程表，
+// OPEN和EDIT的内容为文档当前的错误信息
+// 一个I/O线程负责接受连接和全部读写，收完整的请求才交给工作线程，线程数只限制同时分析的请求数；
+// 连接空闲超过5分钟，或者一个请求的收取、一个回复的发送超过10秒时断开
+
+// 在socketPath上提供服务直到收到STOP，threadCount为0时使用硬件线程数
+// socketPath上是上次服务没有正常退出时留下的套接字时先删除；是其他文件或者仍有服务在应答时拒绝启动
+int RunServer(const std::string &socketPath, size_t threadCount, const CompileOptions &options);
+
+// 代替命令行把args逐个发给服务：文件路径转换为绝对路径后以PATH发送，"-"表示以SOURCE发送标准输入，
+// "-stop"表示停止服务；读完标准输入之后才连接，依次输出各回复的内容，返回第一个不为0的退出码
+int RunClient(const std::string &socketPath, const std::vector<std::string> &args);
+
+#endif // SERVER_H
@@ -0,0 +1,99 @@
+#include <algorithm>
+
+#include "CharScan.h"
+#include "SymbolTable.h"
+
+namespace
+{
+    constexpr size_t INITIAL_BUCKET_COUNT = 64;
+}
+
+SymbolTable::SymbolTable(void)
+    : buckets_(INITIAL_BUCKET_COUNT, NIL)
+{
+
+}
+
+void SymbolTable::Clear(void)
+{
+    symbols_.clear();
+    names_.clear();
+    scopes_.clear();
+    std::fill(buckets_.begin(), buckets_.end(), NIL);
+}
+
+void SymbolTable::EnterScope(void)
+{
+    scopes_.push_back(static_cast<uint32_t>(symbols_.size()));
+}
+
+void SymbolTable::LeaveScope(void)
+{
+    if(scopes_.empty())
+        return;
+
+    const size_t mask = buckets_.size() - 1;
+    while(symbols_.size() > scopes_.back())
+    {
+        const Symbol &s = symbols_.back();
+        buckets_[s.hash & mask] = s.next;
+        symbols_.pop_back();
+    }
+    names_.resize(symbols_.size());
+    scopes_.pop_back();
+}
+
+void SymbolTable::Define(const Name &name, size_t value)
+{
+    // 负载因子不超过1，保证链的平均长度为常数
+    if(symbols_.size() >= buckets_.size())
+        Rehash(buckets_.size() * 2);
+
+    const uint32_t hash = name.Hash();
+    uint32_t &head = buckets_[hash & (buckets_.size() - 1)];
+    symbols_.push_back(Symbol{ hash, head, value });
+    names_.push_back(name);
+    head = static_cast<uint32_t>(symbols_.size() - 1);
+}
+
+size_t SymbolTable::Find(const Name &name) const
+{
+    const uint32_t i = Lookup(name, 0);
+    return i == NIL ? NONE : symbols_[i].value;
+}
+
+bool SymbolTable::DefinedInScope(const Name &name) const
+{
+    const uint32_t first = scopes_.empty() ? 0 : scopes_.back();
+    const size_t count = names_.size() - first;
+    if(count <= SMALL_SCOPE_SIZE)
+        return FindLastName(names_.data() + first, count, name) != count;
+    return Lookup(name, first) != NIL;
+}
+
+uint32_t SymbolTable::Lookup(const Name &name, uint32_t first) const
+{
+    const uint32_t hash = name.Hash();
+
+    // 链中的符号按定义的先后逆序排列，越过first后就不必再找了
+    for(uint32_t i = buckets_[hash & (buckets_.size() - 1)];
+        i != NIL && i >= first; i = symbols_[i].next)
+    {
+        if(symbols_[i].hash == hash && names_[i] == name)
+            return i;
+    }
+    return NIL;
+}
+
+void SymbolTable::Rehash(size_t bucketCount)
+{
+    // 按定义顺序依次插到链首，重建后每条链仍是逆序的
+    buckets_.assign(bucketCount, NIL);
+    const size_t mask = bucketCount - 1;
+    for(size_t i = 0; i < symbols_.size(); ++i)
+    {
+        Symbol &s = symbols_[i];
+        s.next = buckets_[s.hash & mask];
+        buckets_[s.hash & mask] = static_cast<uint32_t>(i);
+    }
+}
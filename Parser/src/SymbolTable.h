@@ -0,0 +1,73 @@
+#ifndef SYMBOLTABLE_H
+#define SYMBOLTABLE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Name.h"
+
+// 分层作用域的符号表，把名字映射到其在VarTable/ProcTable中的位置
+// 所有可见的符号按定义顺序存放在一个栈中，并按名字的哈希值串成链，
+// 新定义的符号总在链首，因此查找时遇到的第一个同名符号就是最内层的那个，
+// 离开作用域时被弹出的符号也总在各自链首，可以逐个直接摘下
+// 查找为O(1)，进入作用域为O(1)，离开作用域的代价均摊到该作用域中的每次定义上
+// 名字另外按定义顺序存成一列，较小的作用域内直接对这一列做SIMD查找，不必计算哈希
+class SymbolTable
+{
+public:
+
+    static constexpr size_t NONE = SIZE_MAX;
+
+    SymbolTable(void);
+
+    // 清空全部符号和作用域，保留已分配的空间
+    void Clear(void);
+
+    void EnterScope(void);
+
+    // 弹出当前作用域中定义的所有符号，不存在作用域时不做任何事
+    void LeaveScope(void);
+
+    // 在当前作用域中定义name，遮蔽外层的同名符号
+    void Define(const Name &name, size_t value);
+
+    // 由内向外查找name，返回最内层同名符号的值，未找到时返回NONE
+    size_t Find(const Name &name) const;
+
+    // name是否已在当前作用域中定义
+    bool DefinedInScope(const Name &name) const;
+
+private:
+
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    // 不超过该大小的作用域直接在名字列上查找
+    static constexpr size_t SMALL_SCOPE_SIZE = 64;
+
+    struct Symbol
+    {
+        uint32_t hash;
+        uint32_t next; // 同一链中的下一个（即更早定义的）符号
+        size_t value;
+    };
+
+    // 链中第一个与name同名的符号，不早于first，未找到时返回NIL
+    uint32_t Lookup(const Name &name, uint32_t first) const;
+
+    void Rehash(size_t bucketCount);
+
+private:
+
+    std::vector<Symbol> symbols_;
+
+    // 与symbols_一一对应
+    std::vector<Name> names_;
+
+    // 各层作用域中第一个符号的位置
+    std::vector<uint32_t> scopes_;
+
+    // 桶的个数总是2的幂，每个桶存放链首符号的位置
+    std::vector<uint32_t> buckets_;
+};
+
+#endif // SYMBOLTABLE_H
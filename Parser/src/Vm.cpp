@@ -0,0 +1,232 @@
+#include <algorithm>
+
+#include "Vm.h"
+
+// 取标号地址（&&label）是GCC和Clang的扩展，其他编译器使用switch；
+// 也可以用-DVM_COMPUTED_GOTO=0强制使用switch，用来检查两种分派方式的结果是否相同
+#ifndef VM_COMPUTED_GOTO
+    #if defined(__GNUC__)
+        #define VM_COMPUTED_GOTO 1
+    #else
+        #define VM_COMPUTED_GOTO 0
+    #endif
+#endif
+
+namespace
+{
+    // 整数运算按32位补码回绕，避免有符号溢出
+    inline int32_t WrapSub(int32_t a, int32_t b)
+    {
+        return static_cast<int32_t>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b));
+    }
+
+    inline int32_t WrapMul(int32_t a, int32_t b)
+    {
+        return static_cast<int32_t>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b));
+    }
+}
+
+Vm::Vm(size_t frameStackSize, size_t operandStackSize, size_t callStackSize)
+    : frames_(frameStackSize), operands_(operandStackSize), calls_(callStackSize),
+      instructionCount_(0)
+{
+
+}
+
+bool Vm::Run(const Bytecode &code, std::istream &in, std::ostream &out)
+{
+    error_.clear();
+    display_.assign(code.maxLevel + 1, nullptr);
+
+    if(static_cast<size_t>(code.mainFrameSize) > frames_.size() ||
+       static_cast<size_t>(code.mainMaxStack) > operands_.size())
+    {
+        error_ = "stack overflow";
+        return false;
+    }
+
+    const int32_t *const base = code.code.data();
+    const BytecodeProc *const procs = code.procs.data();
+    int32_t **const display = display_.data();
+
+    const int32_t *pc = base;
+    int32_t *sp = operands_.data();
+    int32_t *fp = frames_.data();
+    int32_t *frameTop = fp + code.mainFrameSize;
+    CallRecord *call = calls_.data();
+
+    int32_t *const operandEnd = operands_.data() + operands_.size();
+    int32_t *const frameEnd = frames_.data() + frames_.size();
+    CallRecord *const callEnd = calls_.data() + calls_.size();
+
+    std::fill(fp, frameTop, 0);
+    display[1] = fp;
+
+    uint64_t count = 0;
+    bool ok = true;
+
+#if VM_COMPUTED_GOTO
+    // 与Op中的顺序一致
+    static void *const LABELS[] =
+    {
+        &&L_Push, &&L_LoadLocal, &&L_StoreLocal, &&L_Load, &&L_Store,
+        &&L_Sub, &&L_Mul,
+        &&L_JumpLess, &&L_JumpLessEqual, &&L_JumpEqual,
+        &&L_JumpGreaterEqual, &&L_JumpGreater, &&L_JumpNotEqual,
+        &&L_Jump, &&L_Call, &&L_Ret, &&L_Read, &&L_Write, &&L_Halt
+    };
+    static_assert(sizeof(LABELS) / sizeof(LABELS[0]) == static_cast<size_t>(Op::OP_COUNT),
+                  "LABELS must match Op");
+
+    #define CASE(op) L_##op:
+    #define NEXT() do { ++count; goto *LABELS[*pc]; } while(0)
+
+    NEXT();
+    {
+#else
+    #define CASE(op) case Op::op:
+    #define NEXT() do { ++count; goto dispatch; } while(0)
+
+    NEXT();
+dispatch:
+    switch(static_cast<Op>(*pc))
+    {
+#endif
+
+    CASE(Push)
+        *sp++ = pc[1];
+        pc += 2;
+        NEXT();
+
+    CASE(LoadLocal)
+        *sp++ = fp[pc[1]];
+        pc += 2;
+        NEXT();
+
+    CASE(StoreLocal)
+        fp[pc[1]] = *--sp;
+        pc += 2;
+        NEXT();
+
+    CASE(Load)
+        *sp++ = display[pc[1]][pc[2]];
+        pc += 3;
+        NEXT();
+
+    CASE(Store)
+        display[pc[1]][pc[2]] = *--sp;
+        pc += 3;
+        NEXT();
+
+    CASE(Sub)
+        --sp;
+        sp[-1] = WrapSub(sp[-1], sp[0]);
+        ++pc;
+        NEXT();
+
+    CASE(Mul)
+        --sp;
+        sp[-1] = WrapMul(sp[-1], sp[0]);
+        ++pc;
+        NEXT();
+
+    #define JUMP_IF(cond)                           \
+        sp -= 2;                                    \
+        pc = (cond) ? base + pc[1] : pc + 2;        \
+        NEXT();
+
+    CASE(JumpLess)         JUMP_IF(sp[0] <  sp[1])
+    CASE(JumpLessEqual)    JUMP_IF(sp[0] <= sp[1])
+    CASE(JumpEqual)        JUMP_IF(sp[0] == sp[1])
+    CASE(JumpGreaterEqual) JUMP_IF(sp[0] >= sp[1])
+    CASE(JumpGreater)      JUMP_IF(sp[0] >  sp[1])
+    CASE(JumpNotEqual)     JUMP_IF(sp[0] != sp[1])
+
+    #undef JUMP_IF
+
+    CASE(Jump)
+        pc = base + pc[1];
+        NEXT();
+
+    CASE(Call)
+    {
+        const BytecodeProc &p = procs[pc[1]];
+        if(frameEnd - frameTop < p.frameSize ||
+           operandEnd - sp < p.maxStack ||
+           call == callEnd)
+        {
+            error_ = "stack overflow";
+            ok = false;
+            goto halt;
+        }
+
+        const int32_t arg = *--sp;
+        *call++ = CallRecord{ pc + 2, fp, display[p.level], p.level };
+
+        fp = frameTop;
+        frameTop += p.frameSize;
+        std::fill(fp, frameTop, 0);
+        if(p.paramSlot >= 0)
+            fp[p.paramSlot] = arg;
+        display[p.level] = fp;
+
+        pc = base + p.entry;
+        NEXT();
+    }
+
+    CASE(Ret)
+    {
+        const CallRecord &r = *--call;
+        *sp++ = fp[0];
+        frameTop = fp;
+        display[r.level] = r.savedDisplay;
+        fp = r.frame;
+        pc = r.ret;
+        NEXT();
+    }
+
+    CASE(Read)
+    {
+        int32_t value;
+        if(!(in >> value))
+        {
+            error_ = "integer expected on input";
+            ok = false;
+            goto halt;
+        }
+        *sp++ = value;
+        ++pc;
+        NEXT();
+    }
+
+    CASE(Write)
+        out << *--sp << '\n';
+        ++pc;
+        NEXT();
+
+    CASE(Halt)
+        goto halt;
+
+#if !VM_COMPUTED_GOTO
+    default:
+        goto halt;
+#endif
+    }
+
+    #undef CASE
+    #undef NEXT
+
+halt:
+    instructionCount_ = count;
+    return ok;
+}
+
+const std::string &Vm::GetError(void) const
+{
+    return error_;
+}
+
+uint64_t Vm::GetInstructionCount(void) const
+{
+    return instructionCount_;
+}
@@ -0,0 +1,62 @@
+#ifndef VM_H
+#define VM_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Bytecode.h"
+
+// 执行字节码的栈式虚拟机
+// 活动记录、操作数和调用记录各自存放在预先分配好的栈中，执行过程中不再分配内存，
+// 只在调用时检查一次剩余空间是否足够被调用的过程使用
+// 支持GNU扩展的编译器上以computed goto分派指令，其他编译器上使用switch
+class Vm
+{
+public:
+
+    // 各个栈的默认容量，以元素个数计
+    static constexpr size_t DEFAULT_FRAME_STACK_SIZE = 1 << 22;
+    static constexpr size_t DEFAULT_OPERAND_STACK_SIZE = 1 << 20;
+    static constexpr size_t DEFAULT_CALL_STACK_SIZE = 1 << 20;
+
+    Vm(size_t frameStackSize = DEFAULT_FRAME_STACK_SIZE,
+       size_t operandStackSize = DEFAULT_OPERAND_STACK_SIZE,
+       size_t callStackSize = DEFAULT_CALL_STACK_SIZE);
+
+    Vm(const Vm &) = delete;
+    Vm &operator=(const Vm &) = delete;
+
+    // 从头执行code，read从in读入，write输出到out
+    // 出现运行时错误时返回false，错误信息由GetError取得
+    bool Run(const Bytecode &code, std::istream &in, std::ostream &out);
+
+    const std::string &GetError(void) const;
+
+    // 上一次Run执行的指令条数
+    uint64_t GetInstructionCount(void) const;
+
+private:
+
+    struct CallRecord
+    {
+        const int32_t *ret;
+        int32_t *frame;
+        int32_t *savedDisplay; // 被调用过程所在层次上原先的活动记录
+        int32_t level;
+    };
+
+    std::vector<int32_t> frames_;
+    std::vector<int32_t> operands_;
+    std::vector<CallRecord> calls_;
+
+    // 各层次上最近的活动记录
+    std::vector<int32_t*> display_;
+
+    std::string error_;
+    uint64_t instructionCount_;
+};
+
+#endif // VM_H
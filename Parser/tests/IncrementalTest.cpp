@@ -0,0 +1,237 @@
+// 增量分析的测试
+// inctest 源文件...：在各个程序和一个生成的程序上做随机的编辑，每次编辑之后都与重新进行的完整分析比较
+//                    词法单元、行号、词法错误、语法错误、变量表和过程表
+// inctest -bench：在不同长度的生成程序中间的函数体中反复编辑，报告完整分析、第一次编辑和其后各次编辑的耗时
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Incremental.h"
+#include "SourceFile.h"
+
+namespace
+{
+
+// n个互相独立的函数，每隔几个带一个嵌套的函数
+std::string Generate(int n)
+{
+    std::string src = "begin\ninteger k;\n";
+    for(int i = 0; i < n; ++i)
+    {
+        const std::string f = "F" + std::to_string(i);
+        src += "integer function " + f + "(n);\nbegin\ninteger n;\n";
+        if(i % 4 == 0)
+        {
+            src += "integer function G(m);\nbegin\ninteger m;\nG:=m*n\nend;\n";
+            src += f + ":=G(n)-k\nend;\n";
+        }
+        else
+            src += "if n<=0 then " + f + ":=1 else " + f + ":=n*" + f + "(n-1)\nend;\n";
+    }
+    src += "read(k);\nk:=F0(k);\nwrite(k)\nend\n";
+    return src;
+}
+
+// 比较增量分析的结果与重新进行的完整分析，返回第一处不同的说明，相同时返回空串
+std::string Compare(const IncrementalParser &inc, const std::string &src)
+{
+    std::string padded = src;
+    padded.append(SourceFile::PADDING, '\0');
+    std::vector<TokenizerError> lexErrs;
+    const Tokenizer::TokenStream toks = Tokenizer(padded.data(), src.size(), "test.pas").Tokenize(lexErrs);
+    Parser parser(toks, "test.pas");
+    parser.Parse();
+
+    if(inc.GetSource() != src)
+        return "source";
+    if(inc.TokenCount() != toks.Size())
+        return "token count";
+    for(size_t i = 0; i < toks.Size(); ++i)
+    {
+        const IncrementalParser::Token t = inc.GetToken(i);
+        if(t.type != toks.Type(i) || t.offset != toks.Offset(i) || t.length != toks.Length(i) ||
+           t.value != toks.Value(i) || inc.LineAt(t.offset) != toks.Line(i))
+            return "token " + std::to_string(i);
+    }
+    if(inc.LineCount() != toks.LineStarts().size())
+        return "line count";
+
+    const std::vector<TokenizerError> incLexErrs = inc.GetLexErrs();
+    if(incLexErrs.size() != lexErrs.size())
+        return "lexical error count";
+    for(size_t i = 0; i < lexErrs.size(); ++i)
+    {
+        const TokenizerError &x = incLexErrs[i], &y = lexErrs[i];
+        if(x.code != y.code || x.line != y.line || x.offset != y.offset || x.length != y.length ||
+           inc.LexErrMessage(x) != y.Message(padded.data()))
+            return "lexical error " + std::to_string(i);
+    }
+
+    const Parser::Errs incErrs = inc.GetErrs();
+    if(incErrs.size() != parser.GetErrs().size())
+        return "syntax error count";
+    for(size_t i = 0; i < incErrs.size(); ++i)
+    {
+        const ParserError &x = incErrs[i], &y = parser.GetErrs()[i];
+        if(x.line != y.line || x.offset != y.offset || x.msg != y.msg)
+            return "syntax error " + std::to_string(i);
+    }
+
+    const VarTable &vars = parser.GetVars();
+    if(inc.GetVars().size() != vars.size())
+        return "var count";
+    for(size_t i = 0; i < vars.size(); ++i)
+    {
+        const Var &x = inc.GetVars()[i], &y = vars[i];
+        if(x.name != y.name || x.proc != y.proc || x.kind != y.kind || x.type != y.type ||
+           x.level != y.level || x.posInTable != y.posInTable)
+            return "var " + std::to_string(i);
+    }
+    const ProcTable &procs = parser.GetProcs();
+    if(inc.GetProcs().size() != procs.size())
+        return "proc count";
+    for(size_t i = 0; i < procs.size(); ++i)
+    {
+        const Proc &x = inc.GetProcs()[i], &y = procs[i];
+        if(x.name != y.name || x.returnType != y.returnType || x.level != y.level ||
+           x.varPosBegin != y.varPosBegin || x.varPosEnd != y.varPosEnd)
+            return "proc " + std::to_string(i);
+    }
+    return std::string();
+}
+
+// 随机的编辑：一半是任意位置的任意片段，多半会改变结构而退回完整的分析；
+// 另一半只改动数字、空白、换行或者引入词法错误，应当能够增量完成；源代码为空时只能插入
+SourceEdit RandomEdit(const std::string &src, std::mt19937 &rng)
+{
+    static const char *const PIECES[] = {
+        "a", "1", "n", "\n", " ", ";", "k", "begin", "end", "x:=1;", "0", "#", "F0(", "integer q;",
+        "(", ")", "*", "-", "<=", "integer function Q(z);\nbegin\ninteger z;\nz:=z\nend;\n"
+    };
+    SourceEdit e;
+    if(src.empty() || rng() % 2)
+    {
+        e.offset = rng() % (src.size() + 1);
+        e.length = rng() % 3 == 0 ? std::min<size_t>(rng() % 4, src.size() - e.offset) : 0;
+        e.text = rng() % 4 == 0 ? "" : PIECES[rng() % (sizeof(PIECES) / sizeof(PIECES[0]))];
+        return e;
+    }
+    for(int tries = 0; tries < 100; ++tries)
+    {
+        e.offset = rng() % src.size();
+        const char c = src[e.offset];
+        if(c >= '0' && c <= '9')
+        {
+            e.length = 1;
+            e.text = std::string(1, static_cast<char>('1' + rng() % 9));
+            return e;
+        }
+        if(c == ' ' || c == '\n')
+        {
+            static const char *const SPACES[] = { "\n", "  ", "\n\n", "#", "" };
+            e.length = rng() % 2;
+            e.text = SPACES[rng() % 5];
+            return e;
+        }
+    }
+    e.offset = src.size();
+    e.length = 0;
+    e.text = "\n";
+    return e;
+}
+
+// 编辑累积下来多半会留下语法错误，使其后的编辑都退回完整的分析，因此每隔一段把整个源代码换回原样
+bool Check(const std::string &name, const std::string &original, int edits, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::string src = original;
+    IncrementalParser inc(src, "test.pas");
+    std::string diff = Compare(inc, src);
+    int incremental = 0;
+    for(int i = 0; i < edits && diff.empty(); ++i)
+    {
+        const SourceEdit e = i % 20 == 19 ? SourceEdit{ 0, src.size(), original } : RandomEdit(src, rng);
+        incremental += inc.Apply(e);
+        src.replace(e.offset, e.length, e.text);
+        diff = Compare(inc, src);
+        if(!diff.empty())
+        {
+            std::printf("FAIL %s: edit %d (offset %zu, length %zu, text \"%s\"): %s differs\n",
+                        name.c_str(), i, e.offset, e.length, e.text.c_str(), diff.c_str());
+        }
+    }
+    if(!diff.empty())
+        return false;
+    if(incremental == 0)
+    {
+        std::printf("FAIL %s: no edit was applied incrementally\n", name.c_str());
+        return false;
+    }
+    return true;
+}
+
+int Bench(void)
+{
+    for(int lines : { 10000, 100000, 1000000 })
+    {
+        // 每个函数5到10行，平均约6行
+        const std::string src = Generate(lines / 6);
+        const auto start = std::chrono::steady_clock::now();
+        IncrementalParser inc(src, "bench.pas");
+        const double full = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+
+        // 中间一个函数的"n<=0"中的0，交替改为1和0
+        const size_t pos = src.find("n<=0", src.size() / 2) + 3;
+        std::vector<double> times;
+        bool incremental = true;
+        for(int i = 0; i < 200; ++i)
+        {
+            const auto begin = std::chrono::steady_clock::now();
+            incremental = inc.Apply(SourceEdit{ pos, 1, i % 2 ? "0" : "1" }) && incremental;
+            times.push_back(std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - begin).count());
+        }
+        // 第一次编辑要把各个间隙从末尾移到编辑处，单独报告
+        const double first = times.front();
+        std::sort(times.begin() + 1, times.end());
+        std::printf("%7zu lines: full parse %.1f ms; edit: first %.3f ms, then median %.4f ms, max %.4f ms%s\n",
+                    inc.LineCount(), full, first, times[times.size() / 2], times.back(),
+                    incremental ? "" : " (fell back to full parse)");
+    }
+    return 0;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    if(argc > 1 && std::string(argv[1]) == "-bench")
+        return Bench();
+
+    bool ok = true;
+    unsigned seed = 1;
+    for(int i = 1; i < argc; ++i)
+    {
+        std::ifstream in(argv[i], std::ios::binary);
+        std::stringstream ss;
+        if(!in || !(ss << in.rdbuf()) || ss.str().empty())
+        {
+            std::printf("FAIL %s: cannot read the file or it is empty\n", argv[i]);
+            ok = false;
+            continue;
+        }
+        ok = Check(argv[i], ss.str(), 2000, seed++) && ok;
+    }
+    ok = Check("generated", Generate(40), 2000, seed) && ok;
+    if(ok)
+        std::printf("incremental: all tests passed\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+// IR及其优化遍的测试
+// irtest 源文件 < 输入：把程序翻译成IR，在IR上解释执行，再依次执行各个优化遍（与OptimizeIr的顺序相同，
+// 含部分求值），每一遍之后重新执行，输出和运行时错误都必须与未优化的IR相同
+// 输出未优化的IR的执行结果，格式与-run相同（运行时错误输出***RUNTIME一行，退出码为255），
+// 因此可以与tests/run中期望的输出比较；分析出错或者某一遍改变了结果时退出码为1
+
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Ir.h"
+#include "IrOpt.h"
+#include "PartialEval.h"
+#include "SourceFile.h"
+#include "Tokenizer.h"
+
+namespace
+{
+
+// 在IR上执行程序，活动记录以静态链相连，与字节码的语义相同
+class IrInterpreter
+{
+public:
+
+    IrInterpreter(const IrProgram &program, const VarTable &vars, const ProcTable &procs)
+        : program_(program), vars_(vars), layout_(vars, procs), functions_(procs.size(), 0)
+    {
+        for(size_t i = 0; i < program.functions.size(); ++i)
+        {
+            if(program.functions[i].proc < procs.size())
+                functions_[program.functions[i].proc] = i;
+        }
+    }
+
+    // 返回是否正常结束，输出写入out，出错时error为错误信息
+    bool Run(const std::string &input, std::string &out, std::string &error)
+    {
+        std::istringstream in(input);
+        std::ostringstream written;
+        in_ = &in;
+        out_ = &written;
+        error_.clear();
+        int32_t result;
+        const bool ok = Execute(program_.functions[0], 0, nullptr, 0, result);
+        out = written.str();
+        error = error_;
+        return ok;
+    }
+
+private:
+
+    struct Frame
+    {
+        std::vector<int32_t> vars;
+        Frame *link;
+        int32_t level;
+    };
+
+    // 调用深度的上限，超出时与虚拟机一样报告栈溢出
+    static constexpr int MAX_DEPTH = 20000;
+
+    bool Execute(const IrFunction &function, int32_t arg, Frame *link, int depth, int32_t &result)
+    {
+        if(depth >= MAX_DEPTH)
+        {
+            error_ = "stack overflow";
+            return false;
+        }
+
+        Frame frame{ std::vector<int32_t>(layout_.FrameSize(function.proc), 0), link,
+                     layout_.Level(function.proc) };
+        std::vector<int32_t> values(function.valueCount, 0);
+
+        int32_t block = 0, prev = -1;
+        for(;;)
+        {
+            int32_t next = -1;
+            for(const IrInst &inst : function.blocks[block].insts)
+            {
+                switch(inst.op)
+                {
+                case IrOp::Const:
+                    values[inst.dest] = inst.imm;
+                    break;
+                case IrOp::Param:
+                    values[inst.dest] = arg;
+                    break;
+                case IrOp::Load:
+                    values[inst.dest] = FrameAt(&frame, vars_[inst.imm].level)->vars[layout_.Slot(inst.imm)];
+                    break;
+                case IrOp::Store:
+                    FrameAt(&frame, vars_[inst.imm].level)->vars[layout_.Slot(inst.imm)] = values[inst.a];
+                    break;
+                case IrOp::Copy:
+                    values[inst.dest] = values[inst.a];
+                    break;
+                case IrOp::Sub:
+                    values[inst.dest] = IrSub(values[inst.a], values[inst.b]);
+                    break;
+                case IrOp::Mul:
+                    values[inst.dest] = IrMul(values[inst.a], values[inst.b]);
+                    break;
+                case IrOp::Phi:
+                    values[inst.dest] = prev == function.blocks[block].preds[0] ?
+                                        values[inst.a] : values[inst.b];
+                    break;
+                case IrOp::Call:
+                    if(!Execute(program_.functions[functions_[inst.imm]], values[inst.a],
+                                FrameAt(&frame, layout_.Level(inst.imm) - 1), depth + 1,
+                                values[inst.dest]))
+                        return false;
+                    break;
+                case IrOp::Read:
+                    if(!(*in_ >> values[inst.dest]))
+                    {
+                        error_ = "integer expected on input";
+                        return false;
+                    }
+                    break;
+                case IrOp::Write:
+                    *out_ << values[inst.a] << '\n';
+                    break;
+                case IrOp::Branch:
+                    next = IrCompare(inst.cond, values[inst.a], values[inst.b]) ? inst.imm : inst.imm2;
+                    break;
+                case IrOp::Jump:
+                    next = inst.imm;
+                    break;
+                case IrOp::Ret:
+                    result = inst.a == NO_VALUE ? 0 : values[inst.a];
+                    return true;
+                case IrOp::Nop:
+                    break;
+                }
+            }
+            prev = block;
+            block = next;
+        }
+    }
+
+    static Frame *FrameAt(Frame *frame, int32_t level)
+    {
+        while(frame->level > level)
+            frame = frame->link;
+        return frame;
+    }
+
+private:
+
+    const IrProgram &program_;
+    const VarTable &vars_;
+    const FrameLayout layout_;
+
+    // 过程在IrProgram中的位置
+    std::vector<size_t> functions_;
+
+    std::istream *in_;
+    std::ostream *out_;
+    std::string error_;
+};
+
+void ForEach(IrProgram &program, void (*pass)(IrFunction&))
+{
+    for(IrFunction &function : program.functions)
+        pass(function);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    if(argc != 2)
+    {
+        std::printf("Usage: irtest filename < input\n");
+        return 1;
+    }
+
+    SourceFile src;
+    if(!src.Open(argv[1]))
+    {
+        std::printf("Cannot open file: %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<TokenizerError> lexErrs;
+    const Tokenizer::TokenStream toks = Tokenizer(src.Data(), src.Size(), argv[1]).Tokenize(lexErrs);
+    Parser parser(toks, argv[1]);
+    parser.Parse(true);
+    if(!lexErrs.empty() || !parser.GetErrs().empty())
+    {
+        std::printf("%s: the program has errors\n", argv[1]);
+        return 1;
+    }
+    const VarTable &vars = parser.GetVars();
+    const ProcTable &procs = parser.GetProcs();
+
+    std::stringstream input;
+    input << std::cin.rdbuf();
+
+    IrProgram ir = IrBuilder(parser.GetAst(), vars, procs).Build();
+    std::string expected, expectedError;
+    const bool expectedOk = IrInterpreter(ir, vars, procs).Run(input.str(), expected, expectedError);
+
+    // 与OptimizeIr相同的顺序
+    PartialEvaluator evaluator(vars, procs);
+    const struct
+    {
+        const char *name;
+        void (*pass)(IrProgram &program, PartialEvaluator &evaluator);
+    } PASSES[] = {
+        { "copy propagation", [](IrProgram &p, PartialEvaluator &) { ForEach(p, PropagateCopies); } },
+        { "constant propagation", [](IrProgram &p, PartialEvaluator &) { ForEach(p, PropagateConstants); } },
+        { "partial evaluation", [](IrProgram &p, PartialEvaluator &e) { e.Run(p); } },
+        { "common subexpression elimination",
+          [](IrProgram &p, PartialEvaluator &) { ForEach(p, EliminateCommonSubexpressions); } },
+        { "dead code elimination", [](IrProgram &p, PartialEvaluator &) { ForEach(p, EliminateDeadCode); } }
+    };
+    for(const auto &pass : PASSES)
+    {
+        pass.pass(ir, evaluator);
+        std::string out, error;
+        const bool ok = IrInterpreter(ir, vars, procs).Run(input.str(), out, error);
+        if(ok != expectedOk || out != expected || error != expectedError)
+        {
+            std::printf("%s: the result changes after %s\n", argv[1], pass.name);
+            return 1;
+        }
+    }
+
+    std::fputs(expected.c_str(), stdout);
+    if(!expectedOk)
+    {
+        std::printf("***RUNTIME: %s\n", expectedError.c_str());
+        return -1;
+    }
+    return 0;
+}
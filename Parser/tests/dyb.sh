@@ -0,0 +1,74 @@
+#!/bin/bash
+# .dyb的往返测试：对programs中的每个程序，由.dyb重新生成的.dyd/.dys/.varfil/.profil
+# 必须与分析源文件时直接写出的完全相同；另外检查被篡改的.dyb会被拒绝，而不是生成错误的输出
+# 用法：tests/dyb.sh 分析器路径
+
+PARSER=$(realpath "$1")
+DIR=$(dirname "$(realpath "$0")")
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+failed=0
+
+for src in "$DIR"/programs/*.pas; do
+    name=$(basename "$src" .pas)
+    mkdir -p "$WORK/$name/expected"
+    cp "$src" "$WORK/$name/"
+    cd "$WORK/$name"
+
+    if ! "$PARSER" -dyb "$name.pas" > /dev/null; then
+        echo "FAIL $name: analysis failed"
+        failed=1
+        continue
+    fi
+    mv "$name".dyd "$name".dys "$name".varfil "$name".profil expected/
+    if ! "$PARSER" "$name.dyb" > /dev/null; then
+        echo "FAIL $name: conversion failed"
+        failed=1
+        continue
+    fi
+    for type in dyd dys varfil profil; do
+        if ! cmp -s "$name.$type" "expected/$name.$type"; then
+            echo "FAIL $name: .$type differs after the round trip"
+            failed=1
+        fi
+    done
+done
+
+# 把value按小端序写入file的offset处，占size个字节
+patch()
+{
+    local file=$1 offset=$2 size=$3 value=$4 bytes="" i
+    for ((i = 0; i < size; ++i)); do
+        bytes+=$(printf '\\x%02x' $(((value >> (8 * i)) & 255)))
+    done
+    printf "$bytes" | dd of="$file" bs=1 seek="$offset" conv=notrunc status=none
+}
+
+# 第一个词法单元从偏移80开始：str占8字节，之后依次为value、line和type
+BASE="$WORK/good/good.dyb"
+VARS=$(od -An -t u8 -j 32 -N 8 "$BASE" | tr -d ' ')
+
+reject()
+{
+    local name=$1 offset=$2 size=$3 value=$4
+    cp "$BASE" "$WORK/$name.dyb"
+    patch "$WORK/$name.dyb" "$offset" "$size" "$value"
+    if timeout 10 "$PARSER" "$WORK/$name.dyb" | grep -q "Invalid dyb file"; then
+        return
+    fi
+    echo "FAIL $name: corrupted dyb accepted"
+    failed=1
+}
+
+reject type0        96 1 0
+reject type250      96 1 250
+reject line0        92 4 0
+reject linehuge     92 4 2000000000
+reject linedecrease 112 4 0
+reject strrange     80 4 4000000000
+reject varkind      $((VARS + 24)) 1 7
+reject vartype      $((VARS + 25)) 1 3
+
+[ $failed = 0 ] && echo "dyb: all tests passed"
+exit $failed
@@ -0,0 +1,89 @@
+#!/bin/bash
+# 各种分析方式的对比测试：programs和errors中的程序，以及生成的两个大程序（一个正确，一个多处有语法错误），
+# 以默认的递归下降分析为准，-ll分析和-j 4（并行的词法分析和ParseParallel）写出的
+# .dyd、.dys、.varfil、.profil、.err和标准输出都必须与之相同；生成的程序足够大，-j 4时确实会分组并行分析
+# 用法：tests/engines.sh 分析器路径
+
+PARSER=$(realpath "$1")
+DIR=$(dirname "$(realpath "$0")")
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK"
+
+# 生成n个互相调用的函数，每隔几个带一个嵌套的函数；broken为1时每隔7个函数放入一种错误
+generate()
+{
+    awk -v n="$1" -v broken="$2" 'BEGIN {
+        print "begin"
+        print "  integer k;"
+        print "  integer m;"
+        for(i = 0; i < n; ++i)
+        {
+            f = "F" i
+            print "  integer function " f "(n);"
+            print "    begin"
+            print "      integer n;"
+            print "      integer t;"
+            if(i % 3 == 0)
+            {
+                print "      integer function G(x);"
+                print "        begin"
+                print "          integer x;"
+                print "          G:=x*n-t"
+                print "        end;"
+            }
+            e = broken && i % 7 == 3 ? int(i / 7) % 5 : -1
+            if(e == 0)
+                print "      t:=q-k;"
+            else if(e == 1)
+                print "      t:=n-;"
+            else if(e == 2)
+                print "      integer n;"
+            else if(e == 3)
+                print "      t:=F" (i + 1) "(n);"
+            else
+                print "      t:=n-k;"
+            if(e == 4)
+                print "      if n then " f ":=t else " f ":=n"
+            else
+                print "      if n<=0 then " f ":=t else " f ":=n*F" int(i / 2) "(n-1)"
+            print "    end;"
+        }
+        print "  read(m);"
+        print "  k:=F" (n - 1) "(m);"
+        print "  write(k)"
+        print "end"
+    }'
+}
+
+generate 1500 0 > gen.pas
+generate 1500 1 > generr.pas
+
+# 以$1为选项分析$2，输出写入目录$3
+analyze()
+{
+    mkdir -p "$3"
+    cp "$2" "$3/"
+    (cd "$3" && "$PARSER" $1 "$(basename "$2")" > stdout 2>&1; echo "exit $?" >> stdout)
+}
+
+failed=0
+count=0
+
+for src in "$DIR"/programs/*.pas "$DIR"/errors/*.pas gen.pas generr.pas; do
+    name=$(basename "$src" .pas)
+    count=$((count + 1))
+    analyze "" "$src" "default/$name"
+    for mode in "-ll" "-j 4"; do
+        dir=mode${mode// /}
+        analyze "$mode" "$src" "$dir/$name"
+        if ! diff -r "default/$name" "$dir/$name" > /dev/null; then
+            echo "FAIL $name: $mode differs from the default"
+            diff -r "default/$name" "$dir/$name" | head -5
+            failed=1
+        fi
+    done
+done
+
+[ $failed = 0 ] && echo "engines: all $count programs match"
+exit $failed
@@ -0,0 +1 @@
+#begin
@@ -0,0 +1,7 @@
+begin
+  integer k;
+  k : = 0abc;
+  k := 12abc * 0;
+  k := é;
+  k:=k<>k<=k>=k>k<k=k
+end
\ No newline at end of file
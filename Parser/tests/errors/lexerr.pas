@@ -0,0 +1,8 @@
+begin
+  integer k;
+  integer 0123;
+  integer abcdefghijklmnopqrstuvwxyz;
+  k := 5 # 3 $;
+  k := 00;
+  write(k)
+end
@@ -0,0 +1,16 @@
+begin
+  integer k;
+  integer m
+  integer function F(n);
+    begin
+      integer n;
+      if n <= 0 then F := 1
+      else F := n * G(n - 1)
+    end;
+  integer k;
+  read(m);
+  k := F(m;
+  x := 3;
+  if k then write(k) else write(m);
+  write(k)
+end
@@ -0,0 +1,5 @@
+begin
+ integer a;
+ a := 1
+end
+begin
\ No newline at end of file
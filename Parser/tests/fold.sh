@@ -0,0 +1,52 @@
+#!/bin/bash
+# 部分求值的测试：fold中的程序不读入，主程序中每条write的前面是对纯函数的一次常量调用（写在同一行），
+# -ir报告的主程序中每处折叠的结果都必须等于-run在该行输出的值，并且每一行都必须被折叠
+# 用法：tests/fold.sh 分析器路径
+
+PARSER=$(realpath "$1")
+DIR=$(dirname "$(realpath "$0")")
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK"
+
+failed=0
+count=0
+
+for src in "$DIR"/fold/*.pas; do
+    name=$(basename "$src" .pas)
+    cp "$src" .
+
+    if ! "$PARSER" -ir "$name.pas" > /dev/null; then
+        echo "FAIL $name: -ir failed"
+        failed=1
+        continue
+    fi
+    if ! "$PARSER" -run "$name.pas" < /dev/null > raw; then
+        echo "FAIL $name: -run failed"
+        failed=1
+        continue
+    fi
+
+    # 每条write所在的行号和-run依次输出的值
+    grep -n 'write(' "$name.pas" | cut -d: -f1 > lines
+    grep -v '^AST: \|^Parsing succeeded$\|^VM: ' raw > values
+    if [ "$(wc -l < lines)" != "$(wc -l < values)" ]; then
+        echo "FAIL $name: the main program must write once per line"
+        failed=1
+        continue
+    fi
+    paste -d' ' lines values | sort -n > expected
+
+    # 形如"; line N in main: F#k(x) = R, ..."的折叠
+    sed -n 's/^;   line \([0-9]*\) in main: .* = \(-\{0,1\}[0-9]*\),.*/\1 \2/p' "$name.ir" | sort -n > folded
+    if ! diff expected folded > /dev/null; then
+        echo "FAIL $name: folded results differ from -run (line value)"
+        diff expected folded | head -5
+        failed=1
+        continue
+    fi
+    count=$((count + $(wc -l < folded)))
+done
+
+[ $failed = 0 ] && echo "fold: all $count folded calls match -run"
+exit $failed
@@ -0,0 +1,24 @@
+begin
+  integer r;
+  integer function sign(n);
+    begin
+      integer n;
+      if n<0 then sign:=0-1
+      else if n>0 then sign:=1 else sign:=0
+    end;
+  integer function code(n);
+    begin
+      integer n;
+      integer c;
+      c:=0;
+      if n<>5 then c:=c-1 else c:=c-2;
+      if n>=5 then c:=c*10-4 else c:=c*10-8;
+      if n<=5 then c:=c*10-16 else c:=c*10-32;
+      if n=5 then code:=c*10 else code:=c*10-64
+    end;
+  r:=sign(0);write(r);
+  r:=sign(7);write(r);
+  r:=code(5);write(r);
+  r:=code(4);write(r);
+  r:=code(6);write(r)
+end
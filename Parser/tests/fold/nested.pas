@@ -0,0 +1,49 @@
+begin
+  integer r;
+  integer function outer(x);
+    begin
+      integer x;
+      integer acc;
+      integer t;
+      integer function step(y);
+        begin
+          integer y;
+          acc:=acc*2-y;
+          if y<=1 then step:=0 else step:=step(y-1)
+        end;
+      acc:=x;
+      t:=step(x);
+      outer:=acc
+    end;
+  integer function twice(x);
+    begin
+      integer x;
+      integer function inner(y);
+        begin
+          integer y;
+          inner:=y*x
+        end;
+      twice:=inner(x)-inner(1)
+    end;
+  integer function deep(x);
+    begin
+      integer x;
+      integer function mid(y);
+        begin
+          integer y;
+          integer function leaf(z);
+            begin
+              integer z;
+              if z>x then leaf:=z-x else leaf:=x-z
+            end;
+          mid:=leaf(y)*leaf(y-1)
+        end;
+      deep:=mid(x*3)-mid(0)
+    end;
+  r:=outer(3);write(r);
+  r:=outer(10);write(r);
+  r:=twice(7);write(r);
+  r:=twice(0);write(r);
+  r:=deep(4);write(r);
+  r:=deep(100);write(r)
+end
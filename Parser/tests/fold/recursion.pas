@@ -0,0 +1,30 @@
+begin
+  integer r;
+  integer function fact(n);
+    begin
+      integer n;
+      if n<=0 then fact:=1 else fact:=n*fact(n-1)
+    end;
+  integer function fib(n);
+    begin
+      integer n;
+      integer m;
+      m:=0-1;
+      if n<=1 then fib:=n
+      else fib:=fib(n-1)-fib(n-2)*m
+    end;
+  integer function down(n);
+    begin
+      integer n;
+      if n=0 then down:=0 else down:=down(n-1)-3
+    end;
+  r:=fact(5);write(r);
+  r:=fact(0);write(r);
+  r:=fact(12);write(r);
+  r:=fact(13);write(r);
+  r:=fact(20);write(r);
+  r:=fib(20);write(r);
+  r:=fib(1);write(r);
+  r:=down(1000);write(r);
+  r:=down(0);write(r)
+end
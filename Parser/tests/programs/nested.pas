@@ -0,0 +1,19 @@
+begin
+	integer a;
+	integer b;
+	integer function G(x);
+	begin
+		integer x;
+		integer a;
+		integer function H(y);
+		begin
+			integer y;
+			H := y * a - x
+		end;
+		G := H(x - 1) * b
+	end;
+	read(a);
+	b := G(a);
+	if a <> b then write(a) else write(b);
+	if a >= b then write(a) else if a > b then write(b) else write(a)
+end
\ No newline at end of file
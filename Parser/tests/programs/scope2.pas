@@ -0,0 +1,31 @@
+begin
+  integer k;
+  integer function F(n);
+    begin
+      integer n;
+      integer k;
+      integer function Q(x);
+        begin
+          integer x;
+          x:=n*k
+        end;
+      k:=Q(n)
+    end;
+  integer function G(n);
+    begin
+      integer n;
+      integer function Q(y);
+        begin
+          integer y;
+          y:=y
+        end;
+      n:=k
+    end;
+  integer function H(m);
+    begin
+      integer m;
+      m:=k;
+      m:=F(m)
+    end;
+  k:=F(1)
+end
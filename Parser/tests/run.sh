@@ -0,0 +1,78 @@
+#!/bin/bash
+# 执行的端到端测试：run中的每个程序X.pas配有一组输入X.in或X.名称.in和期望的输出（同名的.out），
+# 分别由-run（以及给出第二个参数时，以switch分派的解释器；给出第三个参数时，在IR上解释执行，见tests/IrTest.cpp）
+# 和-asm生成的可执行文件执行，标准输出都必须与期望的相同；输出中有***RUNTIME时退出码应为255，否则为0
+# 用法：tests/run.sh 分析器路径 [以switch分派的分析器路径 [irtest路径]]
+
+PARSER=$(realpath "$1")
+SWITCH_PARSER=${2:+$(realpath "$2")}
+IRTEST=${3:+$(realpath "$3")}
+DIR=$(dirname "$(realpath "$0")")
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+failed=0
+count=0
+
+# 比较一次执行的输出和退出码，$1为说明，$2为输出文件，$3为退出码，$4为期望的输出
+check()
+{
+    local expectedCode=0
+    grep -q '^\*\*\*RUNTIME' "$4" && expectedCode=255
+    if ! cmp -s "$2" "$4"; then
+        echo "FAIL $1: output differs"
+        diff "$4" "$2" | head -5
+        failed=1
+    elif [ "$3" != "$expectedCode" ]; then
+        echo "FAIL $1: exit code $3, expected $expectedCode"
+        failed=1
+    fi
+}
+
+# -run的输出中去掉分析器自身的报告
+run_vm()
+{
+    "$1" -run "$2" < "$3" > "$WORK/raw"
+    local code=$?
+    grep -v '^AST: \|^Parsing succeeded$\|^VM: ' "$WORK/raw" > "$4"
+    return $code
+}
+
+for src in "$DIR"/run/*.pas; do
+    name=$(basename "$src" .pas)
+    cp "$src" "$WORK/"
+    cd "$WORK"
+
+    if ! "$PARSER" -asm "$name.pas" > /dev/null ||
+       ! as "$name.s" -o "$name.o" || ! ld "$name.o" -o "$name.bin"; then
+        echo "FAIL $name: cannot build the executable"
+        failed=1
+        continue
+    fi
+
+    for input in "$DIR/run/$name".in "$DIR/run/$name".*.in; do
+        [ -e "$input" ] || continue
+        expected=${input%.in}.out
+        test=$(basename "${input%.in}")
+        count=$((count + 1))
+
+        run_vm "$PARSER" "$name.pas" "$input" out
+        check "$test (-run)" out $? "$expected"
+
+        if [ -n "$SWITCH_PARSER" ]; then
+            run_vm "$SWITCH_PARSER" "$name.pas" "$input" out
+            check "$test (-run, switch)" out $? "$expected"
+        fi
+
+        if [ -n "$IRTEST" ]; then
+            "$IRTEST" "$name.pas" < "$input" > out
+            check "$test (IR)" out $? "$expected"
+        fi
+
+        "./$name.bin" < "$input" > out
+        check "$test (-asm)" out $? "$expected"
+    done
+done
+
+[ $failed = 0 ] && echo "run: all $count tests passed"
+exit $failed
@@ -0,0 +1,14 @@
+begin
+  integer a;
+  integer b;
+  integer c;
+  read(a);
+  read(b);
+  if a<b then c:=1 else c:=0; write(c);
+  if a<=b then c:=1 else c:=0; write(c);
+  if a=b then c:=1 else c:=0; write(c);
+  if a>=b then c:=1 else c:=0; write(c);
+  if a>b then c:=1 else c:=0; write(c);
+  if a<>b then c:=1 else c:=0; write(c);
+  c:=a*b-a; write(c)
+end
@@ -0,0 +1,13 @@
+begin
+  integer m1;
+  integer r;
+  integer function fib(n);
+    begin
+      integer n;
+      if n<=1 then fib:=n
+      else fib:=fib(n-1)-fib(n-2)*m1
+    end;
+  m1:=0-1;
+  r:=fib(25);
+  write(r)
+end
@@ -0,0 +1,23 @@
+begin
+  integer a;
+  integer r;
+  integer function Outer(x);
+    begin
+      integer x;
+      integer acc;
+      integer function Inner(y);
+        begin
+          integer y;
+          if y<=0 then Inner:=0
+          else
+            if y=1 then acc:=acc-0-x else Inner:=Inner(y-1)
+        end;
+      acc:=100;
+      r:=Inner(x);
+      if x<=0 then Outer:=acc else Outer:=acc*1-Outer(x-1)
+    end;
+  read(a);
+  r:=Outer(a);
+  write(r);
+  write(a)
+end
@@ -0,0 +1,8 @@
+begin
+  integer a;
+  integer b;
+  read(a);
+  write(a);
+  read(b);
+  write(b)
+end
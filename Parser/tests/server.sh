@@ -0,0 +1,97 @@
+#!/bin/bash
+# 编译服务的测试：套接字路径上的其他文件和仍在运行的服务不会被替换；-j 1时空闲的连接不占用工作线程；
+# SOURCE的回复与命令行写出的变量表和过程表相同；OPEN和EDIT回复文档当前的错误；
+# STOP之后即使还有连接，服务也会退出
+# 用法：tests/server.sh 分析器路径
+
+PARSER=$(realpath "$1")
+DIR=$(dirname "$(realpath "$0")")
+WORK=$(mktemp -d)
+IDLE=
+trap 'kill $IDLE 2> /dev/null; rm -rf "$WORK"' EXIT
+cd "$WORK"
+
+failed=0
+
+fail()
+{
+    echo "FAIL $1"
+    failed=1
+}
+
+# 路径上是普通文件时拒绝启动，并且不删除它
+echo keep > file.sock
+timeout 5 "$PARSER" --server file.sock > /dev/null
+if [ $? != 255 ] || [ "$(cat file.sock)" != keep ]; then
+    fail "server replaced a regular file"
+fi
+
+"$PARSER" -j 1 --server s.sock > server.log &
+SERVER=$!
+for ((i = 0; i < 50; ++i)); do
+    [ -S s.sock ] && break
+    sleep 0.1
+done
+
+timeout 5 "$PARSER" --server s.sock > /dev/null
+if [ $? != 255 ]; then
+    fail "second server started on a live socket"
+fi
+
+# 一个连接只发了SOURCE的请求行，另一个什么也不发，都不应挡住其他客户端
+if command -v python3 > /dev/null; then
+    python3 -c "
+import socket, time
+a = socket.socket(socket.AF_UNIX); a.connect('s.sock')
+b = socket.socket(socket.AF_UNIX); b.connect('s.sock'); b.send(b'SOURCE 1000000\n')
+time.sleep(60)" > /dev/null 2>&1 &
+    IDLE=$!
+    sleep 0.3
+fi
+
+cp "$DIR"/programs/good.pas .
+"$PARSER" good.pas > /dev/null
+if ! timeout 5 "$PARSER" --client s.sock - < good.pas > reply.txt ||
+   ! cat good.varfil good.profil | cmp -s - reply.txt; then
+    fail "SOURCE reply differs from the command line output"
+fi
+
+# 在打开的文档上引入并改正一个语法错误，回复为当前的错误信息
+if command -v python3 > /dev/null; then
+    if ! timeout 5 python3 -c "
+import socket, sys
+src = open('good.pas', 'rb').read()
+pos = src.index(b'n - 1')
+s = socket.socket(socket.AF_UNIX); s.connect('s.sock')
+f = s.makefile('rb')
+def request(line, body=b''):
+    s.sendall(line + body)
+    code, size = f.readline().split()
+    return int(code), f.read(int(size))
+ok = request(b'EDIT 0 0 0\n')[0] == -1
+ok = ok and request(b'OPEN %d\n' % len(src), src) == (0, b'')
+code, errs = request(b'EDIT %d 1 1\n' % (pos + 2), b'(')
+ok = ok and code == -1 and errs.startswith(b'***LINE: 8  ')
+ok = ok and request(b'EDIT %d 1 1\n' % (pos + 2), b'-') == (0, b'')
+sys.exit(0 if ok else 1)" 2> /dev/null; then
+        fail "OPEN/EDIT replies differ from the expected errors"
+    fi
+fi
+
+if ! timeout 5 "$PARSER" --client s.sock -stop > /dev/null; then
+    fail "STOP was not answered"
+fi
+for ((i = 0; i < 50; ++i)); do
+    kill -0 $SERVER 2> /dev/null || break
+    sleep 0.1
+done
+if kill -0 $SERVER 2> /dev/null; then
+    fail "server still running after STOP"
+    kill $SERVER
+fi
+wait $SERVER 2> /dev/null
+
+if [ $failed = 0 ]; then
+    echo "server: all tests passed"
+fi
+exit $failed
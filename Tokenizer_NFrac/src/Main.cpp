@@ -1,52 +1,17 @@
-#include <fstream>
-#include <iomanip>
+#include <cstdio>
 #include <iostream>
-#include <iterator>
-#include <map>
-#include <utility>
+#include <string>
+#include <vector>
 
+#include "DydFile.h"
+#include "OutputFile.h"
+#include "SourceFile.h"
 #include "Tokenizer.h"
 
 using namespace std;
 
-map<TokenType, int> TOKENTYPE_TO_INDEX =
-{
-    { TokenType::Integer,      3  },
-    { TokenType::Begin,        1  },
-    { TokenType::End,          2  },
-    { TokenType::If,           4  },
-    { TokenType::Then,         5  },
-    { TokenType::Else,         6  },
-    { TokenType::Function,     7  },
-    { TokenType::Read,         8  },
-    { TokenType::Write,        9  },
-    { TokenType::Semicolon,    23 },
-    { TokenType::LeftBrac,     21 },
-    { TokenType::RightBrac,    22 },
-    { TokenType::LessEqual,    14 },
-    { TokenType::Minus,        18 },
-    { TokenType::Times,        19 },
-    { TokenType::Assign,       20 },
-    { TokenType::Equal,        12 },
-    { TokenType::NotEqual,     13 },
-    { TokenType::Less,         15 },
-    { TokenType::GreaterEqual, 16 },
-    { TokenType::Greater,      17 },
-    { TokenType::Identifier,   10 },
-    { TokenType::IntLiteral,   11 },
-    { TokenType::EndMark,      25 },
-    { TokenType::NewLine,      24 }
-};
-
-bool ReadFile(const string &filename, string &output)
-{
-    ifstream fin(filename, ifstream::in);
-    if(!fin)
-        return false;
-    output = string(istreambuf_iterator<char>(fin),
-                         istreambuf_iterator<char>());
-    return true;
-}
+// 每次从词法分析器取出的词法单元个数，分析结果逐窗口写出，内存占用与源文件大小无关
+constexpr size_t WINDOW_SIZE = 4096;
 
 string ReplaceFileType(const string &name, const string &type)
 {
@@ -63,51 +28,69 @@ int main(int argc, char *argv[])
         return -1;
     }
 
-    string src;
-    if(!ReadFile(argv[1], src))
+    const string filename = argv[1];
+    SourceFile src;
+    if(!src.Open(filename))
     {
-        cout << "Cannot open file: "
-             << argv[1] << endl;
+        cout << (src.TooLarge() ? "File too large (over 4GB): " : "Cannot open file: ")
+             << filename << endl;
         return -1;
     }
 
-    // 调用词法分析
+    const string dydFilename = ReplaceFileType(filename, "dyd");
+    OutputFile fout;
+    if(!fout.Open(dydFilename))
+    {
+        cout << "Failed to open output file" << endl;
+        return -1;
+    }
+
+    // 调用词法分析，只输出dyd时不需要整形字面量的值
+
+    vector<TokenizerError> errs;
+    Tokenizer tokenizer(src.Data(), src.Size(), filename);
+    tokenizer.SetLexOnly(true);
 
-    vector<TokenizerException> errs;
-    Tokenizer::TokenStream toks = Tokenizer(src, argv[1]).Tokenize(errs);
+    Tokenizer::TokenStream window(src.Data());
+    window.Reserve(WINDOW_SIZE);
+    for(bool done = false; !done; window.Recycle())
+    {
+        done = tokenizer.Fill(window, WINDOW_SIZE, errs);
+
+        // 出现词法错误后dyd文件会被删除，不必再写
+        if(errs.empty())
+            WriteDydTokens(fout, window);
+    }
+    const bool written = fout.Close();
 
     // 错误输出
 
     if(errs.size())
     {
-        ofstream fout(ReplaceFileType(argv[1], "err"),
-                           ofstream::out | ofstream::trunc);
+        remove(dydFilename.c_str());
+
+        const bool opened = fout.Open(ReplaceFileType(filename, "err"));
         for(auto &e : errs)
         {
-            fout << "***LINE: " << e.Line()
-                 << "  " << e.What() << endl;
-            cout << "***LINE: " << e.Line()
-                 << "  " << e.What() << endl;
+            const string msg = e.Message(src.Data());
+            fout.Put("***LINE: ");
+            fout.PutInt(e.line);
+            fout.Put("  ");
+            fout.Put(msg);
+            fout.Put('\n');
+            cout << "***LINE: " << e.line
+                 << "  " << msg << '\n';
         }
+        if(!fout.Close() || !opened)
+            cout << "Failed to write err file" << endl;
         return -1;
     }
 
-    // 分析结果输出
-
-    ofstream fout(ReplaceFileType(argv[1], "dyd"),
-                       ofstream::out | ofstream::trunc);
-    if(!fout)
+    if(!written)
     {
-        cout << "Failed to open output file" << endl;
+        cout << "Failed to write output file" << endl;
         return -1;
     }
-    for(auto &t : toks)
-    {
-        fout << setw(16) << setfill(' ')
-             << t.tokenStr
-             << " "
-             << setw(2) << setfill('0')
-             << TOKENTYPE_TO_INDEX[t.type]
-             << endl;
-    }
+
+    return 0;
 }